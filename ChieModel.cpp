@@ -12,10 +12,11 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include "embedded_models.h"
+#include "asset_manifest.h"
 
 
 // Animation settings
-const int ANIMATION_FRAMES = 12;  // Number of frames for jump animation
+const int ANIMATION_FRAMES = 12;  // Number of steps in the jump animation
 const double JUMP_HEIGHT = 20.0;  // Maximum jump height in pixels
 const int JUMP_SPEED = 16;       // Animation frame delay in milliseconds
 
@@ -83,40 +84,8 @@ const int KEY_COOLDOWN = 100;
 // Green background for chroma key
 const SDL_Color BACKGROUND_COLOR = {0, 255, 0, 255};
 
-// Poses
-std::map<int, std::string> POSES = {
-    {1, "santai"},
-    {3, "satu tangan"},
-    {4, "belakang tangan"},
-    {6, "wawa"}
-};
-
-// Key mappings (QWERTY keyboard layout)
-struct PoseExpression {
-    int pose;
-    int expression;
-    
-    PoseExpression(int p, int e) : pose(p), expression(e) {}
-};
-
-// Map SDL key codes to pose/expression combinations
-std::map<SDL_Keycode, PoseExpression> KEY_MAPPINGS = {
-    {SDLK_q, PoseExpression(1, 2)},  // Pose 1, Expression 2
-    {SDLK_a, PoseExpression(1, 3)},  // Pose 1, Expression 3
-    {SDLK_z, PoseExpression(1, 4)},  // Pose 1, Expression 4
-    
-    {SDLK_w, PoseExpression(3, 2)},  // Pose 3, Expression 2
-    {SDLK_s, PoseExpression(3, 3)},  // Pose 3, Expression 3
-    {SDLK_x, PoseExpression(3, 4)},  // Pose 3, Expression 4
-    
-    {SDLK_e, PoseExpression(4, 2)},  // Pose 4, Expression 2
-    {SDLK_d, PoseExpression(4, 3)},  // Pose 4, Expression 3
-    {SDLK_c, PoseExpression(4, 4)},  // Pose 4, Expression 4
-    
-    {SDLK_r, PoseExpression(6, 2)},  // Pose 6, Expression 2
-    {SDLK_f, PoseExpression(6, 3)},  // Pose 6, Expression 3
-    {SDLK_v, PoseExpression(6, 4)},  // Pose 6, Expression 4
-};
+// Poses and key mappings (QWERTY keyboard layout) come from asset_manifest.h,
+// generated from the model directory by generate_embedded_models.py
 
 // Image key type for the map
 struct ImageKey {
@@ -173,9 +142,6 @@ private:
     std::map<ImageKey, SDL_Texture*> images;
     std::map<ImageKey, SDL_Surface*> imageSurfaces; // For camera output
 
-    // Animation frames
-    std::map<std::pair<int, int>, std::vector<SDL_Surface*>> animationFrames; // Maps start_pose->end_pose to frames
-
     // State
     int currentPose = 1;
     int currentExpression = 1;
@@ -219,23 +185,31 @@ private:
         return texture;
     }
     
-    // Helper to get image path
-    std::string getImagePath(int pose, int expression) {
-        static std::string modelDir = "";
+    // Helper to load an image: decode embedded PNG data in memory,
+    // falling back to the model directory next to the executable
+    SDL_Surface* loadImageSurface(int pose, int expression, std::string& source) {
+        std::string filename = std::to_string(pose) + "-" + std::to_string(expression) + ".png";
         
-        // If we haven't set up the model directory yet, extract embedded images
-        if (modelDir.empty()) {
-            modelDir = extractEmbeddedImagesToTemp();
-            if (modelDir.empty()) {
-                // Fallback to local directory if extraction failed
-                std::filesystem::path exePath = std::filesystem::canonical("/proc/self/exe");
-                std::filesystem::path exeDir = exePath.parent_path();
-                modelDir = (exeDir / "model").string();
+        SDL_Surface* surface = nullptr;
+        const EmbeddedImage* embedded = findEmbeddedImage(filename);
+        if (embedded) {
+            source = "embedded:" + filename;
+            SDL_RWops* rw = SDL_RWFromConstMem(embedded->data, static_cast<int>(embedded->size));
+            surface = rw ? IMG_Load_RW(rw, 1) : nullptr;
+        } else {
+            std::filesystem::path exePath = std::filesystem::canonical("/proc/self/exe");
+            std::filesystem::path path = exePath.parent_path() / "model" / filename;
+            source = path.string();
+            if (!std::filesystem::exists(path)) {
+                return nullptr;
             }
+            surface = IMG_Load(source.c_str());
         }
         
-        std::string filename = std::to_string(pose) + "-" + std::to_string(expression) + ".png";
-        return modelDir + "/" + filename;
+        if (!surface) {
+            std::cerr << "Failed to load image: " << source << "\nError: " << IMG_GetError() << std::endl;
+        }
+        return surface;
     }
     
 public:
@@ -325,9 +299,6 @@ public:
         // Load all ChieModel images
         loadImages();
 
-        // Generate animation frames for pose transitions
-        generateAnimationFrames();
-
         return true;
     }
     
@@ -335,36 +306,34 @@ public:
         int loadedCount = 0;
         
         // Load all possible poses and expressions
-        for (const auto& poseEntry : POSES) {
-            int pose = poseEntry.first;
+        for (const auto& poseEntry : manifest::POSES) {
+            if (!poseEntry.name[0]) {
+                continue; // no key reaches it
+            }
+            int pose = poseEntry.id;
             
             for (int expression = 1; expression <= 4; expression++) {
-                std::string path = getImagePath(pose, expression);
+                std::string path;
+                SDL_Surface* surface = loadImageSurface(pose, expression, path);
+                if (!surface) {
+                    continue;
+                }
                 
-                if (std::filesystem::exists(path)) {
-                    // Load image
-                    SDL_Surface* surface = IMG_Load(path.c_str());
-                    if (!surface) {
-                        std::cerr << "Failed to load image: " << path << "\nError: " << IMG_GetError() << std::endl;
-                        continue;
-                    }
-                    
-                    // Create texture from surface
-                    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-                    if (!texture) {
-                        std::cerr << "Failed to create texture from " << path << std::endl;
-                        SDL_FreeSurface(surface);
-                        continue;
-                    }
-                    
-                    // Store the image
-                    ImageKey key = {pose, expression};
-                    images[key] = texture;
-                    imageSurfaces[key] = surface; // Keep surface for camera output
-                    
-                    std::cout << "Loaded image: " << path << std::endl;
-                    loadedCount++;
+                // Create texture from surface
+                SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+                if (!texture) {
+                    std::cerr << "Failed to create texture from " << path << std::endl;
+                    SDL_FreeSurface(surface);
+                    continue;
                 }
+                
+                // Store the image
+                ImageKey key = {pose, expression};
+                images[key] = texture;
+                imageSurfaces[key] = surface; // Keep surface for camera output
+                
+                std::cout << "Loaded image: " << path << std::endl;
+                loadedCount++;
             }
         }
         
@@ -493,7 +462,8 @@ public:
         
         // Draw status text
         SDL_Color white = {255, 255, 255, 255};
-        std::string poseName = POSES.count(currentPose) ? POSES[currentPose] : std::to_string(currentPose);
+        const manifest::PoseInfo* poseInfo = manifest::findPose(currentPose);
+        std::string poseName = (poseInfo && poseInfo->name[0]) ? poseInfo->name : std::to_string(currentPose);
         std::string statusText = "Current Pose: " + std::to_string(currentPose) +
                                " (" + poseName + "), Expression: " +
                                std::to_string(currentExpression) +
@@ -526,7 +496,7 @@ public:
         SDL_RenderPresent(renderer);
     }
     
-    void updateOutputWindow(SDL_Surface* surface) {
+    void updateOutputWindow(SDL_Surface* surface, int offsetY = 0) {
         if (!outputWindow || !outputRenderer || !surface) {
             return;
         }
@@ -555,7 +525,7 @@ public:
         destRect.w = width;
         destRect.h = height;
         destRect.x = (WINDOW_WIDTH - width) / 2;
-        destRect.y = (WINDOW_HEIGHT - height) / 2;
+        destRect.y = (WINDOW_HEIGHT - height) / 2 + offsetY;
 
         // Render the texture with optional horizontal flip
         if (isFlipped) {
@@ -584,11 +554,12 @@ public:
         }
 
         // Check if key is mapped
-        if (KEY_MAPPINGS.find(key) == KEY_MAPPINGS.end()) {
+        const manifest::KeyBinding* binding = manifest::findBinding(key);
+        if (!binding) {
             return;
         }
         
-        const PoseExpression& mapping = KEY_MAPPINGS.at(key);
+        const manifest::KeyBinding& mapping = *binding;
         int newPose = mapping.pose;
         int newExpression = mapping.expression;
         int oldPose = currentPose;
@@ -638,104 +609,33 @@ public:
         }
     }
     
-    void generateAnimationFrames() {
-        std::cout << "Generating animation frames for pose transitions..." << std::endl;
-        
-        // Get all available poses
-        std::vector<int> availablePoses;
-        for (const auto& entry : POSES) {
-            availablePoses.push_back(entry.first);
-        }
-        
-        // For each pair of poses, generate transition animation frames
-        for (size_t i = 0; i < availablePoses.size(); i++) {
-            for (size_t j = 0; j < availablePoses.size(); j++) {
-                // Skip same pose transitions
-                if (i == j) continue;
-                
-                int startPose = availablePoses[i];
-                int endPose = availablePoses[j];
-                
-                // Only generate if we have the necessary start and end images
-                ImageKey startKey = {startPose, 1}; // Use default expression
-                ImageKey endKey = {endPose, 1};     // Use default expression
-                
-                if (imageSurfaces.find(startKey) == imageSurfaces.end() ||
-                    imageSurfaces.find(endKey) == imageSurfaces.end()) {
-                    continue;
-                }
-                
-                // Get the source and destination surfaces
-                SDL_Surface* startSurface = imageSurfaces[startKey];
-                SDL_Surface* endSurface = imageSurfaces[endKey];
-                
-                // Create animation frames
-                std::vector<SDL_Surface*> frames;
-                
-                for (int frame = 0; frame < ANIMATION_FRAMES; frame++) {
-                    // Calculate progress (0.0 to 1.0)
-                    double progress = static_cast<double>(frame) / (ANIMATION_FRAMES - 1);
-                    
-                    // Calculate jump height using sine wave for smooth arc
-                    double jumpOffset = JUMP_HEIGHT * sin(progress * M_PI);
-
-                    // Create a new surface with green background
-                    SDL_Surface* animFrame = SDL_CreateRGBSurface(0,
-                                                                WINDOW_WIDTH,
-                                                                WINDOW_HEIGHT,
-                                                                32, 0, 0, 0, 0);
-                    
-                    // Fill with green
-                    SDL_FillRect(animFrame, nullptr, SDL_MapRGB(animFrame->format, 
-                                                            BACKGROUND_COLOR.r, 
-                                                            BACKGROUND_COLOR.g, 
-                                                            BACKGROUND_COLOR.b));
-                    
-                    // Decide which image to use based on progress
-                    SDL_Surface* sourceSurface = (progress < 0.5) ? startSurface : endSurface;
-                    
-                    // Center the image with jump offset
-                    SDL_Rect srcRect;
-                    srcRect.x = 0;
-                    srcRect.y = 0;
-                    srcRect.w = sourceSurface->w;
-                    srcRect.h = sourceSurface->h;
-                    
-                    SDL_Rect destRect;
-                    destRect.w = sourceSurface->w;
-                    destRect.h = sourceSurface->h;
-                    destRect.x = (WINDOW_WIDTH - sourceSurface->w) / 2;
-                    destRect.y = (WINDOW_HEIGHT - sourceSurface->h) / 2 - static_cast<int>(jumpOffset);
-                    
-                    // Blit the image onto the frame
-                    SDL_BlitSurface(sourceSurface, &srcRect, animFrame, &destRect);
-                    
-                    // Add to frames
-                    frames.push_back(animFrame);
-                }
-                
-                // Store in animation frames map
-                std::pair<int, int> transition(startPose, endPose);
-                animationFrames[transition] = frames;
-            }
-        }
-        
-        std::cout << "Generated " << animationFrames.size() << " pose transition animations" << std::endl;
-    }
-    
     void playPoseAnimation(int startPose, int endPose) {
-        // Check if we have an animation for this transition
-        std::pair<int, int> transition(startPose, endPose);
-        if (animationFrames.find(transition) == animationFrames.end()) {
+        // Transitions are drawn from the loaded pose images with a per-step offset,
+        // nothing is pre-rendered
+        auto startIt = imageSurfaces.find({startPose, 1}); // Use default expression
+        auto endIt = imageSurfaces.find({endPose, 1});
+        if (startIt == imageSurfaces.end() || endIt == imageSurfaces.end()) {
             return; // No animation available
         }
         
-        const auto& frames = animationFrames[transition];
+        SDL_Surface* shownSurface = nullptr;
         
-        // Play each frame
-        for (const auto& frame : frames) {
+        for (int frame = 0; frame < ANIMATION_FRAMES; frame++) {
+            // Calculate progress (0.0 to 1.0)
+            double progress = static_cast<double>(frame) / (ANIMATION_FRAMES - 1);
+            
+            // Calculate jump height using sine wave for smooth arc
+            double jumpOffset = JUMP_HEIGHT * sin(progress * M_PI);
+            
+            // Switch from the start to the end pose halfway through
+            SDL_Surface* sourceSurface = (progress < 0.5) ? startIt->second : endIt->second;
+            if (sourceSurface != shownSurface) {
+                textureCache.markNeedsUpdate();
+                shownSurface = sourceSurface;
+            }
+            
             // Update output window
-            updateOutputWindow(frame);
+            updateOutputWindow(sourceSurface, -static_cast<int>(jumpOffset));
             
             // Process events to keep UI responsive
             SDL_Event event;
@@ -748,6 +648,9 @@ public:
             // Small delay between frames
             SDL_Delay(JUMP_SPEED);
         }
+        
+        // The final pose is shown with the selected expression, not the default one
+        textureCache.markNeedsUpdate();
     }
     
     void run() {
@@ -834,16 +737,6 @@ public:
         }
         imageSurfaces.clear();
         
-        // Clean up animation frames
-        for (auto& animation : animationFrames) {
-            for (auto& frame : animation.second) {
-                if (frame) {
-                    SDL_FreeSurface(frame);
-                }
-            }
-        }
-        animationFrames.clear();
-        
         // Free font
         if (font) {
             TTF_CloseFont(font);
@@ -1,16 +1,18 @@
 #include "animation_system.h"
-#include "resource_manager.h"
+#include "avatar_clock.h"
 #include <random>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 
-AnimationSystem::AnimationSystem(ResourceManager* rm) 
-    : resourceManager(rm)
-    , currentType(AnimationType::IDLE)
+AnimationSystem::AnimationSystem()
+    : currentType(AnimationType::IDLE)
     , startPose(1), endPose(1)
-    , currentFrame(0), totalFrames(0)
     , isPlaying(false), isLooping(false)
+    , transitionProgress(0.0f)
     , isBlinking(false)
-    , expressionBeforeBlink(1) {
+    , expressionBeforeBlink(1)
+    , mouthOpen(false), mouthExpression(4) {
     
     resetBlinkTimer();
 }
@@ -20,36 +22,29 @@ void AnimationSystem::playPoseTransition(int fromPose, int toPose) {
         return; // No animation needed
     }
     
+    // A transition replaces a running blink
+    if (isBlinking) {
+        isBlinking = false;
+        resetBlinkTimer();
+    }
+    
     startPose = fromPose;
     endPose = toPose;
-    currentFrame = 0;
     currentType = AnimationType::POSE_TRANSITION;
     isPlaying = true;
     isLooping = false;
     
-    // Check if animation frames exist for this transition
-    const auto& frames = resourceManager->getAnimationFrames(fromPose, toPose);
-    totalFrames = frames.size();
-    
-    if (totalFrames == 0) {
-        std::cerr << "No animation frames available for transition " << fromPose << " -> " << toPose << std::endl;
-        isPlaying = false;
-        currentType = AnimationType::IDLE;
-        return;
-    }
-    
-    frameStartTime = std::chrono::steady_clock::now();
+    transitionStartTime = AvatarClock::now();
+    transitionProgress = 0.0f;
     std::cout << "Starting pose transition animation: " << fromPose << " -> " << toPose 
-              << " (" << totalFrames << " frames)" << std::endl;
+              << " (" << transitionCurve.duration.count() << " ms)" << std::endl;
 }
 
 void AnimationSystem::startBlink() {
     if (isBlinking) return;
     
     isBlinking = true;
-    blinkStartTime = std::chrono::steady_clock::now();
-    currentFrame = 0;
-    totalFrames = blinkDurationFrames;
+    blinkStartTime = AvatarClock::now();
     currentType = AnimationType::BLINK;
     isPlaying = true;
     isLooping = false;
@@ -74,34 +69,30 @@ void AnimationSystem::update() {
         return;
     }
     
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - frameStartTime);
-    
-    if (elapsed >= frameDuration) {
-        currentFrame++;
-        frameStartTime = now;
-        
-        switch (currentType) {
-            case AnimationType::POSE_TRANSITION:
-                updatePoseTransition();
-                break;
-            case AnimationType::BLINK:
-                if (currentFrame >= totalFrames) {
-                    stopBlink();
-                }
-                break;
-            case AnimationType::IDLE:
-            default:
-                break;
-        }
+    auto now = AvatarClock::now();
+    
+    // Transitions are time based: sample the curve once per update so every
+    // renderer draws the same point of the arc
+    if (currentType == AnimationType::POSE_TRANSITION) {
+        updatePoseTransition(now);
+        return;
+    }
+    
+    // Blinks end by elapsed time, whatever the frame rate
+    if (currentType == AnimationType::BLINK && now - blinkStartTime >= blinkDuration) {
+        stopBlink();
     }
     
     // Also check for blink timing
     updateBlink();
 }
 
-void AnimationSystem::updatePoseTransition() {
-    if (currentFrame >= totalFrames) {
+void AnimationSystem::updatePoseTransition(std::chrono::steady_clock::time_point now) {
+    auto elapsed = std::chrono::duration<float, std::milli>(now - transitionStartTime);
+    transitionProgress = elapsed.count() / static_cast<float>(transitionCurve.duration.count());
+    
+    if (transitionProgress >= 1.0f) {
+        transitionProgress = 1.0f;
         isPlaying = false;
         currentType = AnimationType::IDLE;
         std::cout << "Pose transition animation completed" << std::endl;
@@ -111,37 +102,62 @@ void AnimationSystem::updatePoseTransition() {
 void AnimationSystem::updateBlink() {
     if (isBlinking) return;
     
-    auto now = std::chrono::steady_clock::now();
+    auto now = AvatarClock::now();
     if (now >= nextBlinkTime) {
         startBlink();
     }
 }
 
-SDL_Surface* AnimationSystem::getCurrentFrame() {
-    if (!isPlaying) {
-        return nullptr;
+AnimationSystem::TransitionFrame AnimationSystem::sampleTransition(const TransitionCurve& curve, int fromPose,
+                                                                   int toPose, float progress) {
+    TransitionFrame frame;
+    frame.pose = (progress < curve.switchPoint) ? fromPose : toPose;
+    frame.expression = 1; // transitions show the default expression
+    
+    frame.transform = DrawTransform();
+    frame.transform.offsetY = -curve.jumpHeight * std::sin(progress * static_cast<float>(M_PI));
+    if (curve.squash != 0.0f) {
+        // Compressed at take-off and landing, stretched at the top, roughly area preserving
+        float stretch = 1.0f - curve.squash * std::cos(progress * 2.0f * static_cast<float>(M_PI));
+        frame.transform.scaleY = stretch;
+        frame.transform.scaleX = 1.0f / stretch;
     }
     
-    switch (currentType) {
-        case AnimationType::POSE_TRANSITION: {
-            const auto& frames = resourceManager->getAnimationFrames(startPose, endPose);
-            if (currentFrame < frames.size()) {
-                return frames[currentFrame].get();
-            }
-            break;
-        }
-        case AnimationType::BLINK:
-            // Blink doesn't use pre-rendered frames, handled by getCurrentExpression
-            break;
-        case AnimationType::IDLE:
-        default:
-            return nullptr;
+    return frame;
+}
+
+AvatarSnapshot AnimationSystem::makeSnapshot(int pose, int baseExpression, bool flipped) const {
+    AvatarSnapshot snapshot;
+    snapshot.pose = pose;
+    snapshot.expression = getCurrentExpression(baseExpression);
+    snapshot.flipped = flipped;
+    snapshot.transitioning = isPlaying && currentType == AnimationType::POSE_TRANSITION;
+    snapshot.transitionFromPose = startPose;
+    snapshot.transitionStart = transitionStartTime;
+    snapshot.curve = transitionCurve;
+    return snapshot;
+}
+
+AvatarView AvatarSnapshot::evaluate(std::chrono::steady_clock::time_point now) const {
+    AvatarView view{pose, expression, flipped, DrawTransform()};
+    if (!isAnimatingAt(now)) {
+        return view;
     }
     
-    return nullptr;
+    auto elapsed = std::chrono::duration<float, std::milli>(now - transitionStart);
+    float progress = std::max(0.0f, elapsed.count() / static_cast<float>(curve.duration.count()));
+    
+    AnimationSystem::TransitionFrame frame = AnimationSystem::sampleTransition(curve, transitionFromPose, pose, progress);
+    view.pose = frame.pose;
+    view.expression = frame.expression;
+    view.transform = frame.transform;
+    return view;
 }
 
 int AnimationSystem::getCurrentExpression(int baseExpression) const {
+    if (mouthOpen) {
+        return mouthExpression;
+    }
     if (isBlinking) {
         // Map blink frames to expression 3 (blink eyes)
         return 3;
@@ -150,12 +166,26 @@ int AnimationSystem::getCurrentExpression(int baseExpression) const {
 }
 
 bool AnimationSystem::shouldBlink() {
-    auto now = std::chrono::steady_clock::now();
+    auto now = AvatarClock::now();
     return !isBlinking && now >= nextBlinkTime;
 }
 
+std::chrono::steady_clock::time_point AnimationSystem::getNextDeadline() const {
+    if (!isPlaying) {
+        return nextBlinkTime;
+    }
+    
+    if (currentType == AnimationType::POSE_TRANSITION) {
+        return transitionStartTime + transitionCurve.duration;
+    }
+    if (currentType == AnimationType::BLINK) {
+        return blinkStartTime + blinkDuration;
+    }
+    return nextBlinkTime;
+}
+
 void AnimationSystem::resetBlinkTimer() {
-    auto now = std::chrono::steady_clock::now();
+    auto now = AvatarClock::now();
     setRandomBlinkInterval();
     nextBlinkTime = now + blinkInterval + std::chrono::milliseconds(rand() % blinkVariation.count());
 }
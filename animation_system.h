@@ -2,10 +2,13 @@
 #define ANIMATION_SYSTEM_H
 
 #include <SDL2/SDL.h>
+#include <algorithm>
 #include <chrono>
 #include <memory>
 
-class ResourceManager;
+#include "renderer_manager.h"
+
+struct AvatarSnapshot;
 
 class AnimationSystem {
 public:
@@ -14,33 +17,50 @@ public:
         BLINK,
         IDLE
     };
+    
+    // Shape of a pose transition: a jump along a sine arc that switches images part way
+    struct TransitionCurve {
+        std::chrono::milliseconds duration{128};
+        float jumpHeight = 15.0f;  // pixels at the top of the arc
+        float switchPoint = 0.5f;  // progress at which the end pose is shown
+        float squash = 0.0f;       // 0 = rigid; e.g. 0.05 squashes at take-off/landing, stretches mid-air
+    };
+    
+    // What to draw for the current point of a transition; pose images are drawn
+    // from the atlas with the transform, so transitions allocate nothing
+    struct TransitionFrame {
+        int pose;
+        int expression;
+        DrawTransform transform;
+    };
 
 private:
-    ResourceManager* resourceManager;
-    
     // Current animation state
     AnimationType currentType;
     int startPose, endPose;
-    int currentFrame;
-    int totalFrames;
-    std::chrono::steady_clock::time_point frameStartTime;
     bool isPlaying;
     bool isLooping;
     
-    // Animation timing
-    const std::chrono::milliseconds frameDuration{16}; // ~60 FPS
-    const int blinkDurationFrames = 9; // 150ms at 60 FPS
+    // Pose transition timing (progress in [0, 1], sampled in update())
+    TransitionCurve transitionCurve;
+    std::chrono::steady_clock::time_point transitionStartTime;
+    float transitionProgress;
     
     // Blink state
     bool isBlinking;
     std::chrono::steady_clock::time_point blinkStartTime;
+    const std::chrono::milliseconds blinkDuration{150};
     std::chrono::steady_clock::time_point nextBlinkTime;
     int expressionBeforeBlink;
     const std::chrono::milliseconds blinkInterval{3000};
     const std::chrono::milliseconds blinkVariation{1000};
     
+    // Voice driven mouth (AudioInput); shown over the base expression and blinks
+    bool mouthOpen;
+    int mouthExpression;
+    
 public:
-    AnimationSystem(ResourceManager* rm);
+    AnimationSystem();
     
     // Animation control
     void playPoseTransition(int fromPose, int toPose);
@@ -48,24 +68,118 @@ public:
     void stopBlink();
     void update();
     
+    // Mouth opened or closed by the voice detector; while open the current
+    // expression is mouthExpression (no image has a blink and an open mouth,
+    // and a missed syllable shows more than a missed blink)
+    void setMouthOpen(bool open) { mouthOpen = open; }
+    void setMouthExpression(int expression) { mouthExpression = expression; }
+    bool isMouthOpen() const { return mouthOpen; }
+    
     // State queries
     bool isAnimationPlaying() const { return isPlaying; }
     bool isInBlinkState() const { return isBlinking; }
+    bool isTransitioning() const { return isPlaying && currentType == AnimationType::POSE_TRANSITION; }
     int getCurrentExpression(int baseExpression) const;
     
-    // Get current frame for rendering
-    SDL_Surface* getCurrentFrame();
+    // Immutable copy of the visible state for consumers on other threads
+    AvatarSnapshot makeSnapshot(int pose, int baseExpression, bool flipped) const;
+    
+    // Point of a transition at progress in [0, 1]
+    static TransitionFrame sampleTransition(const TransitionCurve& curve, int fromPose, int toPose, float progress);
+    
+    void setTransitionCurve(const TransitionCurve& curve) { transitionCurve = curve; }
     
     // Check if blink should trigger
     bool shouldBlink();
     
+    // Next time update() changes state: the end of a transition or blink,
+    // otherwise the next scheduled blink. Frames in between are the
+    // renderers' to schedule (FramePacer).
+    std::chrono::steady_clock::time_point getNextDeadline() const;
+    
     // Reset blink timer
     void resetBlinkTimer();
     
 private:
     void updateBlink();
-    void updatePoseTransition();
+    void updatePoseTransition(std::chrono::steady_clock::time_point now);
     void setRandomBlinkInterval();
 };
 
+// What is drawn at one instant
+struct AvatarView {
+    int pose;
+    int expression;
+    bool flipped;
+    DrawTransform transform;
+    
+    bool operator==(const AvatarView& other) const {
+        return pose == other.pose && expression == other.expression &&
+               flipped == other.flipped && transform == other.transform;
+    }
+};
+
+// Avatar state handed from the main thread to the output thread. A transition
+// travels as its start time and curve, so the consumer samples it at its own
+// frame times instead of the producer's. Trivially copyable.
+struct AvatarSnapshot {
+    int pose;
+    int expression; // effective expression (blink applied)
+    bool flipped;
+    bool transitioning;
+    int transitionFromPose;
+    std::chrono::steady_clock::time_point transitionStart;
+    AnimationSystem::TransitionCurve curve;
+    
+    // View at time now; the plain pose once the transition has run its course
+    AvatarView evaluate(std::chrono::steady_clock::time_point now) const;
+    
+    bool isAnimatingAt(std::chrono::steady_clock::time_point now) const {
+        return transitioning && now < transitionStart + curve.duration;
+    }
+    
+    bool operator==(const AvatarSnapshot& other) const {
+        return pose == other.pose && expression == other.expression && flipped == other.flipped &&
+               transitioning == other.transitioning &&
+               (!transitioning || (transitionFromPose == other.transitionFromPose &&
+                                   transitionStart == other.transitionStart));
+    }
+    bool operator!=(const AvatarSnapshot& other) const { return !(*this == other); }
+};
+
+// Every avatar of the output scene, in drawing order (later ones in front).
+// Fixed capacity so it stays trivially copyable for the triple buffer.
+struct SceneSnapshot {
+    static constexpr int MAX_AVATARS = 32;
+    
+    AvatarSnapshot avatars[MAX_AVATARS];
+    int count = 0;
+    
+    bool isAnimatingAt(std::chrono::steady_clock::time_point now) const {
+        for (int i = 0; i < count; i++) {
+            if (avatars[i].isAnimatingAt(now)) return true;
+        }
+        return false;
+    }
+    
+    // Earliest end of a transition still running at now, max() if none
+    std::chrono::steady_clock::time_point nextTransitionEnd(std::chrono::steady_clock::time_point now) const {
+        auto end = std::chrono::steady_clock::time_point::max();
+        for (int i = 0; i < count; i++) {
+            if (avatars[i].isAnimatingAt(now)) {
+                end = std::min(end, avatars[i].transitionStart + avatars[i].curve.duration);
+            }
+        }
+        return end;
+    }
+    
+    bool operator==(const SceneSnapshot& other) const {
+        if (count != other.count) return false;
+        for (int i = 0; i < count; i++) {
+            if (avatars[i] != other.avatars[i]) return false;
+        }
+        return true;
+    }
+};
+
 #endif // ANIMATION_SYSTEM_H
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "asset_loader.h"
+#include <algorithm>
+
+AssetLoader::AssetLoader(AssetSource* assetSource)
+    : source(assetSource), stopping(false) {
+    unsigned count = std::max(1u, std::min(MAX_WORKERS, std::thread::hardware_concurrency()));
+    for (unsigned i = 0; i < count; i++) {
+        workers.emplace_back(&AssetLoader::workerLoop, this);
+    }
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // Nobody took these
+    for (auto& image : completed) {
+        if (image.surface) SDL_FreeSurface(image.surface);
+    }
+}
+
+void AssetLoader::request(const Key& key) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (std::find(queue.begin(), queue.end(), key) != queue.end() || inFlight.count(key)) {
+            return;
+        }
+        queue.push_back(key);
+    }
+    workAvailable.notify_one();
+}
+
+bool AssetLoader::finish(const Key& key) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto queued = std::find(queue.begin(), queue.end(), key);
+    if (queued != queue.end()) {
+        // Needed now: decode here rather than wait for a worker to get to it
+        queue.erase(queued);
+        inFlight.insert(key);
+        lock.unlock();
+        complete(key, source->loadSurface(key.first, key.second));
+        return true;
+    }
+
+    if (inFlight.count(key)) {
+        loadFinished.wait(lock, [&] { return inFlight.count(key) == 0; });
+        return true;
+    }
+
+    return std::any_of(completed.begin(), completed.end(), [&](const LoadedImage& image) {
+        return image.key == key;
+    });
+}
+
+void AssetLoader::takeCompleted(std::vector<LoadedImage>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    out.insert(out.end(), completed.begin(), completed.end());
+    completed.clear();
+}
+
+void AssetLoader::workerLoop() {
+    while (true) {
+        Key key;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            key = queue.front();
+            queue.pop_front();
+            inFlight.insert(key);
+        }
+
+        complete(key, source->loadSurface(key.first, key.second));
+    }
+}
+
+void AssetLoader::complete(const Key& key, SDL_Surface* surface) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight.erase(key);
+        completed.push_back({key, surface});
+    }
+    loadFinished.notify_all();
+
+    if (completionCallback) {
+        completionCallback();
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "asset_source.h"
+
+// Decodes images on a small worker pool so no frame waits on I/O or PNG
+// decode. Requests are served in order; decoded surfaces go to a completion
+// queue that the owner drains (ResourceManager) and uploads on the render
+// threads. The source is borrowed and must outlive the loader.
+class AssetLoader {
+public:
+    using Key = std::pair<int, int>; // (pose, expression)
+
+    struct LoadedImage {
+        Key key;
+        SDL_Surface* surface; // owned by whoever takes it; nullptr if the image is missing
+    };
+
+private:
+    AssetSource* source;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable loadFinished;
+    std::deque<Key> queue;
+    std::set<Key> inFlight;
+    std::vector<LoadedImage> completed;
+    bool stopping;
+
+    // Called from a worker after each completion (e.g. to wake the main loop)
+    std::function<void()> completionCallback;
+
+    static constexpr unsigned MAX_WORKERS = 4;
+
+public:
+    explicit AssetLoader(AssetSource* assetSource);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Set before the first request
+    void setCompletionCallback(std::function<void()> callback) { completionCallback = std::move(callback); }
+
+    // Queue a decode (the caller skips images it already has)
+    void request(const Key& key);
+
+    // Make sure key is in the completion queue: a queued request is decoded on
+    // the calling thread, one a worker is decoding is waited for. False if key
+    // was never requested.
+    bool finish(const Key& key);
+
+    // Move finished images into out
+    void takeCompleted(std::vector<LoadedImage>& out);
+
+private:
+    void workerLoop();
+    void complete(const Key& key, SDL_Surface* surface);
+};
+
+#endif // ASSET_LOADER_H
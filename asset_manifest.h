@@ -0,0 +1,100 @@
+// Generated by generate_embedded_models.py from model/ - do not edit.
+// Regenerate with: make manifest
+#ifndef ASSET_MANIFEST_H
+#define ASSET_MANIFEST_H
+
+#include <SDL2/SDL.h>
+
+namespace manifest {
+
+struct PoseInfo {
+    int id;
+    const char* name;    // "" if the pose has no display name
+    int expressionCount; // expressions 1..expressionCount
+    int width;           // largest image of the pose
+    int height;
+};
+
+struct KeyBinding {
+    SDL_Keycode key;
+    int pose;
+    int expression;
+};
+
+inline constexpr PoseInfo POSES[] = {
+    {1, "santai", 4, 689, 620},
+    {3, "satu tangan", 4, 689, 620},
+    {4, "belakang tangan", 4, 689, 620},
+    {5, "", 4, 689, 620},
+    {6, "wawa", 4, 689, 620},
+};
+inline constexpr int POSE_COUNT = 5;
+inline constexpr int MAX_POSE_ID = 6;
+inline constexpr int MAX_EXPRESSIONS = 4;
+
+inline constexpr KeyBinding KEY_BINDINGS[] = {
+    {SDLK_q, 1, 2},
+    {SDLK_a, 1, 3},
+    {SDLK_z, 1, 4},
+    {SDLK_w, 3, 2},
+    {SDLK_s, 3, 3},
+    {SDLK_x, 3, 4},
+    {SDLK_e, 4, 2},
+    {SDLK_d, 4, 3},
+    {SDLK_c, 4, 4},
+    {SDLK_r, 6, 2},
+    {SDLK_f, 6, 3},
+    {SDLK_v, 6, 4},
+};
+inline constexpr int KEY_BINDING_COUNT = 12;
+
+// Index into POSES by pose id, -1 for ids without images
+inline constexpr int POSE_INDEX[MAX_POSE_ID + 1] = {-1, 0, -1, 1, 2, 3, 4};
+
+// Dense image slots: every (pose, expression) of the manifest has an index in
+// [0, SLOT_COUNT), so per-image state can live in flat arrays
+inline constexpr int SLOT_COUNT = POSE_COUNT * MAX_EXPRESSIONS;
+
+constexpr const PoseInfo* findPose(int pose) {
+    return (pose >= 0 && pose <= MAX_POSE_ID && POSE_INDEX[pose] >= 0) ? &POSES[POSE_INDEX[pose]] : nullptr;
+}
+
+// Slot of an image, -1 if the manifest does not know it
+constexpr int slotOf(int pose, int expression) {
+    const PoseInfo* info = findPose(pose);
+    if (!info || expression < 1 || expression > info->expressionCount) {
+        return -1;
+    }
+    return POSE_INDEX[pose] * MAX_EXPRESSIONS + expression - 1;
+}
+
+// Bindings are ASCII keys: binding index per key code, -1 if unbound
+inline constexpr int KEY_TABLE_SIZE = 128;
+
+struct KeyTable {
+    signed char binding[KEY_TABLE_SIZE];
+};
+
+constexpr KeyTable makeKeyTable() {
+    KeyTable table = {};
+    for (int key = 0; key < KEY_TABLE_SIZE; key++) {
+        table.binding[key] = -1;
+    }
+    for (int i = 0; i < KEY_BINDING_COUNT; i++) {
+        table.binding[KEY_BINDINGS[i].key] = static_cast<signed char>(i);
+    }
+    return table;
+}
+
+inline constexpr KeyTable KEY_TABLE = makeKeyTable();
+
+constexpr const KeyBinding* findBinding(SDL_Keycode key) {
+    return (key >= 0 && key < KEY_TABLE_SIZE && KEY_TABLE.binding[key] >= 0) ? &KEY_BINDINGS[KEY_TABLE.binding[key]]
+                                                                             : nullptr;
+}
+
+static_assert(KEY_BINDING_COUNT < 128, "binding index must fit a signed char");
+
+} // namespace manifest
+
+#endif // ASSET_MANIFEST_H
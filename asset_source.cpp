@@ -0,0 +1,305 @@
+#include "asset_source.h"
+#include "embedded_models.h"
+#include <SDL2/SDL_image.h>
+#include <iostream>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef CHIEMODEL_WITH_LZ4
+#include <lz4.h>
+#endif
+
+bool AssetSource::parseImageName(const std::string& name, int& pose, int& expression) {
+    int consumed = 0;
+    if (sscanf(name.c_str(), "%d-%d.png%n", &pose, &expression, &consumed) != 2) {
+        return false;
+    }
+    return static_cast<size_t>(consumed) == name.size();
+}
+
+FilesystemAssetSource::FilesystemAssetSource(const std::string& modelDirectory)
+    : directory(modelDirectory) {
+}
+
+SDL_Surface* FilesystemAssetSource::loadSurface(int pose, int expression) {
+    std::string fullPath = directory + "/" + imageName(pose, expression);
+
+    if (!std::filesystem::exists(fullPath)) {
+        return nullptr;
+    }
+
+    SDL_Surface* surface = IMG_Load(fullPath.c_str());
+    if (!surface) {
+        std::cerr << "Failed to load image: " << fullPath << " Error: " << IMG_GetError() << std::endl;
+    }
+    return surface;
+}
+
+std::vector<std::pair<int, int>> FilesystemAssetSource::listImages() const {
+    std::vector<std::pair<int, int>> result;
+    std::error_code error;
+    for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+        int pose, expression;
+        if (file.is_regular_file() && parseImageName(file.path().filename().string(), pose, expression)) {
+            result.emplace_back(pose, expression);
+        }
+    }
+    return result;
+}
+
+EmbeddedAssetSource::EmbeddedAssetSource(const EmbeddedImage* embeddedImages, int count)
+    : images(embeddedImages), imageCount(count) {
+}
+
+SDL_Surface* EmbeddedAssetSource::loadSurface(int pose, int expression) {
+    std::string name = imageName(pose, expression);
+
+    for (int i = 0; i < imageCount; i++) {
+        if (name != images[i].name) {
+            continue;
+        }
+
+        // Decode directly from the binary's read-only data, no temp files
+        SDL_RWops* rw = SDL_RWFromConstMem(images[i].data, static_cast<int>(images[i].size));
+        if (!rw) {
+            std::cerr << "Failed to open embedded image " << name << ": " << SDL_GetError() << std::endl;
+            return nullptr;
+        }
+
+        SDL_Surface* surface = IMG_Load_RW(rw, 1);
+        if (!surface) {
+            std::cerr << "Failed to decode embedded image " << name << ": " << IMG_GetError() << std::endl;
+        }
+        return surface;
+    }
+
+    return nullptr;
+}
+
+std::vector<std::pair<int, int>> EmbeddedAssetSource::listImages() const {
+    std::vector<std::pair<int, int>> result;
+    for (int i = 0; i < imageCount; i++) {
+        int pose, expression;
+        if (parseImageName(images[i].name, pose, expression)) {
+            result.emplace_back(pose, expression);
+        }
+    }
+    return result;
+}
+
+namespace {
+
+// On-disk layout, see generate_asset_pack.py
+const char PACK_MAGIC[8] = {'C', 'H', 'I', 'E', 'P', 'A', 'K', '\0'};
+const uint32_t PACK_VERSION = 2;
+
+struct PackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t pixelFormat;
+    uint32_t indexOffset;
+    uint32_t alignment;
+    uint8_t reserved[36];
+};
+
+const size_t PACK_ENTRY_SIZE = 56;
+static_assert(sizeof(PackHeader) == 64, "pack header layout");
+static_assert(sizeof(PackAssetSource::Entry) == PACK_ENTRY_SIZE, "pack entry layout");
+
+} // namespace
+
+PackAssetSource::PackAssetSource()
+    : mapping(nullptr), mappingSize(0), pixelFormat(SDL_PIXELFORMAT_UNKNOWN) {
+}
+
+PackAssetSource::~PackAssetSource() {
+    close();
+}
+
+bool PackAssetSource::open(const std::string& packPath) {
+    close();
+    path = packPath;
+
+    int fd = ::open(packPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open asset pack " << packPath << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(PackHeader)) {
+        std::cerr << "Asset pack is too small: " << packPath << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    mappingSize = static_cast<size_t>(info.st_size);
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map asset pack " << packPath << ": " << strerror(errno) << std::endl;
+        mapping = nullptr;
+        mappingSize = 0;
+        return false;
+    }
+
+    const Uint8* base = static_cast<const Uint8*>(mapping);
+    PackHeader header;
+    memcpy(&header, base, sizeof(header));
+
+    if (memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header.version != PACK_VERSION) {
+        std::cerr << "Not a version " << PACK_VERSION << " asset pack (rebuild it with make pack): " << packPath << std::endl;
+        close();
+        return false;
+    }
+
+    // Raw entries are wrapped in place as 32 bpp surfaces
+    if (SDL_BITSPERPIXEL(header.pixelFormat) != 32) {
+        std::cerr << "Asset pack pixel format is not 32 bits per pixel: " << packPath << std::endl;
+        close();
+        return false;
+    }
+
+    size_t indexEnd = header.indexOffset + static_cast<size_t>(header.entryCount) * PACK_ENTRY_SIZE;
+    if (indexEnd > mappingSize) {
+        std::cerr << "Asset pack index is truncated: " << packPath << std::endl;
+        close();
+        return false;
+    }
+
+    entries.resize(header.entryCount);
+    if (header.entryCount > 0) {
+        memcpy(entries.data(), base + header.indexOffset, header.entryCount * PACK_ENTRY_SIZE);
+    }
+
+    for (const auto& entry : entries) {
+        // A patch must lie inside a base image of its pose that is stored whole
+        bool patchValid = entry.baseExpression == 0;
+        if (!patchValid) {
+            const Entry* base = findEntry(entry.pose, entry.baseExpression);
+            patchValid = base && base->baseExpression == 0 &&
+                         static_cast<uint64_t>(entry.patchX) + entry.width <= base->width &&
+                         static_cast<uint64_t>(entry.patchY) + entry.height <= base->height;
+        }
+        // SDL reads pitch * height bytes at offset of a raw entry; the bound
+        // is written so it cannot wrap
+        bool sizeValid = entry.storedSize <= mappingSize && entry.offset <= mappingSize - entry.storedSize &&
+                         entry.pitch >= static_cast<uint64_t>(entry.width) * 4 &&
+                         static_cast<uint64_t>(entry.pitch) * entry.height == entry.rawSize &&
+                         (entry.compression != 0 || entry.storedSize == entry.rawSize);
+        if (!patchValid || !sizeValid) {
+            std::cerr << "Asset pack entry " << entry.pose << "-" << entry.expression
+                      << " is corrupt: " << packPath << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    pixelFormat = header.pixelFormat;
+    return true;
+}
+
+void PackAssetSource::close() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+    entries.clear();
+}
+
+const PackAssetSource::Entry* PackAssetSource::findEntry(int pose, int expression) const {
+    for (const auto& entry : entries) {
+        if (entry.pose == pose && entry.expression == expression) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+SDL_Surface* PackAssetSource::loadSurface(int pose, int expression) {
+    const Entry* entry = findEntry(pose, expression);
+    if (!entry) {
+        return nullptr;
+    }
+
+    const Uint8* data = static_cast<const Uint8*>(mapping) + entry->offset;
+    if (entry->compression != 0) {
+        return decompressEntry(*entry, data);
+    }
+
+    // Zero copy: the surface points into the read-only mapping.
+    // SDL never writes to image surfaces here; they are only uploaded or blitted from.
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(const_cast<Uint8*>(data),
+                                                              entry->width, entry->height, 32,
+                                                              entry->pitch, pixelFormat);
+    if (!surface) {
+        std::cerr << "Failed to wrap packed image " << pose << "-" << expression << ": " << SDL_GetError() << std::endl;
+    }
+    return surface;
+}
+
+bool PackAssetSource::getPatch(int pose, int expression, Patch& patch) const {
+    const Entry* entry = findEntry(pose, expression);
+    if (!entry || entry->baseExpression == 0) {
+        return false;
+    }
+    patch.baseExpression = entry->baseExpression;
+    patch.rect = {static_cast<int>(entry->patchX), static_cast<int>(entry->patchY),
+                  static_cast<int>(entry->width), static_cast<int>(entry->height)};
+    return true;
+}
+
+std::vector<std::pair<int, int>> PackAssetSource::listImages() const {
+    std::vector<std::pair<int, int>> result;
+    for (const auto& entry : entries) {
+        result.emplace_back(entry.pose, entry.expression);
+    }
+    return result;
+}
+
+SDL_Surface* PackAssetSource::decompressEntry(const Entry& entry, const Uint8* data) {
+#ifdef CHIEMODEL_WITH_LZ4
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, entry.width, entry.height, 32, pixelFormat);
+    if (!surface) {
+        std::cerr << "Failed to allocate surface for packed image: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+
+    // Decompress straight into the surface unless SDL picked a different pitch
+    std::vector<Uint8> scratch;
+    Uint8* target = static_cast<Uint8*>(surface->pixels);
+    if (static_cast<uint32_t>(surface->pitch) != entry.pitch) {
+        scratch.resize(entry.rawSize);
+        target = scratch.data();
+    }
+
+    int result = LZ4_decompress_safe(reinterpret_cast<const char*>(data), reinterpret_cast<char*>(target),
+                                     static_cast<int>(entry.storedSize), static_cast<int>(entry.rawSize));
+    if (result != static_cast<int>(entry.rawSize)) {
+        std::cerr << "Failed to decompress packed image " << entry.pose << "-" << entry.expression << std::endl;
+        SDL_FreeSurface(surface);
+        return nullptr;
+    }
+
+    if (!scratch.empty()) {
+        for (uint32_t y = 0; y < entry.height; y++) {
+            memcpy(static_cast<Uint8*>(surface->pixels) + y * surface->pitch,
+                   scratch.data() + y * entry.pitch, entry.width * 4);
+        }
+    }
+    return surface;
+#else
+    (void)data;
+    std::cerr << "Packed image " << entry.pose << "-" << entry.expression
+              << " is LZ4 compressed; rebuild with LZ4=1" << std::endl;
+    return nullptr;
+#endif
+}
@@ -0,0 +1,131 @@
+#ifndef ASSET_SOURCE_H
+#define ASSET_SOURCE_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+struct EmbeddedImage;
+
+// Where ResourceManager gets decoded model images from
+class AssetSource {
+public:
+    virtual ~AssetSource() = default;
+
+    // Decode image for pose/expression; caller owns the surface, nullptr if missing.
+    // Called concurrently from AssetLoader workers for different images.
+    virtual SDL_Surface* loadSurface(int pose, int expression) = 0;
+
+    // Human readable location for log messages
+    virtual std::string describe() const = 0;
+
+    // Every (pose, expression) this source can load, used to build texture atlases
+    virtual std::vector<std::pair<int, int>> listImages() const = 0;
+
+    // Directory whose files this source reads on every load, for hot reload (empty if none)
+    virtual std::string getWatchDirectory() const { return std::string(); }
+
+    // An expression stored as a face patch: loadSurface returns only the pixels
+    // inside rect (image coordinates), which replace that part of
+    // baseExpression's image of the same pose; outside it the two are identical.
+    struct Patch {
+        int baseExpression;
+        SDL_Rect rect;
+    };
+
+    // False for images stored whole (every image, for most sources)
+    virtual bool getPatch(int pose, int expression, Patch& patch) const {
+        (void)pose;
+        (void)expression;
+        (void)patch;
+        return false;
+    }
+
+    // Inverse of imageName; false for anything that is not <pose>-<expression>.png
+    static bool parseImageName(const std::string& name, int& pose, int& expression);
+
+protected:
+    static std::string imageName(int pose, int expression) {
+        return std::to_string(pose) + "-" + std::to_string(expression) + ".png";
+    }
+};
+
+// <pose>-<expression>.png files in a model directory
+class FilesystemAssetSource : public AssetSource {
+private:
+    std::string directory;
+
+public:
+    explicit FilesystemAssetSource(const std::string& modelDirectory);
+
+    SDL_Surface* loadSurface(int pose, int expression) override;
+    std::string describe() const override { return directory; }
+    std::vector<std::pair<int, int>> listImages() const override;
+    std::string getWatchDirectory() const override { return directory; }
+};
+
+// PNGs compiled into the binary (embedded_models.cpp), decoded straight from memory
+class EmbeddedAssetSource : public AssetSource {
+private:
+    const EmbeddedImage* images;
+    int imageCount;
+
+public:
+    EmbeddedAssetSource(const EmbeddedImage* embeddedImages, int count);
+
+    SDL_Surface* loadSurface(int pose, int expression) override;
+    std::string describe() const override { return "embedded images"; }
+    std::vector<std::pair<int, int>> listImages() const override;
+};
+
+// Pre-decoded pack built by generate_asset_pack.py. The file is mmapped and
+// raw entries are wrapped as SDL surfaces in place: no decode, no copy.
+// LZ4 entries (built with --lz4) need CHIEMODEL_WITH_LZ4 and are decompressed.
+// Expressions are stored as cropped face patches over their pose's base image
+// unless the pack was built with --no-patches.
+class PackAssetSource : public AssetSource {
+public:
+    struct Entry {
+        int32_t pose;
+        int32_t expression;
+        uint32_t width;
+        uint32_t height;
+        uint32_t pitch;
+        uint32_t compression;
+        uint64_t offset;
+        uint32_t storedSize;
+        uint32_t rawSize;
+        int32_t baseExpression; // 0: stored whole, else a patch over this expression
+        uint32_t patchX;
+        uint32_t patchY;
+        uint32_t reserved;
+    };
+
+private:
+    std::string path;
+    void* mapping;
+    size_t mappingSize;
+    Uint32 pixelFormat;
+    std::vector<Entry> entries;
+
+public:
+    PackAssetSource();
+    ~PackAssetSource() override;
+
+    bool open(const std::string& packPath);
+
+    SDL_Surface* loadSurface(int pose, int expression) override;
+    std::string describe() const override { return path; }
+    std::vector<std::pair<int, int>> listImages() const override;
+    bool getPatch(int pose, int expression, Patch& patch) const override;
+
+private:
+    const Entry* findEntry(int pose, int expression) const;
+    void close();
+    SDL_Surface* decompressEntry(const Entry& entry, const Uint8* data);
+};
+
+#endif // ASSET_SOURCE_H
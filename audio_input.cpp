@@ -0,0 +1,190 @@
+#include "audio_input.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static_assert(std::atomic<float>::is_always_lock_free, "the audio callback must not lock");
+static_assert(std::atomic<int64_t>::is_always_lock_free, "the audio callback must not lock");
+
+VoiceActivityDetector::VoiceActivityDetector(const Settings& detectorSettings)
+    : settings(detectorSettings), holdSamples(0), heldSamples(0), open(false) {
+}
+
+void VoiceActivityDetector::setSampleRate(int rate) {
+    holdSamples = static_cast<int>(static_cast<int64_t>(rate) * settings.minHold.count() / 1000);
+    heldSamples = holdSamples; // the first onset opens at once
+}
+
+bool VoiceActivityDetector::update(float levelDb, int count) {
+    // Saturates at the hold time, so hours in one state cannot overflow it
+    heldSamples = std::min(heldSamples + count, holdSamples);
+    if (heldSamples < holdSamples) {
+        return false;
+    }
+
+    bool next = open ? levelDb >= settings.closeDb : levelDb > settings.openDb;
+    if (next == open) {
+        return false;
+    }
+    open = next;
+    heldSamples = 0;
+    return true;
+}
+
+float meanSquare(const float* samples, int count) {
+    if (count <= 0) {
+        return 0.0f;
+    }
+
+    int i = 0;
+    float sum = 0.0f;
+#if defined(__SSE2__)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_loadu_ps(samples + i);
+        acc = _mm_add_ps(acc, _mm_mul_ps(v, v));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__ARM_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t v = vld1q_f32(samples + i);
+        acc = vmlaq_f32(acc, v, v);
+    }
+    sum = (vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1)) + (vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3));
+#endif
+    for (; i < count; i++) {
+        sum += samples[i] * samples[i];
+    }
+    return sum / static_cast<float>(count);
+}
+
+AudioInput::AudioInput(const std::string& captureDevice, const VoiceActivityDetector::Settings& settings)
+    : deviceName(captureDevice)
+    , detector(settings)
+    , device(0), audioInitialized(false), wakeFd(-1)
+    , running(false)
+    , mouthOpen(false), level(-100.0f), changeTime(0) {
+}
+
+AudioInput::~AudioInput() {
+    stop();
+}
+
+bool AudioInput::start() {
+    if (running) return true;
+
+    // Counted by SDL, so this works whatever the main loop initialized
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+        std::cerr << "Failed to initialize audio: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    audioInitialized = true;
+
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        std::cerr << "Failed to create audio wake event: " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+
+    // Mono float at a fixed rate; SDL converts whatever the device delivers
+    SDL_AudioSpec desired;
+    SDL_zero(desired);
+    desired.freq = SAMPLE_RATE;
+    desired.format = AUDIO_F32SYS;
+    desired.channels = 1;
+    desired.samples = BLOCK_SAMPLES;
+    desired.callback = captureCallback;
+    desired.userdata = this;
+
+    SDL_AudioSpec obtained;
+    device = SDL_OpenAudioDevice(deviceName.empty() ? nullptr : deviceName.c_str(), 1, &desired, &obtained, 0);
+    if (device == 0) {
+        std::cerr << "Failed to open capture device " << (deviceName.empty() ? "(default)" : deviceName)
+                  << ": " << SDL_GetError() << std::endl;
+        stop();
+        return false;
+    }
+    detector.setSampleRate(obtained.freq);
+
+    running = true;
+    notifyThread = std::thread(&AudioInput::notifyLoop, this);
+    SDL_PauseAudioDevice(device, 0);
+    std::cout << "Microphone: " << (deviceName.empty() ? "default capture device" : deviceName) << ", "
+              << obtained.freq << " Hz, " << obtained.samples << " samples per block" << std::endl;
+    return true;
+}
+
+void AudioInput::stop() {
+    // Closing waits for a callback in progress, so nothing writes wakeFd after this
+    if (device != 0) {
+        SDL_CloseAudioDevice(device);
+        device = 0;
+    }
+    running = false;
+    if (notifyThread.joinable()) {
+        notifyThread.join();
+    }
+    if (wakeFd >= 0) {
+        ::close(wakeFd);
+        wakeFd = -1;
+    }
+    if (audioInitialized) {
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        audioInitialized = false;
+    }
+}
+
+void SDLCALL AudioInput::captureCallback(void* userdata, Uint8* stream, int length) {
+    static_cast<AudioInput*>(userdata)->process(reinterpret_cast<const float*>(stream),
+                                                length / static_cast<int>(sizeof(float)));
+}
+
+void AudioInput::process(const float* samples, int count) {
+    // Devices may deliver more than asked for; the detector steps in blocks either way
+    bool changed = false;
+    float latest = level.load(std::memory_order_relaxed);
+    for (int offset = 0; offset < count; offset += BLOCK_SAMPLES) {
+        int blockSamples = std::min(BLOCK_SAMPLES, count - offset);
+        latest = 10.0f * std::log10(meanSquare(samples + offset, blockSamples) + 1e-10f);
+        changed = detector.update(latest, blockSamples) || changed;
+    }
+    level.store(latest, std::memory_order_relaxed);
+    if (!changed) {
+        return;
+    }
+
+    // The time is stored first; the release store publishes both
+    changeTime.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    mouthOpen.store(detector.isOpen(), std::memory_order_release);
+    uint64_t one = 1;
+    ssize_t written = ::write(wakeFd, &one, sizeof(one)); // never blocks; only a full counter fails
+    (void)written;
+}
+
+void AudioInput::notifyLoop() {
+    while (running) {
+        pollfd fd = {wakeFd, POLLIN, 0};
+        if (poll(&fd, 1, 100) <= 0) {
+            continue;
+        }
+        uint64_t count;
+        if (::read(wakeFd, &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count)) && wakeCallback) {
+            wakeCallback();
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef AUDIO_INPUT_H
+#define AUDIO_INPUT_H
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Mouth state from the levels of successive audio blocks. It opens above
+// openDb and closes below closeDb; levels in between keep the current state,
+// so noise near one threshold cannot flap the mouth. Each state is also held
+// for at least minHold, so flaps stay visible at video frame rates.
+class VoiceActivityDetector {
+public:
+    struct Settings {
+        float openDb = -35.0f; // RMS level, dB relative to full scale
+        float closeDb = -43.0f;
+        std::chrono::milliseconds minHold{60};
+    };
+
+private:
+    Settings settings;
+    int holdSamples; // minHold at the sample rate
+    int heldSamples; // time spent in the current state
+    bool open;
+
+public:
+    explicit VoiceActivityDetector(const Settings& detectorSettings);
+
+    void setSampleRate(int rate);
+
+    // One block of count samples measured at levelDb; true if the state changed
+    bool update(float levelDb, int count);
+    bool isOpen() const { return open; }
+};
+
+// Mean of the squared samples (SSE2 or NEON where the target has them)
+float meanSquare(const float* samples, int count);
+
+// Microphone input for voice driven expressions. An SDL capture device
+// delivers mono float blocks to a callback on SDL's audio thread, which
+// measures each block's RMS level and runs the detector. The callback never
+// allocates or locks: it stores atomics and, when the mouth opens or closes,
+// writes an eventfd. A notify thread waiting on that fd calls the wake
+// callback (free to lock, e.g. SDL_PushEvent), so the main loop applies the
+// change before its next frame.
+class AudioInput {
+private:
+    std::string deviceName; // empty = default capture device
+    VoiceActivityDetector detector; // audio thread only once started
+    SDL_AudioDeviceID device;
+    bool audioInitialized;
+    int wakeFd;
+    std::function<void()> wakeCallback;
+
+    std::thread notifyThread;
+    std::atomic<bool> running;
+
+    std::atomic<bool> mouthOpen;
+    std::atomic<float> level;        // dBFS of the latest block
+    std::atomic<int64_t> changeTime; // steady_clock ticks of the latest open/close
+
+    static constexpr int SAMPLE_RATE = 48000;
+    static constexpr int BLOCK_SAMPLES = 256; // ~5 ms, the detector's time step
+
+public:
+    AudioInput(const std::string& captureDevice, const VoiceActivityDetector::Settings& settings);
+    ~AudioInput();
+
+    AudioInput(const AudioInput&) = delete;
+    AudioInput& operator=(const AudioInput&) = delete;
+
+    // Called on the notify thread whenever the mouth state changed (set before start)
+    void setWakeCallback(std::function<void()> callback) { wakeCallback = std::move(callback); }
+
+    // Open the capture device and start measuring; false if there is none
+    bool start();
+    void stop();
+
+    bool isMouthOpen() const { return mouthOpen.load(std::memory_order_acquire); }
+    float getLevel() const { return level.load(std::memory_order_relaxed); }
+
+    // When the current mouth state was detected (read after isMouthOpen)
+    std::chrono::steady_clock::time_point getChangeTime() const {
+        return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(changeTime.load(std::memory_order_relaxed)));
+    }
+
+private:
+    static void SDLCALL captureCallback(void* userdata, Uint8* stream, int length);
+    void process(const float* samples, int count);
+    void notifyLoop();
+};
+
+#endif // AUDIO_INPUT_H
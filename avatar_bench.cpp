@@ -0,0 +1,365 @@
+// Deterministic engine benchmark: replays a scripted input trace against a
+// headless, single-threaded avatar system on a simulated 60 Hz clock and
+// reports startup time, frame times, peak RSS, texture memory and heap
+// allocations per frame as one JSON object.
+//
+// Everything but the timings (frames, cache, memory, allocations) is a pure
+// function of the trace and the model set, so CI can diff those fields. That
+// needs the default warm start: with --cold-start images arrive from the
+// loader threads whenever they finish and the cache counters follow.
+//
+// Trace lines are "<time_ms> <command>", commands being a key ("q", "g", ...),
+// "tab" (next avatar), "blink" or "quit"; '#' starts a comment. Lines must be
+// in time order; a trace without "quit" ends one second after its last event.
+//
+// --avatars <n> runs the stress scenario: n avatars in one output, each
+// blinking on its own schedule, driven by the built-in crowd trace unless
+// --trace is given. Frame times against the single-avatar run show how the
+// cost grows with the scene. With --memory-budget too small for the scene's
+// images (make benchmark-crowd-budget) the avatars compete for atlas slots;
+// evictions and texture_bytes show how the budget holds.
+
+#include "optimized_avatar_system.h"
+#include "avatar_clock.h"
+#include "stats.h"
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Heap allocations made by the main thread (the one that runs the frames);
+// loader threads would make the count depend on scheduling
+static thread_local uint64_t threadAllocations = 0;
+
+void* operator new(std::size_t size) {
+    threadAllocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+struct TraceEvent {
+    int64_t timeMs;
+    std::string command;
+};
+
+// Pose switches across all four poses, same-key expression toggles, flips and
+// forced blinks, with idle stretches where only scheduled blinks run
+static const char* BUILTIN_TRACE = R"(
+500 w
+1000 s
+1500 s
+2000 x
+2500 g
+3000 e
+3500 e
+4000 blink
+4500 d
+5000 g
+5500 r
+6000 f
+6500 f
+7000 v
+7500 q
+8000 a
+8500 blink
+9000 z
+9500 z
+10000 g
+12000 w
+12150 e
+12300 r
+12450 q
+15000 quit
+)";
+
+// Pose switches hopping from avatar to avatar, then flips, expression toggles
+// and blinks on several of them, while every avatar keeps its own blink
+// schedule (events 120 ms apart, past the key cooldown)
+static const char* CROWD_TRACE = R"(
+500 w
+620 tab
+740 e
+860 tab
+980 r
+1100 tab
+1220 w
+1340 tab
+1460 e
+1580 tab
+1700 r
+1820 tab
+1940 w
+2060 tab
+2180 e
+3000 g
+3120 tab
+3240 tab
+3360 g
+3480 tab
+3600 tab
+3720 g
+4500 s
+4620 tab
+4740 d
+4860 tab
+4980 f
+5100 tab
+5220 s
+6000 blink
+6120 tab
+6240 blink
+6360 tab
+6480 blink
+8000 q
+8120 tab
+8240 q
+8360 tab
+8480 q
+8600 tab
+8720 q
+12000 quit
+)";
+
+static bool parseTrace(std::istream& in, std::vector<TraceEvent>& events) {
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        auto comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        std::istringstream fields(line);
+        TraceEvent event;
+        if (!(fields >> event.timeMs)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+            std::cerr << "Trace line " << lineNumber << ": expected <time_ms> <command>" << std::endl;
+            return false;
+        }
+        if (!(fields >> event.command) ||
+            (event.command.size() != 1 && event.command != "tab" && event.command != "blink" &&
+             event.command != "quit")) {
+            std::cerr << "Trace line " << lineNumber << ": unknown command" << std::endl;
+            return false;
+        }
+        if (!events.empty() && event.timeMs < events.back().timeMs) {
+            std::cerr << "Trace line " << lineNumber << ": events out of order" << std::endl;
+            return false;
+        }
+        events.push_back(event);
+    }
+    return true;
+}
+
+static void pushKey(SDL_Keycode key) {
+    SDL_Event event = {};
+    event.type = SDL_KEYDOWN;
+    event.key.keysym.sym = key;
+    SDL_PushEvent(&event);
+}
+
+// s as the contents of a JSON string literal
+static std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            out += code;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out;
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    std::string tracePath;
+    std::string outputPath;
+    OptimizedAvatarSystem::Config config;
+    config.warmStart = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--model-dir" && i + 1 < argc) {
+            config.modelDirectory = argv[++i];
+        } else if (arg == "--asset-pack" && i + 1 < argc) {
+            config.assetPack = argv[++i];
+        } else if (arg == "--cold-start") {
+            config.warmStart = false;
+        } else if (arg == "--output-size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &config.outputWidth, &config.outputHeight) != 2) {
+                std::cerr << "Invalid --output-size, expected <width>x<height>" << std::endl;
+                return 2;
+            }
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            config.memoryBudget = std::strtoul(argv[++i], nullptr, 10) * 1024 * 1024;
+        } else if (arg == "--avatars" && i + 1 < argc) {
+            config.avatarCount = std::atoi(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--trace <file>] [--model-dir <dir>] [--asset-pack <file>]"
+                      << " [--cold-start] [--output-size <WxH>] [--memory-budget <MB>] [--avatars <n>]"
+                      << " [--output <file>]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<TraceEvent> trace;
+    bool traceValid;
+    if (tracePath.empty()) {
+        std::istringstream builtin(config.avatarCount > 1 ? CROWD_TRACE : BUILTIN_TRACE);
+        traceValid = parseTrace(builtin, trace);
+    } else {
+        std::ifstream file(tracePath);
+        if (!file) {
+            std::cerr << "Failed to open trace " << tracePath << std::endl;
+            return 1;
+        }
+        traceValid = parseTrace(file, trace);
+    }
+    if (!traceValid || trace.empty()) {
+        return 1;
+    }
+    if (trace.back().command != "quit") {
+        trace.push_back({trace.back().timeMs + 1000, "quit"});
+    }
+
+    config.headless = true;
+    config.stdinCommands = false;
+    config.threadedOutput = false; // frames run on this thread against the simulated clock
+    config.randomSeed = 1;
+
+    const auto FRAME = std::chrono::microseconds(16667);
+    const auto start = AvatarClock::time_point(std::chrono::hours(1));
+    AvatarClock::useSimulated(start);
+
+    // The engine logs every key and blink; keep the report on its own
+    std::streambuf* coutBuffer = std::cout.rdbuf(nullptr);
+
+    OptimizedAvatarSystem avatarSystem;
+    auto startupBegin = std::chrono::steady_clock::now();
+    if (!avatarSystem.initialize(config)) {
+        std::cout.rdbuf(coutBuffer);
+        std::cerr << "Failed to initialize avatar system" << std::endl;
+        return 1;
+    }
+    double startupMs = millisecondsSince(startupBegin);
+
+    LatencyHistogram frameTimes;
+    double totalFrameUs = 0.0;
+    uint64_t frames = 0;
+    uint64_t allocations = 0;
+    uint64_t maxFrameAllocations = 0;
+    size_t next = 0;
+    bool running = true;
+
+    while (running) {
+        int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(AvatarClock::now() - start).count();
+        while (next < trace.size() && trace[next].timeMs <= nowMs) {
+            const std::string& command = trace[next++].command;
+            if (command == "quit") {
+                running = false;
+            } else if (command == "blink") {
+                avatarSystem.triggerBlink();
+            } else if (command == "tab") {
+                pushKey(SDLK_TAB);
+            } else {
+                pushKey(static_cast<SDL_Keycode>(command[0]));
+            }
+        }
+        if (!running) {
+            break;
+        }
+
+        uint64_t allocationsBefore = threadAllocations;
+        auto frameBegin = std::chrono::steady_clock::now();
+        running = avatarSystem.step(0);
+        auto frameTime = std::chrono::steady_clock::now() - frameBegin;
+        uint64_t frameAllocations = threadAllocations - allocationsBefore;
+
+        frameTimes.record(frameTime);
+        totalFrameUs += std::chrono::duration<double, std::micro>(frameTime).count();
+        allocations += frameAllocations;
+        maxFrameAllocations = std::max(maxFrameAllocations, frameAllocations);
+        frames++;
+
+        AvatarClock::advance(FRAME);
+    }
+
+    Stats::Resources resources = avatarSystem.getResourceUsage();
+    avatarSystem.shutdown();
+    std::cout.rdbuf(coutBuffer);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto summary = frameTimes.takeSummary();
+
+    FILE* out = stdout;
+    if (!outputPath.empty()) {
+        out = fopen(outputPath.c_str(), "w");
+        if (!out) {
+            std::cerr << "Failed to open " << outputPath << std::endl;
+            return 1;
+        }
+    }
+
+    // One key per line, fixed order, so runs diff cleanly
+    fprintf(out, "{\n");
+    fprintf(out, "  \"trace\": \"%s\",\n",
+            !tracePath.empty() ? jsonEscape(tracePath).c_str() : config.avatarCount > 1 ? "crowd" : "builtin");
+    fprintf(out, "  \"avatars\": %d,\n", config.avatarCount);
+    fprintf(out, "  \"memory_budget_mb\": %zu,\n", config.memoryBudget / (1024 * 1024));
+    fprintf(out, "  \"warm_start\": %s,\n", config.warmStart ? "true" : "false");
+    fprintf(out, "  \"output_size\": \"%dx%d\",\n", config.outputWidth, config.outputHeight);
+    fprintf(out, "  \"frames\": %llu,\n", static_cast<unsigned long long>(frames));
+    fprintf(out, "  \"cache_hits\": %llu,\n", static_cast<unsigned long long>(resources.cacheHits));
+    fprintf(out, "  \"cache_misses\": %llu,\n", static_cast<unsigned long long>(resources.cacheMisses));
+    fprintf(out, "  \"texture_bytes\": %zu,\n", resources.textureBytes);
+    fprintf(out, "  \"surface_bytes\": %zu,\n", resources.surfaceBytes);
+    fprintf(out, "  \"evictions\": %llu,\n", static_cast<unsigned long long>(resources.evictions));
+    fprintf(out, "  \"allocations_total\": %llu,\n", static_cast<unsigned long long>(allocations));
+    fprintf(out, "  \"allocations_per_frame_mean\": %.3f,\n", frames ? static_cast<double>(allocations) / frames : 0.0);
+    fprintf(out, "  \"allocations_per_frame_max\": %llu,\n", static_cast<unsigned long long>(maxFrameAllocations));
+    fprintf(out, "  \"startup_ms\": %.3f,\n", startupMs);
+    fprintf(out, "  \"frame_us_mean\": %.1f,\n", frames ? totalFrameUs / frames : 0.0);
+    fprintf(out, "  \"frame_us_p50\": %.1f,\n", summary.p50);
+    fprintf(out, "  \"frame_us_p95\": %.1f,\n", summary.p95);
+    fprintf(out, "  \"frame_us_p99\": %.1f,\n", summary.p99);
+    fprintf(out, "  \"frame_us_max\": %.1f,\n", summary.max);
+    fprintf(out, "  \"peak_rss_kb\": %ld\n", usage.ru_maxrss);
+    fprintf(out, "}\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef AVATAR_CLOCK_H
+#define AVATAR_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Time source for animation and frame scheduling. Normally steady_clock; the
+// benchmark switches it to a simulated clock that only moves when advanced,
+// so a scripted run produces the same frames every time. Measurements (stats,
+// upload budgets) keep using steady_clock directly. Simulation assumes the
+// single-threaded loop: nothing may sleep until a simulated deadline.
+class AvatarClock {
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+    using duration = std::chrono::steady_clock::duration;
+
+    static time_point now() {
+        if (simulated.load(std::memory_order_relaxed)) {
+            return time_point(duration(simulatedTicks.load(std::memory_order_relaxed)));
+        }
+        return std::chrono::steady_clock::now();
+    }
+
+    // Freeze time at start; from then on it only moves through advance()
+    static void useSimulated(time_point start) {
+        simulatedTicks.store(start.time_since_epoch().count(), std::memory_order_relaxed);
+        simulated.store(true, std::memory_order_relaxed);
+    }
+
+    static void advance(duration step) {
+        simulatedTicks.fetch_add(step.count(), std::memory_order_relaxed);
+    }
+
+    static bool isSimulated() { return simulated.load(std::memory_order_relaxed); }
+
+private:
+    static inline std::atomic<bool> simulated{false};
+    static inline std::atomic<duration::rep> simulatedTicks{0};
+};
+
+#endif // AVATAR_CLOCK_H
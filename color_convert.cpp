@@ -0,0 +1,90 @@
+#include "color_convert.h"
+#include "color_convert_kernels.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+void rgbaToYuyvScalar(const uint8_t* src, int srcPitch,
+                      uint8_t* dst, int dstPitch,
+                      int width, int height) {
+    for (int y = 0; y < height; y++) {
+        yuyvRowScalar(src + y * srcPitch, dst + y * dstPitch, 0, width);
+    }
+}
+
+void rgbaToNv12Scalar(const uint8_t* src, int srcPitch,
+                      uint8_t* dstY, int yPitch,
+                      uint8_t* dstUV, int uvPitch,
+                      int width, int height) {
+    for (int y = 0; y < height; y += 2) {
+        const uint8_t* row0 = src + y * srcPitch;
+        nv12RowPairScalar(row0, row0 + srcPitch,
+                          dstY + y * yPitch, dstY + (y + 1) * yPitch,
+                          dstUV + (y / 2) * uvPitch, 0, width);
+    }
+}
+
+bool cpuSupports(const ColorConvertKernels* kernels) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (kernels == &avx2ColorKernels) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (kernels == &sse2ColorKernels) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    // Scalar always works, NEON is mandatory wherever it is compiled in
+    (void)kernels;
+    return true;
+}
+
+const ColorConvertKernels* selectKernels() {
+    auto available = getAvailableColorConvertKernels();
+
+    const char* forced = std::getenv("CHIEMODEL_SIMD");
+    if (forced) {
+        for (const auto* kernels : available) {
+            if (std::strcmp(kernels->name, forced) == 0) {
+                return kernels;
+            }
+        }
+        std::cerr << "CHIEMODEL_SIMD=" << forced << " not available on this CPU, using auto-detection" << std::endl;
+    }
+
+    // Available list is ordered from slowest to fastest
+    return available.back();
+}
+
+} // namespace
+
+const ColorConvertKernels scalarColorKernels = {
+    "scalar", rgbaToYuyvScalar, rgbaToNv12Scalar
+};
+
+std::vector<const ColorConvertKernels*> getAvailableColorConvertKernels() {
+    std::vector<const ColorConvertKernels*> candidates = {
+        &scalarColorKernels,
+#if defined(__x86_64__) || defined(__i386__)
+        &sse2ColorKernels,
+        &avx2ColorKernels,
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+        &neonColorKernels,
+#endif
+    };
+
+    std::vector<const ColorConvertKernels*> available;
+    for (const auto* kernels : candidates) {
+        if (cpuSupports(kernels)) {
+            available.push_back(kernels);
+        }
+    }
+    return available;
+}
+
+const ColorConvertKernels& getColorConvertKernels() {
+    static const ColorConvertKernels* selected = selectKernels();
+    return *selected;
+}
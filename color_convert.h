@@ -0,0 +1,31 @@
+#ifndef COLOR_CONVERT_H
+#define COLOR_CONVERT_H
+
+#include <cstdint>
+#include <vector>
+
+// RGBA32 (R,G,B,A byte order) to YUV conversion, BT.601 limited range.
+// Width and height must be even. All kernels produce bit-identical output.
+struct ColorConvertKernels {
+    const char* name;
+
+    // Packed 4:2:2, dstPitch >= width * 2
+    void (*rgbaToYuyv)(const uint8_t* src, int srcPitch,
+                       uint8_t* dst, int dstPitch,
+                       int width, int height);
+
+    // Y plane plus interleaved UV plane, 4:2:0
+    void (*rgbaToNv12)(const uint8_t* src, int srcPitch,
+                       uint8_t* dstY, int yPitch,
+                       uint8_t* dstUV, int uvPitch,
+                       int width, int height);
+};
+
+// Best kernel set for the running CPU (selected once).
+// CHIEMODEL_SIMD=scalar|sse2|avx2|neon forces a specific set.
+const ColorConvertKernels& getColorConvertKernels();
+
+// Every kernel set the running CPU supports, scalar first
+std::vector<const ColorConvertKernels*> getAvailableColorConvertKernels();
+
+#endif // COLOR_CONVERT_H
@@ -0,0 +1,127 @@
+// AVX2 kernels, built with -mavx2 and only called after a runtime CPU check
+
+#include "color_convert_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+namespace {
+
+// Same math as the SSE2 kernels, 8 pixels per register
+struct YuvSums {
+    __m256i y, u, v;
+};
+
+// 16-bit coefficient pair matching the (low, high) halves of each 32-bit lane
+inline __m256i coeffPair(int16_t low, int16_t high) {
+    return _mm256_set1_epi32(static_cast<int>((static_cast<uint32_t>(static_cast<uint16_t>(high)) << 16) |
+                                              static_cast<uint16_t>(low)));
+}
+
+inline YuvSums yuvSums(__m256i px) {
+    __m256i rb = _mm256_and_si256(px, _mm256_set1_epi32(0x00FF00FF));
+    __m256i ga = _mm256_srli_epi16(px, 8);
+
+    YuvSums s;
+    s.y = _mm256_add_epi32(_mm256_madd_epi16(rb, coeffPair(66, 25)),
+                           _mm256_madd_epi16(ga, coeffPair(129, 0)));
+    s.u = _mm256_add_epi32(_mm256_madd_epi16(rb, coeffPair(-38, 112)),
+                           _mm256_madd_epi16(ga, coeffPair(-74, 0)));
+    s.v = _mm256_add_epi32(_mm256_madd_epi16(rb, coeffPair(112, -18)),
+                           _mm256_madd_epi16(ga, coeffPair(-94, 0)));
+    return s;
+}
+
+inline __m256i finishY(__m256i y) {
+    return _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(y, _mm256_set1_epi32(128)), 8),
+                            _mm256_set1_epi32(16));
+}
+
+inline __m256i pairSum(__m256i v) {
+    return _mm256_add_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+template <int Shift>
+inline __m256i finishChroma(__m256i uSum, __m256i vSum) {
+    const __m256i round = _mm256_set1_epi32(1 << (Shift - 1));
+    const __m256i bias = _mm256_set1_epi32(128);
+    __m256i u = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(uSum, round), Shift), bias);
+    __m256i v = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(vSum, round), Shift), bias);
+    return _mm256_blend_epi32(u, v, 0xAA);
+}
+
+// Packs work per 128-bit lane; gather the 16 useful bytes back in pixel order
+inline __m128i packLanesToBytes(__m256i a, __m256i b) {
+    __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_setzero_si256());
+    bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    return _mm256_castsi256_si128(bytes);
+}
+
+void rgbaToYuyvAvx2(const uint8_t* src, int srcPitch,
+                    uint8_t* dst, int dstPitch,
+                    int width, int height) {
+    const int blockEnd = width & ~15;
+
+    for (int row = 0; row < height; row++) {
+        const uint8_t* in = src + row * srcPitch;
+        uint8_t* out = dst + row * dstPitch;
+
+        for (int x = 0; x < blockEnd; x += 16) {
+            YuvSums a = yuvSums(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x * 4)));
+            YuvSums b = yuvSums(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x * 4 + 32)));
+
+            __m256i y16 = _mm256_packs_epi32(finishY(a.y), finishY(b.y));
+            __m256i c16 = _mm256_packs_epi32(finishChroma<9>(pairSum(a.u), pairSum(a.v)),
+                                             finishChroma<9>(pairSum(b.u), pairSum(b.v)));
+
+            __m256i yuyv = _mm256_packus_epi16(_mm256_unpacklo_epi16(y16, c16),
+                                               _mm256_unpackhi_epi16(y16, c16));
+            yuyv = _mm256_permute4x64_epi64(yuyv, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x * 2), yuyv);
+        }
+
+        yuyvRowScalar(in, out, blockEnd, width);
+    }
+}
+
+void rgbaToNv12Avx2(const uint8_t* src, int srcPitch,
+                    uint8_t* dstY, int yPitch,
+                    uint8_t* dstUV, int uvPitch,
+                    int width, int height) {
+    const int blockEnd = width & ~15;
+
+    for (int row = 0; row < height; row += 2) {
+        const uint8_t* in0 = src + row * srcPitch;
+        const uint8_t* in1 = in0 + srcPitch;
+        uint8_t* y0 = dstY + row * yPitch;
+        uint8_t* y1 = y0 + yPitch;
+        uint8_t* uv = dstUV + (row / 2) * uvPitch;
+
+        for (int x = 0; x < blockEnd; x += 16) {
+            YuvSums a0 = yuvSums(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in0 + x * 4)));
+            YuvSums b0 = yuvSums(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in0 + x * 4 + 32)));
+            YuvSums a1 = yuvSums(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in1 + x * 4)));
+            YuvSums b1 = yuvSums(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in1 + x * 4 + 32)));
+
+            __m256i chromaA = finishChroma<10>(pairSum(_mm256_add_epi32(a0.u, a1.u)),
+                                               pairSum(_mm256_add_epi32(a0.v, a1.v)));
+            __m256i chromaB = finishChroma<10>(pairSum(_mm256_add_epi32(b0.u, b1.u)),
+                                               pairSum(_mm256_add_epi32(b0.v, b1.v)));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + x), packLanesToBytes(finishY(a0.y), finishY(b0.y)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + x), packLanesToBytes(finishY(a1.y), finishY(b1.y)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + x), packLanesToBytes(chromaA, chromaB));
+        }
+
+        nv12RowPairScalar(in0, in1, y0, y1, uv, blockEnd, width);
+    }
+}
+
+} // namespace
+
+const ColorConvertKernels avx2ColorKernels = {
+    "avx2", rgbaToYuyvAvx2, rgbaToNv12Avx2
+};
+
+#endif // x86
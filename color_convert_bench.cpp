@@ -0,0 +1,85 @@
+// Micro-benchmark for the RGBA -> YUV kernels: reports MB/s of RGBA input
+// per kernel and checks that every kernel matches the scalar reference.
+
+#include "color_convert.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchSize {
+    int width;
+    int height;
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    double minSeconds = 0.5;
+    if (argc > 1) {
+        minSeconds = std::atof(argv[1]);
+    }
+
+    // 642x362 exercises the scalar row tails of the SIMD kernels
+    std::vector<BenchSize> sizes = {{800, 600}, {1280, 720}, {1920, 1080}, {642, 362}};
+    auto kernels = getAvailableColorConvertKernels();
+    bool mismatch = false;
+
+    std::printf("Selected kernel: %s\n", getColorConvertKernels().name);
+    std::printf("%-8s %-6s %-10s %12s\n", "kernel", "format", "size", "MB/s");
+
+    for (const auto& size : sizes) {
+        int w = size.width, h = size.height;
+        int pitch = w * 4;
+        std::vector<uint8_t> rgba(static_cast<size_t>(pitch) * h);
+
+        std::mt19937 rng(1234);
+        for (auto& byte : rgba) {
+            byte = static_cast<uint8_t>(rng());
+        }
+
+        std::vector<uint8_t> refYuyv(static_cast<size_t>(w) * h * 2);
+        std::vector<uint8_t> refNv12(static_cast<size_t>(w) * h * 3 / 2);
+        kernels.front()->rgbaToYuyv(rgba.data(), pitch, refYuyv.data(), w * 2, w, h);
+        kernels.front()->rgbaToNv12(rgba.data(), pitch, refNv12.data(), w,
+                                    refNv12.data() + w * h, w, w, h);
+
+        std::string sizeName = std::to_string(w) + "x" + std::to_string(h);
+        double megabytes = static_cast<double>(rgba.size()) / (1024.0 * 1024.0);
+
+        for (const auto* k : kernels) {
+            std::vector<uint8_t> yuyv(refYuyv.size());
+            std::vector<uint8_t> nv12(refNv12.size());
+
+            int iterations = 0;
+            auto start = std::chrono::steady_clock::now();
+            do {
+                k->rgbaToYuyv(rgba.data(), pitch, yuyv.data(), w * 2, w, h);
+                iterations++;
+            } while (secondsSince(start) < minSeconds);
+            std::printf("%-8s %-6s %-10s %12.1f\n", k->name, "yuyv", sizeName.c_str(),
+                        megabytes * iterations / secondsSince(start));
+
+            iterations = 0;
+            start = std::chrono::steady_clock::now();
+            do {
+                k->rgbaToNv12(rgba.data(), pitch, nv12.data(), w, nv12.data() + w * h, w, w, h);
+                iterations++;
+            } while (secondsSince(start) < minSeconds);
+            std::printf("%-8s %-6s %-10s %12.1f\n", k->name, "nv12", sizeName.c_str(),
+                        megabytes * iterations / secondsSince(start));
+
+            if (yuyv != refYuyv || nv12 != refNv12) {
+                std::printf("MISMATCH: %s output differs from scalar at %s\n", k->name, sizeName.c_str());
+                mismatch = true;
+            }
+        }
+    }
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+#ifndef COLOR_CONVERT_KERNELS_H
+#define COLOR_CONVERT_KERNELS_H
+
+// Internal to the color_convert*.cpp kernels
+
+#include "color_convert.h"
+
+// BT.601 limited range coefficients (8-bit fixed point).
+// Chroma is computed from the sum of the 2 (YUYV) or 4 (NV12) source
+// pixels so every SIMD kernel can match the scalar reference exactly.
+inline uint8_t yuvY(int r, int g, int b) {
+    return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+inline uint8_t yuvU2(int rs, int gs, int bs) {
+    return static_cast<uint8_t>(((-38 * rs - 74 * gs + 112 * bs + 256) >> 9) + 128);
+}
+
+inline uint8_t yuvV2(int rs, int gs, int bs) {
+    return static_cast<uint8_t>(((112 * rs - 94 * gs - 18 * bs + 256) >> 9) + 128);
+}
+
+inline uint8_t yuvU4(int rs, int gs, int bs) {
+    return static_cast<uint8_t>(((-38 * rs - 74 * gs + 112 * bs + 512) >> 10) + 128);
+}
+
+inline uint8_t yuvV4(int rs, int gs, int bs) {
+    return static_cast<uint8_t>(((112 * rs - 94 * gs - 18 * bs + 512) >> 10) + 128);
+}
+
+// Scalar row helpers, also used by SIMD kernels for the row tail
+inline void yuyvRowScalar(const uint8_t* src, uint8_t* dst, int x, int width) {
+    for (; x < width; x += 2) {
+        const uint8_t* p0 = src + x * 4;
+        const uint8_t* p1 = p0 + 4;
+        int rs = p0[0] + p1[0];
+        int gs = p0[1] + p1[1];
+        int bs = p0[2] + p1[2];
+        uint8_t* out = dst + x * 2;
+        out[0] = yuvY(p0[0], p0[1], p0[2]);
+        out[1] = yuvU2(rs, gs, bs);
+        out[2] = yuvY(p1[0], p1[1], p1[2]);
+        out[3] = yuvV2(rs, gs, bs);
+    }
+}
+
+inline void nv12RowPairScalar(const uint8_t* row0, const uint8_t* row1,
+                              uint8_t* y0, uint8_t* y1, uint8_t* uv,
+                              int x, int width) {
+    for (; x < width; x += 2) {
+        const uint8_t* a = row0 + x * 4;
+        const uint8_t* b = a + 4;
+        const uint8_t* c = row1 + x * 4;
+        const uint8_t* d = c + 4;
+        y0[x] = yuvY(a[0], a[1], a[2]);
+        y0[x + 1] = yuvY(b[0], b[1], b[2]);
+        y1[x] = yuvY(c[0], c[1], c[2]);
+        y1[x + 1] = yuvY(d[0], d[1], d[2]);
+        int rs = a[0] + b[0] + c[0] + d[0];
+        int gs = a[1] + b[1] + c[1] + d[1];
+        int bs = a[2] + b[2] + c[2] + d[2];
+        uv[x] = yuvU4(rs, gs, bs);
+        uv[x + 1] = yuvV4(rs, gs, bs);
+    }
+}
+
+// Kernel sets, defined only when built for a matching architecture
+extern const ColorConvertKernels scalarColorKernels;
+#if defined(__x86_64__) || defined(__i386__)
+extern const ColorConvertKernels sse2ColorKernels;
+extern const ColorConvertKernels avx2ColorKernels;
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+extern const ColorConvertKernels neonColorKernels;
+#endif
+
+#endif // COLOR_CONVERT_KERNELS_H
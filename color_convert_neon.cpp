@@ -0,0 +1,112 @@
+// NEON kernels (always available on aarch64)
+
+#include "color_convert_kernels.h"
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+namespace {
+
+// Y for 8 pixels: ((66R + 129G + 25B + 128) >> 8) + 16
+inline uint8x8_t lumaNeon(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t acc = vmull_u8(r, vdup_n_u8(66));
+    acc = vmlal_u8(acc, g, vdup_n_u8(129));
+    acc = vmlal_u8(acc, b, vdup_n_u8(25));
+    return vadd_u8(vrshrn_n_u16(acc, 8), vdup_n_u8(16));
+}
+
+// Chroma from 8 channel sums with rounding shift Shift (9 for pairs, 10 for 2x2)
+template <int Shift>
+inline uint8x8_t chromaNeon(int16x8_t rs, int16x8_t gs, int16x8_t bs,
+                            int16_t cr, int16_t cg, int16_t cb) {
+    int32x4_t lo = vmull_n_s16(vget_low_s16(rs), cr);
+    lo = vmlal_n_s16(lo, vget_low_s16(gs), cg);
+    lo = vmlal_n_s16(lo, vget_low_s16(bs), cb);
+    int32x4_t hi = vmull_n_s16(vget_high_s16(rs), cr);
+    hi = vmlal_n_s16(hi, vget_high_s16(gs), cg);
+    hi = vmlal_n_s16(hi, vget_high_s16(bs), cb);
+
+    const int32x4_t bias = vdupq_n_s32(128);
+    lo = vaddq_s32(vrshrq_n_s32(lo, Shift), bias);
+    hi = vaddq_s32(vrshrq_n_s32(hi, Shift), bias);
+    return vqmovun_s16(vcombine_s16(vmovn_s32(lo), vmovn_s32(hi)));
+}
+
+void rgbaToYuyvNeon(const uint8_t* src, int srcPitch,
+                    uint8_t* dst, int dstPitch,
+                    int width, int height) {
+    const int blockEnd = width & ~15;
+
+    for (int row = 0; row < height; row++) {
+        const uint8_t* in = src + row * srcPitch;
+        uint8_t* out = dst + row * dstPitch;
+
+        for (int x = 0; x < blockEnd; x += 16) {
+            uint8x16x4_t px = vld4q_u8(in + x * 4);
+
+            uint8x16_t y = vcombine_u8(lumaNeon(vget_low_u8(px.val[0]), vget_low_u8(px.val[1]), vget_low_u8(px.val[2])),
+                                       lumaNeon(vget_high_u8(px.val[0]), vget_high_u8(px.val[1]), vget_high_u8(px.val[2])));
+
+            // Horizontal pixel pair sums
+            int16x8_t rs = vreinterpretq_s16_u16(vpaddlq_u8(px.val[0]));
+            int16x8_t gs = vreinterpretq_s16_u16(vpaddlq_u8(px.val[1]));
+            int16x8_t bs = vreinterpretq_s16_u16(vpaddlq_u8(px.val[2]));
+
+            uint8x8x4_t yuyv;
+            uint8x16x2_t split = vuzpq_u8(y, y);
+            yuyv.val[0] = vget_low_u8(split.val[0]);
+            yuyv.val[1] = chromaNeon<9>(rs, gs, bs, -38, -74, 112);
+            yuyv.val[2] = vget_low_u8(split.val[1]);
+            yuyv.val[3] = chromaNeon<9>(rs, gs, bs, 112, -94, -18);
+            vst4_u8(out + x * 2, yuyv);
+        }
+
+        yuyvRowScalar(in, out, blockEnd, width);
+    }
+}
+
+void rgbaToNv12Neon(const uint8_t* src, int srcPitch,
+                    uint8_t* dstY, int yPitch,
+                    uint8_t* dstUV, int uvPitch,
+                    int width, int height) {
+    const int blockEnd = width & ~15;
+
+    for (int row = 0; row < height; row += 2) {
+        const uint8_t* in0 = src + row * srcPitch;
+        const uint8_t* in1 = in0 + srcPitch;
+        uint8_t* y0 = dstY + row * yPitch;
+        uint8_t* y1 = y0 + yPitch;
+        uint8_t* uv = dstUV + (row / 2) * uvPitch;
+
+        for (int x = 0; x < blockEnd; x += 16) {
+            uint8x16x4_t top = vld4q_u8(in0 + x * 4);
+            uint8x16x4_t bottom = vld4q_u8(in1 + x * 4);
+
+            vst1q_u8(y0 + x, vcombine_u8(lumaNeon(vget_low_u8(top.val[0]), vget_low_u8(top.val[1]), vget_low_u8(top.val[2])),
+                                         lumaNeon(vget_high_u8(top.val[0]), vget_high_u8(top.val[1]), vget_high_u8(top.val[2]))));
+            vst1q_u8(y1 + x, vcombine_u8(lumaNeon(vget_low_u8(bottom.val[0]), vget_low_u8(bottom.val[1]), vget_low_u8(bottom.val[2])),
+                                         lumaNeon(vget_high_u8(bottom.val[0]), vget_high_u8(bottom.val[1]), vget_high_u8(bottom.val[2]))));
+
+            // 2x2 block sums: pair-add each row, accumulate the second row
+            int16x8_t rs = vreinterpretq_s16_u16(vpadalq_u8(vpaddlq_u8(top.val[0]), bottom.val[0]));
+            int16x8_t gs = vreinterpretq_s16_u16(vpadalq_u8(vpaddlq_u8(top.val[1]), bottom.val[1]));
+            int16x8_t bs = vreinterpretq_s16_u16(vpadalq_u8(vpaddlq_u8(top.val[2]), bottom.val[2]));
+
+            uint8x8x2_t chroma;
+            chroma.val[0] = chromaNeon<10>(rs, gs, bs, -38, -74, 112);
+            chroma.val[1] = chromaNeon<10>(rs, gs, bs, 112, -94, -18);
+            vst2_u8(uv + x, chroma);
+        }
+
+        nv12RowPairScalar(in0, in1, y0, y1, uv, blockEnd, width);
+    }
+}
+
+} // namespace
+
+const ColorConvertKernels neonColorKernels = {
+    "neon", rgbaToYuyvNeon, rgbaToNv12Neon
+};
+
+#endif // NEON
@@ -0,0 +1,123 @@
+// SSE2 kernels (baseline on x86_64, built with -msse2 on i386)
+
+#include "color_convert_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <emmintrin.h>
+
+namespace {
+
+// Per-pixel fixed point sums for 4 RGBA pixels, before rounding:
+// y = 66R + 129G + 25B, u = -38R - 74G + 112B, v = 112R - 94G - 18B
+struct YuvSums {
+    __m128i y, u, v;
+};
+
+inline YuvSums yuvSums(__m128i px) {
+    // 16-bit lanes: (R, B) and (G, A) for each pixel
+    __m128i rb = _mm_and_si128(px, _mm_set1_epi32(0x00FF00FF));
+    __m128i ga = _mm_srli_epi16(px, 8);
+
+    YuvSums s;
+    s.y = _mm_add_epi32(_mm_madd_epi16(rb, _mm_setr_epi16(66, 25, 66, 25, 66, 25, 66, 25)),
+                        _mm_madd_epi16(ga, _mm_setr_epi16(129, 0, 129, 0, 129, 0, 129, 0)));
+    s.u = _mm_add_epi32(_mm_madd_epi16(rb, _mm_setr_epi16(-38, 112, -38, 112, -38, 112, -38, 112)),
+                        _mm_madd_epi16(ga, _mm_setr_epi16(-74, 0, -74, 0, -74, 0, -74, 0)));
+    s.v = _mm_add_epi32(_mm_madd_epi16(rb, _mm_setr_epi16(112, -18, 112, -18, 112, -18, 112, -18)),
+                        _mm_madd_epi16(ga, _mm_setr_epi16(-94, 0, -94, 0, -94, 0, -94, 0)));
+    return s;
+}
+
+inline __m128i finishY(__m128i y) {
+    return _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(y, _mm_set1_epi32(128)), 8), _mm_set1_epi32(16));
+}
+
+// Sum horizontal pixel pairs: [a+b, a+b, c+d, c+d]
+inline __m128i pairSum(__m128i v) {
+    return _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+// Round and interleave pair sums into [U01, V01, U23, V23]
+template <int Shift>
+inline __m128i finishChroma(__m128i uSum, __m128i vSum) {
+    const __m128i round = _mm_set1_epi32(1 << (Shift - 1));
+    const __m128i bias = _mm_set1_epi32(128);
+    __m128i u = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(uSum, round), Shift), bias);
+    __m128i v = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(vSum, round), Shift), bias);
+    const __m128i evenLanes = _mm_setr_epi32(-1, 0, -1, 0);
+    return _mm_or_si128(_mm_and_si128(evenLanes, u), _mm_andnot_si128(evenLanes, v));
+}
+
+void rgbaToYuyvSse2(const uint8_t* src, int srcPitch,
+                    uint8_t* dst, int dstPitch,
+                    int width, int height) {
+    const int blockEnd = width & ~7;
+
+    for (int row = 0; row < height; row++) {
+        const uint8_t* in = src + row * srcPitch;
+        uint8_t* out = dst + row * dstPitch;
+
+        for (int x = 0; x < blockEnd; x += 8) {
+            YuvSums a = yuvSums(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x * 4)));
+            YuvSums b = yuvSums(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x * 4 + 16)));
+
+            __m128i y16 = _mm_packs_epi32(finishY(a.y), finishY(b.y));
+            __m128i c16 = _mm_packs_epi32(finishChroma<9>(pairSum(a.u), pairSum(a.v)),
+                                          finishChroma<9>(pairSum(b.u), pairSum(b.v)));
+
+            __m128i yuyv = _mm_packus_epi16(_mm_unpacklo_epi16(y16, c16), _mm_unpackhi_epi16(y16, c16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2), yuyv);
+        }
+
+        yuyvRowScalar(in, out, blockEnd, width);
+    }
+}
+
+void rgbaToNv12Sse2(const uint8_t* src, int srcPitch,
+                    uint8_t* dstY, int yPitch,
+                    uint8_t* dstUV, int uvPitch,
+                    int width, int height) {
+    const int blockEnd = width & ~15;
+
+    for (int row = 0; row < height; row += 2) {
+        const uint8_t* in0 = src + row * srcPitch;
+        const uint8_t* in1 = in0 + srcPitch;
+        uint8_t* y0 = dstY + row * yPitch;
+        uint8_t* y1 = y0 + yPitch;
+        uint8_t* uv = dstUV + (row / 2) * uvPitch;
+
+        for (int x = 0; x < blockEnd; x += 16) {
+            __m128i y0Lanes[4], y1Lanes[4], chroma[4];
+            for (int i = 0; i < 4; i++) {
+                YuvSums a = yuvSums(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in0 + (x + i * 4) * 4)));
+                YuvSums b = yuvSums(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in1 + (x + i * 4) * 4)));
+                y0Lanes[i] = finishY(a.y);
+                y1Lanes[i] = finishY(b.y);
+                chroma[i] = finishChroma<10>(pairSum(_mm_add_epi32(a.u, b.u)),
+                                             pairSum(_mm_add_epi32(a.v, b.v)));
+            }
+
+            __m128i top = _mm_packus_epi16(_mm_packs_epi32(y0Lanes[0], y0Lanes[1]),
+                                           _mm_packs_epi32(y0Lanes[2], y0Lanes[3]));
+            __m128i bottom = _mm_packus_epi16(_mm_packs_epi32(y1Lanes[0], y1Lanes[1]),
+                                              _mm_packs_epi32(y1Lanes[2], y1Lanes[3]));
+            __m128i uvBytes = _mm_packus_epi16(_mm_packs_epi32(chroma[0], chroma[1]),
+                                               _mm_packs_epi32(chroma[2], chroma[3]));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + x), top);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + x), bottom);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + x), uvBytes);
+        }
+
+        nv12RowPairScalar(in0, in1, y0, y1, uv, blockEnd, width);
+    }
+}
+
+} // namespace
+
+const ColorConvertKernels sse2ColorKernels = {
+    "sse2", rgbaToYuyvSse2, rgbaToNv12Sse2
+};
+
+#endif // x86
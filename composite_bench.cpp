@@ -0,0 +1,156 @@
+// Micro-benchmark for the CPU compositor: reports megapixels/s per kernel,
+// checks that every kernel matches the scalar reference, and times whole
+// frames through CpuCompositor (fill plus a centered avatar, straight,
+// mirrored and squashed, and a row of eight overlapping avatars) to show the
+// frame rate it sustains per size.
+
+#include "compositor.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchSize {
+    int width;
+    int height;
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Premultiplied test image: opaque body, clear surroundings and a soft edge,
+// like a cut-out avatar
+static std::vector<uint32_t> makeImage(int width, int height, std::mt19937& rng) {
+    std::vector<uint8_t> straight(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = &straight[(static_cast<size_t>(y) * width + x) * 4];
+            double dx = (x - width / 2.0) / (width / 2.0), dy = (y - height / 2.0) / (height / 2.0);
+            double r = dx * dx + dy * dy;
+            p[0] = static_cast<uint8_t>(rng());
+            p[1] = static_cast<uint8_t>(rng());
+            p[2] = static_cast<uint8_t>(rng());
+            p[3] = r < 0.5 ? 255 : r > 0.8 ? 0 : static_cast<uint8_t>(rng());
+        }
+    }
+    std::vector<uint32_t> image(static_cast<size_t>(width) * height);
+    premultiplyRgba(straight.data(), width * 4, image.data(), width * 4, width, height);
+    return image;
+}
+
+int main(int argc, char* argv[]) {
+    double minSeconds = 0.5;
+    if (argc > 1) {
+        minSeconds = std::atof(argv[1]);
+    }
+
+    // 1278x718 exercises the scalar row tails of the SIMD kernels
+    std::vector<BenchSize> sizes = {{800, 600}, {1280, 720}, {1920, 1080}, {1278, 718}};
+    auto kernels = getAvailableCompositeKernels();
+    bool mismatch = false;
+    std::mt19937 rng(1234);
+
+    std::printf("Selected kernel: %s\n", getCompositeKernels().name);
+    std::printf("%-8s %-9s %-10s %12s\n", "kernel", "op", "size", "Mpixel/s");
+
+    for (const auto& size : sizes) {
+        int w = size.width, h = size.height;
+        size_t count = static_cast<size_t>(w) * h;
+        std::vector<uint32_t> source = makeImage(w, h, rng);
+        std::vector<uint32_t> background(count);
+        for (auto& pixel : background) {
+            pixel = rng() | 0xFF000000u;
+        }
+
+        std::vector<uint32_t> refOver = background, refMirrored = background;
+        for (int y = 0; y < h; y++) {
+            kernels.front()->over(&refOver[y * w], &source[y * w], w);
+            kernels.front()->overMirrored(&refMirrored[y * w], &source[y * w], w);
+        }
+
+        std::string sizeName = std::to_string(w) + "x" + std::to_string(h);
+        double megapixels = count / 1e6;
+
+        for (const auto* k : kernels) {
+            std::vector<uint32_t> frame(count);
+
+            int iterations = 0;
+            auto start = std::chrono::steady_clock::now();
+            do {
+                k->fill(frame.data(), static_cast<int>(count), 0xFF00FF00u);
+                iterations++;
+            } while (secondsSince(start) < minSeconds);
+            std::printf("%-8s %-9s %-10s %12.1f\n", k->name, "fill", sizeName.c_str(),
+                        megapixels * iterations / secondsSince(start));
+
+            iterations = 0;
+            start = std::chrono::steady_clock::now();
+            do {
+                frame = background;
+                for (int y = 0; y < h; y++) {
+                    k->over(&frame[y * w], &source[y * w], w);
+                }
+                iterations++;
+            } while (secondsSince(start) < minSeconds);
+            std::printf("%-8s %-9s %-10s %12.1f\n", k->name, "over", sizeName.c_str(),
+                        megapixels * iterations / secondsSince(start));
+            bool overMatches = frame == refOver;
+
+            frame = background;
+            for (int y = 0; y < h; y++) {
+                k->overMirrored(&frame[y * w], &source[y * w], w);
+            }
+            if (!overMatches || frame != refMirrored) {
+                std::printf("MISMATCH: %s output differs from scalar at %s\n", k->name, sizeName.c_str());
+                mismatch = true;
+            }
+        }
+
+        // Whole frames: the avatar fills 3/4 of the height, as with the real model
+        CpuCompositor compositor;
+        int imageHeight = h * 3 / 4, imageWidth = imageHeight * 2 / 3;
+        std::vector<uint32_t> avatar = makeImage(imageWidth, imageHeight, rng);
+        CompositeImage image = {avatar.data(), imageWidth * 4, imageWidth, imageHeight};
+        SDL_Rect whole = {0, 0, w, h};
+        SDL_Rect centered = {(w - imageWidth) / 2, h - imageHeight, imageWidth, imageHeight};
+        SDL_Rect squashed = {centered.x - imageWidth / 10, centered.y + imageHeight / 10,
+                             imageWidth + imageWidth / 5, imageHeight - imageHeight / 10};
+        std::vector<uint32_t> frame(count);
+
+        // A crowd: eight avatars side by side, each overlapping its neighbours
+        const int CROWD = 8;
+        std::vector<CompositeLayer> crowd;
+        for (int i = 0; i < CROWD; i++) {
+            int slot = w * i / CROWD + w / (2 * CROWD);
+            crowd.push_back({image, {slot - imageWidth / 2, h - imageHeight, imageWidth, imageHeight}, i % 2 == 1});
+        }
+
+        struct Case {
+            const char* name;
+            std::vector<CompositeLayer> layers;
+        };
+        std::vector<Case> cases = {
+            {"frame", {{image, centered, false}}},
+            {"mirrored", {{image, centered, true}}},
+            {"squashed", {{image, squashed, false}}},
+            {"crowd", crowd},
+        };
+        for (const Case& c : cases) {
+            int iterations = 0;
+            auto start = std::chrono::steady_clock::now();
+            do {
+                compositor.compose(frame.data(), w * 4, w, h, whole, 0xFF00FF00u,
+                                   c.layers.data(), static_cast<int>(c.layers.size()));
+                iterations++;
+            } while (secondsSince(start) < minSeconds);
+            std::printf("%-8s %-9s %-10s %12.1f  (%.0f fps, %d bands)\n", compositor.getKernelName(), c.name,
+                        sizeName.c_str(), megapixels * iterations / secondsSince(start),
+                        iterations / secondsSince(start), compositor.getMaxBands());
+        }
+    }
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,280 @@
+#include "compositor.h"
+#include "compositor_kernels.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+void fillScalar(uint32_t* dst, int count, uint32_t color) {
+    fillRowScalar(dst, 0, count, color);
+}
+
+void overScalar(uint32_t* dst, const uint32_t* src, int count) {
+    overRowScalar(dst, src, 0, count);
+}
+
+void overMirroredScalar(uint32_t* dst, const uint32_t* src, int count) {
+    overMirroredRowScalar(dst, src, 0, count);
+}
+
+bool cpuSupports(const CompositeKernels* kernels) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (kernels == &avx2CompositeKernels) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (kernels == &sse2CompositeKernels) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    // Scalar always works, NEON is mandatory wherever it is compiled in
+    (void)kernels;
+    return true;
+}
+
+const CompositeKernels* selectKernels() {
+    auto available = getAvailableCompositeKernels();
+
+    const char* forced = std::getenv("CHIEMODEL_SIMD");
+    if (forced) {
+        for (const auto* kernels : available) {
+            if (std::strcmp(kernels->name, forced) == 0) {
+                return kernels;
+            }
+        }
+        std::cerr << "CHIEMODEL_SIMD=" << forced << " not available on this CPU, using auto-detection" << std::endl;
+    }
+
+    // Available list is ordered from slowest to fastest
+    return available.back();
+}
+
+inline uint32_t* rowAt(uint32_t* pixels, int pitch, int y) {
+    return reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(pixels) + static_cast<size_t>(y) * pitch);
+}
+
+inline const uint32_t* rowAt(const uint32_t* pixels, int pitch, int y) {
+    return reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(pixels) + static_cast<size_t>(y) * pitch);
+}
+
+} // namespace
+
+const CompositeKernels scalarCompositeKernels = {
+    "scalar", fillScalar, overScalar, overMirroredScalar
+};
+
+std::vector<const CompositeKernels*> getAvailableCompositeKernels() {
+    std::vector<const CompositeKernels*> candidates = {
+        &scalarCompositeKernels,
+#if defined(__x86_64__) || defined(__i386__)
+        &sse2CompositeKernels,
+        &avx2CompositeKernels,
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+        &neonCompositeKernels,
+#endif
+    };
+
+    std::vector<const CompositeKernels*> available;
+    for (const auto* kernels : candidates) {
+        if (cpuSupports(kernels)) {
+            available.push_back(kernels);
+        }
+    }
+    return available;
+}
+
+const CompositeKernels& getCompositeKernels() {
+    static const CompositeKernels* selected = selectKernels();
+    return *selected;
+}
+
+void premultiplyRgba(const uint8_t* src, int srcPitch, uint32_t* dst, int dstPitch, int width, int height) {
+    for (int y = 0; y < height; y++) {
+        const uint8_t* in = src + static_cast<size_t>(y) * srcPitch;
+        uint8_t* out = reinterpret_cast<uint8_t*>(rowAt(dst, dstPitch, y));
+        for (int x = 0; x < width; x++, in += 4, out += 4) {
+            int alpha = in[3];
+            out[0] = div255(in[0] * alpha);
+            out[1] = div255(in[1] * alpha);
+            out[2] = div255(in[2] * alpha);
+            out[3] = static_cast<uint8_t>(alpha);
+        }
+    }
+}
+
+CpuCompositor::CpuCompositor(int maxBands)
+    : kernels(getCompositeKernels())
+    , generation(0), bandCount(0), bandsRemaining(0)
+    , stopping(false) {
+    if (maxBands <= 0) {
+        // Several instances share a node; a few bands already cover 1080p
+        maxBands = static_cast<int>(std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+    }
+    scratchRows.resize(maxBands);
+    for (int band = 1; band < maxBands; band++) {
+        workers.emplace_back(&CpuCompositor::workerMain, this, band);
+    }
+}
+
+CpuCompositor::~CpuCompositor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void CpuCompositor::compose(uint32_t* frame, int pitch, int width, int height, const SDL_Rect& region,
+                            uint32_t background, const CompositeLayer* layers, int layerCount) {
+    SDL_Rect bounds = {0, 0, width, height};
+    SDL_Rect area;
+    if (!frame || !SDL_IntersectRect(&region, &bounds, &area)) {
+        return;
+    }
+
+    // Part of each image inside the repainted area; empty if it is not drawn.
+    // Scaled (squash and stretch): source column of every span pixel, mirror included
+    spans.resize(std::max(layerCount, 0));
+    columns.clear();
+    size_t patchedWidth = 0, gatheredWidth = 0;
+    for (int l = 0; l < layerCount; l++) {
+        const CompositeLayer& layer = layers[l];
+        const CompositeImage& image = layer.image;
+        LayerSpan& state = spans[l];
+        state = {{0, 0, 0, 0}, {0, 0, 0, 0}, false, 0};
+        bool hasImage = image.pixels && image.width > 0 && image.height > 0;
+        if (!hasImage || !SDL_IntersectRect(&layer.destRect, &area, &state.span)) {
+            state.span = {0, 0, 0, 0};
+            continue;
+        }
+
+        state.scaled = layer.destRect.w != image.width;
+        if (state.scaled) {
+            state.columnOffset = static_cast<int>(columns.size());
+            for (int i = 0; i < state.span.w; i++) {
+                int dx = state.span.x + i - layer.destRect.x;
+                if (layer.flipped) {
+                    dx = layer.destRect.w - 1 - dx;
+                }
+                columns.push_back(static_cast<int>(static_cast<int64_t>(dx) * image.width / layer.destRect.w));
+            }
+            gatheredWidth = std::max(gatheredWidth, static_cast<size_t>(state.span.w));
+        }
+
+        SDL_Rect imageBounds = {0, 0, image.width, image.height};
+        if (image.patchPixels && SDL_IntersectRect(&image.patchRect, &imageBounds, &state.patch)) {
+            patchedWidth = std::max(patchedWidth, static_cast<size_t>(image.width));
+        } else {
+            state.patch = {0, 0, 0, 0};
+        }
+    }
+    for (auto& scratch : scratchRows) {
+        if (scratch.gathered.size() < gatheredWidth) scratch.gathered.resize(gatheredWidth);
+        if (scratch.patched.size() < patchedWidth) scratch.patched.resize(patchedWidth);
+    }
+
+    int bands = 1;
+    if (area.w * area.h >= PARALLEL_MIN_PIXELS) {
+        bands = std::max(1, std::min(getMaxBands(), area.h / MIN_BAND_ROWS));
+    }
+    if (bands == 1) {
+        composeRows(frame, pitch, area, area.y, area.y + area.h, background, layers, layerCount, scratchRows[0]);
+        return;
+    }
+
+    job = [&](int band) {
+        int begin = area.y + area.h * band / bands;
+        int end = area.y + area.h * (band + 1) / bands;
+        composeRows(frame, pitch, area, begin, end, background, layers, layerCount, scratchRows[band]);
+    };
+    runBands(bands);
+    job = nullptr;
+}
+
+void CpuCompositor::composeRows(uint32_t* frame, int pitch, const SDL_Rect& area, int rowBegin, int rowEnd,
+                                uint32_t background, const CompositeLayer* layers, int layerCount,
+                                BandScratch& scratch) {
+    for (int y = rowBegin; y < rowEnd; y++) {
+        uint32_t* row = rowAt(frame, pitch, y);
+        kernels.fill(row + area.x, area.w, background);
+
+        for (int l = 0; l < layerCount; l++) {
+            const LayerSpan& state = spans[l];
+            const SDL_Rect& span = state.span;
+            if (y < span.y || y >= span.y + span.h) {
+                continue;
+            }
+
+            const CompositeImage& image = layers[l].image;
+            const SDL_Rect& destRect = layers[l].destRect;
+            const SDL_Rect& patch = state.patch;
+            int sourceY = static_cast<int>(static_cast<int64_t>(y - destRect.y) * image.height / destRect.h);
+            const uint32_t* source = rowAt(image.pixels, image.pitch, sourceY);
+            if (sourceY >= patch.y && sourceY < patch.y + patch.h) {
+                // Replace, not blend: the patch holds the final pixels of its rect
+                const uint32_t* patchRow = rowAt(image.patchPixels, image.patchPitch, sourceY - image.patchRect.y);
+                uint32_t* patched = scratch.patched.data();
+                std::memcpy(patched, source, static_cast<size_t>(image.width) * 4);
+                std::memcpy(patched + patch.x, patchRow + (patch.x - image.patchRect.x), static_cast<size_t>(patch.w) * 4);
+                source = patched;
+            }
+            uint32_t* out = row + span.x;
+            if (state.scaled) {
+                const int* sourceColumns = columns.data() + state.columnOffset;
+                uint32_t* gathered = scratch.gathered.data();
+                for (int i = 0; i < span.w; i++) {
+                    gathered[i] = source[sourceColumns[i]];
+                }
+                kernels.over(out, gathered, span.w);
+            } else if (layers[l].flipped) {
+                kernels.overMirrored(out, source + (destRect.x + destRect.w - span.x - span.w), span.w);
+            } else {
+                kernels.over(out, source + (span.x - destRect.x), span.w);
+            }
+        }
+    }
+}
+
+void CpuCompositor::runBands(int bands) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bandCount = bands;
+        bandsRemaining = bands - 1;
+        generation++;
+    }
+    startCondition.notify_all();
+
+    job(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return bandsRemaining == 0; });
+}
+
+void CpuCompositor::workerMain(int band) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            if (band >= bandCount) {
+                continue; // region too small for this many bands
+            }
+        }
+
+        job(band);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--bandsRemaining == 0) {
+            doneCondition.notify_one();
+        }
+    }
+}
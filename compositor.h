@@ -0,0 +1,122 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Row kernels over premultiplied RGBA32 pixels (R,G,B,A byte order, one
+// uint32_t per pixel). All kernel sets produce bit-identical output.
+struct CompositeKernels {
+    const char* name;
+
+    // dst[0, count) = color
+    void (*fill)(uint32_t* dst, int count, uint32_t color);
+
+    // Source over destination: dst = src + dst * (255 - src alpha) / 255, per channel
+    void (*over)(uint32_t* dst, const uint32_t* src, int count);
+
+    // Same with the source row mirrored: dst[i] is composited with src[count - 1 - i]
+    void (*overMirrored)(uint32_t* dst, const uint32_t* src, int count);
+};
+
+// Best kernel set for the running CPU (selected once).
+// CHIEMODEL_SIMD=scalar|sse2|avx2|neon forces a specific set, as for color conversion.
+const CompositeKernels& getCompositeKernels();
+
+// Every kernel set the running CPU supports, scalar first
+std::vector<const CompositeKernels*> getAvailableCompositeKernels();
+
+// Premultiplied RGBA32 image for CpuCompositor (e.g. a CPU atlas region),
+// optionally with a face patch that replaces its pixels inside patchRect
+struct CompositeImage {
+    const uint32_t* pixels;
+    int pitch; // bytes
+    int width, height;
+    const uint32_t* patchPixels = nullptr; // patchRect.w x patchRect.h, none if null
+    int patchPitch = 0;
+    SDL_Rect patchRect = {0, 0, 0, 0};     // in image pixels
+};
+
+// One image of a frame: where it is placed (scaled if the sizes differ) and
+// whether it is mirrored
+struct CompositeLayer {
+    CompositeImage image;
+    SDL_Rect destRect;
+    bool flipped;
+};
+
+// Draws the avatars into a CPU frame without a GPU (headless output): the
+// background fill, then each layer at its destination rect, mirrored and/or
+// scaled (nearest neighbour, like SDL's default) during transitions. Every
+// row is filled and composited in one pass over all layers, so a scene of
+// many avatars touches each output row once. Large regions are split into
+// row bands composited in parallel by worker threads kept for the
+// compositor's lifetime.
+class CpuCompositor {
+private:
+    const CompositeKernels& kernels;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    std::function<void(int)> job; // composites band i
+    uint64_t generation;          // bumped for every parallel compose
+    int bandCount;
+    int bandsRemaining;           // worker bands still running
+    bool stopping;
+
+    // Per-band buffers: source rows with the patch in place, and gathered
+    // (scaled) rows; plus the shared column maps
+    struct BandScratch {
+        std::vector<uint32_t> patched;
+        std::vector<uint32_t> gathered;
+    };
+    std::vector<BandScratch> scratchRows;
+    std::vector<int> columns;
+
+    // What each layer of the current compose draws inside the repainted area
+    struct LayerSpan {
+        SDL_Rect span;    // destination pixels drawn, empty if none
+        SDL_Rect patch;   // part of the patch inside the image, empty without one
+        bool scaled;
+        int columnOffset; // first of span.w source columns in columns, if scaled
+    };
+    std::vector<LayerSpan> spans;
+
+    // Below this many pixels a region is composited on the calling thread
+    static constexpr int PARALLEL_MIN_PIXELS = 256 * 1024;
+    static constexpr int MIN_BAND_ROWS = 64;
+
+public:
+    // Up to maxBands row bands at once (0 = one per core, at most 4)
+    explicit CpuCompositor(int maxBands = 0);
+    ~CpuCompositor();
+
+    CpuCompositor(const CpuCompositor&) = delete;
+    CpuCompositor& operator=(const CpuCompositor&) = delete;
+
+    // Repaint region of a width x height frame: background, then the layers
+    // in order (later ones over earlier ones)
+    void compose(uint32_t* frame, int pitch, int width, int height, const SDL_Rect& region,
+                 uint32_t background, const CompositeLayer* layers, int layerCount);
+
+    const char* getKernelName() const { return kernels.name; }
+    int getMaxBands() const { return static_cast<int>(workers.size()) + 1; }
+
+private:
+    void composeRows(uint32_t* frame, int pitch, const SDL_Rect& region, int rowBegin, int rowEnd,
+                     uint32_t background, const CompositeLayer* layers, int layerCount, BandScratch& scratch);
+    void runBands(int bands);
+    void workerMain(int band);
+};
+
+// Premultiply straight-alpha RGBA32 pixels (rows of width) into dst, the format CpuCompositor draws
+void premultiplyRgba(const uint8_t* src, int srcPitch, uint32_t* dst, int dstPitch, int width, int height);
+
+#endif // COMPOSITOR_H
@@ -0,0 +1,75 @@
+// AVX2 kernels, built with -mavx2 and only called after a runtime CPU check
+
+#include "compositor_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+namespace {
+
+// Same math as the SSE2 kernels, 8 pixels per register
+inline __m256i over8(__m256i d, __m256i s) {
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    __m256i alpha = _mm256_and_si256(s, alphaMask);
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) == -1) {
+        return s;
+    }
+    if (_mm256_testz_si256(s, alphaMask)) {
+        return d;
+    }
+
+    // 255 - alpha in every byte of its pixel
+    const __m256i broadcastAlpha = _mm256_setr_epi8(
+        3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15,
+        3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+    __m256i inverse = _mm256_shuffle_epi8(_mm256_xor_si256(alpha, alphaMask), broadcastAlpha);
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(128);
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(inverse, zero)), round);
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(inverse, zero)), round);
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+    // Unpack and pack both work per 128-bit lane, so pixels stay in place
+    return _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi));
+}
+
+void fillAvx2(uint32_t* dst, int count, uint32_t color) {
+    const __m256i value = _mm256_set1_epi32(static_cast<int>(color));
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), value);
+    }
+    fillRowScalar(dst, x, count, color);
+}
+
+void overAvx2(uint32_t* dst, const uint32_t* src, int count) {
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + x));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), over8(d, s));
+    }
+    overRowScalar(dst, src, x, count);
+}
+
+void overMirroredAvx2(uint32_t* dst, const uint32_t* src, int count) {
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + x));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + count - x - 8));
+        s = _mm256_permutevar8x32_epi32(s, reverse);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), over8(d, s));
+    }
+    overMirroredRowScalar(dst, src, x, count);
+}
+
+} // namespace
+
+const CompositeKernels avx2CompositeKernels = {
+    "avx2", fillAvx2, overAvx2, overMirroredAvx2
+};
+
+#endif // x86
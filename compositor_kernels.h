@@ -0,0 +1,59 @@
+#ifndef COMPOSITOR_KERNELS_H
+#define COMPOSITOR_KERNELS_H
+
+// Internal to the compositor*.cpp kernels
+
+#include "compositor.h"
+#include <cstring>
+
+// x / 255 rounded, exact for x in [0, 255 * 255]; every SIMD kernel uses the
+// same shift-add form, so all of them match the scalar reference
+inline uint8_t div255(int x) {
+    int t = x + 128;
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+inline uint32_t overPixel(uint32_t dst, uint32_t src) {
+    uint8_t s[4], d[4];
+    std::memcpy(s, &src, 4);
+    std::memcpy(d, &dst, 4);
+    int inverse = 255 - s[3];
+    for (int c = 0; c < 4; c++) {
+        int value = s[c] + div255(d[c] * inverse);
+        d[c] = static_cast<uint8_t>(value > 255 ? 255 : value);
+    }
+    uint32_t result;
+    std::memcpy(&result, d, 4);
+    return result;
+}
+
+// Scalar row helpers, also used by SIMD kernels for the row tail
+inline void fillRowScalar(uint32_t* dst, int x, int count, uint32_t color) {
+    for (; x < count; x++) {
+        dst[x] = color;
+    }
+}
+
+inline void overRowScalar(uint32_t* dst, const uint32_t* src, int x, int count) {
+    for (; x < count; x++) {
+        dst[x] = overPixel(dst[x], src[x]);
+    }
+}
+
+inline void overMirroredRowScalar(uint32_t* dst, const uint32_t* src, int x, int count) {
+    for (; x < count; x++) {
+        dst[x] = overPixel(dst[x], src[count - 1 - x]);
+    }
+}
+
+// Kernel sets, defined only when built for a matching architecture
+extern const CompositeKernels scalarCompositeKernels;
+#if defined(__x86_64__) || defined(__i386__)
+extern const CompositeKernels sse2CompositeKernels;
+extern const CompositeKernels avx2CompositeKernels;
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+extern const CompositeKernels neonCompositeKernels;
+#endif
+
+#endif // COMPOSITOR_KERNELS_H
@@ -0,0 +1,102 @@
+// NEON kernels (always available on aarch64)
+
+#include "compositor_kernels.h"
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+namespace {
+
+// d * inverse / 255 rounded, the same shift-add form as div255
+inline uint8x8_t scaleNeon(uint8x8_t d, uint8x8_t inverse) {
+    uint16x8_t product = vmull_u8(d, inverse);
+    return vraddhn_u16(product, vrshrq_n_u16(product, 8));
+}
+
+// 16 pixels, deinterleaved into channel planes
+inline uint8x16x4_t over16(uint8x16x4_t d, uint8x16x4_t s) {
+    uint8x16_t inverse = vmvnq_u8(s.val[3]);
+    for (int c = 0; c < 4; c++) {
+        uint8x16_t scaled = vcombine_u8(scaleNeon(vget_low_u8(d.val[c]), vget_low_u8(inverse)),
+                                        scaleNeon(vget_high_u8(d.val[c]), vget_high_u8(inverse)));
+        d.val[c] = vqaddq_u8(s.val[c], scaled);
+    }
+    return d;
+}
+
+inline uint8_t minLane(uint8x16_t v) {
+#if defined(__aarch64__)
+    return vminvq_u8(v);
+#else
+    uint8x8_t m = vpmin_u8(vget_low_u8(v), vget_high_u8(v));
+    m = vpmin_u8(m, m);
+    m = vpmin_u8(m, m);
+    return vget_lane_u8(vpmin_u8(m, m), 0);
+#endif
+}
+
+inline uint8_t maxLane(uint8x16_t v) {
+#if defined(__aarch64__)
+    return vmaxvq_u8(v);
+#else
+    uint8x8_t m = vpmax_u8(vget_low_u8(v), vget_high_u8(v));
+    m = vpmax_u8(m, m);
+    m = vpmax_u8(m, m);
+    return vget_lane_u8(vpmax_u8(m, m), 0);
+#endif
+}
+
+inline uint8x16_t reverse16(uint8x16_t v) {
+    v = vrev64q_u8(v);
+    return vextq_u8(v, v, 8);
+}
+
+void fillNeon(uint32_t* dst, int count, uint32_t color) {
+    const uint32x4_t value = vdupq_n_u32(color);
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        vst1q_u32(dst + x, value);
+    }
+    fillRowScalar(dst, x, count, color);
+}
+
+void overNeon(uint32_t* dst, const uint32_t* src, int count) {
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        uint8x16x4_t s = vld4q_u8(reinterpret_cast<const uint8_t*>(src + x));
+        uint8_t* out = reinterpret_cast<uint8_t*>(dst + x);
+        if (minLane(s.val[3]) == 255) {
+            vst4q_u8(out, s);
+        } else if (maxLane(s.val[3]) != 0) {
+            vst4q_u8(out, over16(vld4q_u8(out), s));
+        }
+    }
+    overRowScalar(dst, src, x, count);
+}
+
+void overMirroredNeon(uint32_t* dst, const uint32_t* src, int count) {
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        // Reversing each channel plane reverses the pixel order
+        uint8x16x4_t s = vld4q_u8(reinterpret_cast<const uint8_t*>(src + count - x - 16));
+        for (int c = 0; c < 4; c++) {
+            s.val[c] = reverse16(s.val[c]);
+        }
+        uint8_t* out = reinterpret_cast<uint8_t*>(dst + x);
+        if (minLane(s.val[3]) == 255) {
+            vst4q_u8(out, s);
+        } else if (maxLane(s.val[3]) != 0) {
+            vst4q_u8(out, over16(vld4q_u8(out), s));
+        }
+    }
+    overMirroredRowScalar(dst, src, x, count);
+}
+
+} // namespace
+
+const CompositeKernels neonCompositeKernels = {
+    "neon", fillNeon, overNeon, overMirroredNeon
+};
+
+#endif // ARM
@@ -0,0 +1,72 @@
+// SSE2 kernels, built with -msse2 and only called after a runtime CPU check
+
+#include "compositor_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <emmintrin.h>
+
+namespace {
+
+// 4 pixels of src over dst; whole blocks of opaque or clear source skip the math
+inline __m128i over4(__m128i d, __m128i s) {
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    __m128i alpha = _mm_and_si128(s, alphaMask);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF) {
+        return s;
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128())) == 0xFFFF) {
+        return d;
+    }
+
+    // 255 - alpha in every byte of its pixel
+    __m128i inverse = _mm_srli_epi32(_mm_xor_si128(alpha, alphaMask), 24);
+    inverse = _mm_or_si128(inverse, _mm_slli_epi32(inverse, 8));
+    inverse = _mm_or_si128(inverse, _mm_slli_epi32(inverse, 16));
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(128);
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(inverse, zero)), round);
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(inverse, zero)), round);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    return _mm_adds_epu8(s, _mm_packus_epi16(lo, hi));
+}
+
+void fillSse2(uint32_t* dst, int count, uint32_t color) {
+    const __m128i value = _mm_set1_epi32(static_cast<int>(color));
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), value);
+    }
+    fillRowScalar(dst, x, count, color);
+}
+
+void overSse2(uint32_t* dst, const uint32_t* src, int count) {
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), over4(d, s));
+    }
+    overRowScalar(dst, src, x, count);
+}
+
+void overMirroredSse2(uint32_t* dst, const uint32_t* src, int count) {
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + count - x - 4));
+        s = _mm_shuffle_epi32(s, _MM_SHUFFLE(0, 1, 2, 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), over4(d, s));
+    }
+    overMirroredRowScalar(dst, src, x, count);
+}
+
+} // namespace
+
+const CompositeKernels sse2CompositeKernels = {
+    "sse2", fillSse2, overSse2, overMirroredSse2
+};
+
+#endif // x86
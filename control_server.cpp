@@ -0,0 +1,461 @@
+#include "control_server.h"
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+namespace {
+
+bool addCommand(ControlBatch& batch, const ControlCommand& command, std::string& error) {
+    if (batch.count >= ControlBatch::MAX_COMMANDS) {
+        error = "too many commands in one batch";
+        return false;
+    }
+    batch.commands[batch.count++] = command;
+    return true;
+}
+
+bool parseInt(const std::string& text, int& value) {
+    char* end = nullptr;
+    long parsed = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0') {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// OSC is big-endian and 4-byte aligned throughout
+uint32_t readBigEndian(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+bool readOscString(const uint8_t* data, size_t size, size_t& offset, std::string& out) {
+    const uint8_t* start = data + offset;
+    const uint8_t* end = static_cast<const uint8_t*>(memchr(start, '\0', size - offset));
+    if (!end) {
+        return false;
+    }
+    out.assign(reinterpret_cast<const char*>(start), end - start);
+    offset += (out.size() + 4) & ~static_cast<size_t>(3);
+    return offset <= size;
+}
+
+struct OscArgument {
+    char type;
+    int intValue;
+    std::string text;
+};
+
+bool parseOscMessage(const uint8_t* data, size_t size, ControlBatch& batch, std::string& error) {
+    size_t offset = 0;
+    std::string address, tags;
+    if (!readOscString(data, size, offset, address)) {
+        error = "malformed OSC address";
+        return false;
+    }
+    if (offset < size && !readOscString(data, size, offset, tags)) {
+        error = "malformed OSC type tags";
+        return false;
+    }
+
+    std::vector<OscArgument> arguments;
+    for (size_t i = 1; i < tags.size(); i++) {
+        OscArgument argument = {tags[i], 0, {}};
+        if (tags[i] == 'i' || tags[i] == 'f') {
+            if (offset + 4 > size) {
+                error = "truncated OSC argument";
+                return false;
+            }
+            uint32_t bits = readBigEndian(data + offset);
+            offset += 4;
+            if (tags[i] == 'i') {
+                argument.intValue = static_cast<int32_t>(bits);
+            } else {
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                argument.intValue = static_cast<int>(value + (value < 0 ? -0.5f : 0.5f));
+            }
+        } else if (tags[i] == 's') {
+            if (!readOscString(data, size, offset, argument.text)) {
+                error = "truncated OSC string";
+                return false;
+            }
+        } else if (tags[i] == 'T' || tags[i] == 'F') {
+            argument.intValue = tags[i] == 'T' ? 1 : 0;
+        } else {
+            error = std::string("unsupported OSC type '") + tags[i] + "'";
+            return false;
+        }
+        arguments.push_back(argument);
+    }
+
+    auto intArgument = [&arguments](size_t index, int fallback) {
+        return index < arguments.size() && arguments[index].type != 's' ? arguments[index].intValue : fallback;
+    };
+
+    ControlCommand command = {ControlCommand::Type::BLINK, 0, 0, 0};
+    if (address == "/avatar/pose" && !arguments.empty()) {
+        command = {ControlCommand::Type::SET_POSE, intArgument(0, 0), intArgument(1, 0), 0};
+    } else if (address == "/avatar/expression" && !arguments.empty()) {
+        command = {ControlCommand::Type::SET_EXPRESSION, 0, intArgument(0, 0), 0};
+    } else if (address == "/avatar/flip") {
+        command = {ControlCommand::Type::FLIP, 0, 0, intArgument(0, -1)};
+    } else if (address == "/avatar/blink") {
+        command = {ControlCommand::Type::BLINK, 0, 0, 0};
+    } else if (address == "/avatar/key" && arguments.size() == 1 && arguments[0].text.size() == 1) {
+        int key = std::tolower(static_cast<unsigned char>(arguments[0].text[0]));
+        command = {ControlCommand::Type::KEY, 0, 0, key};
+    } else if (address == "/avatar/select" && !arguments.empty()) {
+        command = {ControlCommand::Type::SELECT, 0, 0, intArgument(0, 0)};
+    } else {
+        error = "unknown OSC message " + address;
+        return false;
+    }
+    return addCommand(batch, command, error);
+}
+
+bool parseOscPacket(const uint8_t* data, size_t size, ControlBatch& batch, std::string& error, int depth) {
+    static const char BUNDLE[] = "#bundle";
+    if (size < sizeof(BUNDLE) || memcmp(data, BUNDLE, sizeof(BUNDLE)) != 0) {
+        return parseOscMessage(data, size, batch, error);
+    }
+
+    if (depth > 4) {
+        error = "OSC bundles nested too deep";
+        return false;
+    }
+
+    // "#bundle\0", 8-byte time tag (ignored: applied on arrival), sized elements
+    size_t offset = 16;
+    while (offset + 4 <= size) {
+        uint32_t length = readBigEndian(data + offset);
+        offset += 4;
+        if (length > size - offset || (length & 3)) {
+            error = "malformed OSC bundle";
+            return false;
+        }
+        if (!parseOscPacket(data + offset, length, batch, error, depth + 1)) {
+            return false;
+        }
+        offset += length;
+    }
+    return true;
+}
+
+} // namespace
+
+ControlServer::ControlServer(const std::string& unixSocketPath, int udpPort)
+    : socketPath(unixSocketPath)
+    , oscPort(udpPort)
+    , listenFd(-1), udpFd(-1)
+    , dropped(0)
+    , running(false) {
+}
+
+ControlServer::~ControlServer() {
+    stop();
+}
+
+bool ControlServer::start() {
+    if (running) return true;
+
+    bool unixOpen = !socketPath.empty() && openUnixSocket();
+    bool udpOpen = oscPort > 0 && openUdpSocket();
+    if (!unixOpen && !udpOpen) {
+        closeAll();
+        return false;
+    }
+
+    running = true;
+    ioThread = std::thread(&ControlServer::ioLoop, this);
+    return true;
+}
+
+void ControlServer::stop() {
+    running = false;
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+    closeAll();
+}
+
+bool ControlServer::openUnixSocket() {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Control socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        std::cerr << "Failed to create control socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // A stale socket from a previous run would make bind fail. Only a socket
+    // nobody answers on is removed: never a regular file, nor the live socket
+    // of another instance.
+    struct stat info;
+    if (lstat(socketPath.c_str(), &info) == 0) {
+        bool stale = false;
+        if (S_ISSOCK(info.st_mode)) {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            stale = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0;
+            if (probe >= 0) {
+                ::close(probe);
+            }
+        }
+        if (!stale) {
+            std::cerr << "Control socket path " << socketPath
+                      << (S_ISSOCK(info.st_mode) ? " is in use by another instance" : " exists and is not a socket")
+                      << std::endl;
+            ::close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+        unlink(socketPath.c_str());
+    }
+
+    // Created owner-only: the socket is never connectable with the umask's permissions
+    mode_t previousMask = umask(0177);
+    bool bound = bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    int bindError = errno;
+    umask(previousMask);
+    if (!bound || listen(listenFd, 8) != 0) {
+        std::cerr << "Failed to listen on " << socketPath << ": " << strerror(bound ? errno : bindError) << std::endl;
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    std::cout << "Control socket listening on " << socketPath << std::endl;
+    return true;
+}
+
+bool ControlServer::openUdpSocket() {
+    udpFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (udpFd < 0) {
+        std::cerr << "Failed to create OSC socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Local controllers only (stream deck bridges, bots on this host)
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(oscPort));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(udpFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Failed to bind OSC port " << oscPort << ": " << strerror(errno) << std::endl;
+        ::close(udpFd);
+        udpFd = -1;
+        return false;
+    }
+
+    std::cout << "OSC listening on 127.0.0.1:" << oscPort << std::endl;
+    return true;
+}
+
+void ControlServer::closeAll() {
+    for (auto& client : clients) {
+        ::close(client.fd);
+    }
+    clients.clear();
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        listenFd = -1;
+        unlink(socketPath.c_str());
+    }
+    if (udpFd >= 0) {
+        ::close(udpFd);
+        udpFd = -1;
+    }
+}
+
+void ControlServer::ioLoop() {
+    std::vector<pollfd> fds;
+    uint8_t datagram[2048];
+
+    while (running) {
+        fds.clear();
+        if (listenFd >= 0) fds.push_back({listenFd, POLLIN, 0});
+        if (udpFd >= 0) fds.push_back({udpFd, POLLIN, 0});
+        size_t firstClient = fds.size();
+        for (const auto& client : clients) {
+            fds.push_back({client.fd, POLLIN, 0});
+        }
+
+        // Poll with a timeout so stop() never waits long
+        int ready = poll(fds.data(), fds.size(), 100);
+        if (ready <= 0) {
+            continue;
+        }
+
+        for (size_t i = 0; i < firstClient; i++) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            if (fds[i].fd == listenFd) {
+                acceptClient();
+                continue;
+            }
+
+            ssize_t size;
+            while ((size = recv(udpFd, datagram, sizeof(datagram), 0)) > 0) {
+                ControlBatch batch = {};
+                batch.received = std::chrono::steady_clock::now();
+                std::string error;
+                if (parseOsc(datagram, static_cast<size_t>(size), batch, error)) {
+                    submit(batch);
+                } else {
+                    std::cerr << "OSC: " << error << std::endl;
+                }
+            }
+        }
+
+        // Clients accepted above are not in fds yet; their turn comes next poll
+        size_t clientCount = fds.size() - firstClient;
+        for (size_t i = clientCount; i-- > 0;) {
+            if (fds[firstClient + i].revents && !readClient(clients[i])) {
+                ::close(clients[i].fd);
+                clients.erase(clients.begin() + static_cast<long>(i));
+            }
+        }
+    }
+}
+
+void ControlServer::acceptClient() {
+    int fd;
+    while ((fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (clients.size() >= MAX_CLIENTS) {
+            ::close(fd);
+            continue;
+        }
+        clients.push_back({fd, {}});
+    }
+}
+
+bool ControlServer::readClient(Client& client) {
+    char buffer[512];
+    while (true) {
+        ssize_t count = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (count == 0) {
+            return false;
+        }
+        if (count < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+
+        auto received = std::chrono::steady_clock::now();
+        client.pending.append(buffer, static_cast<size_t>(count));
+        size_t newline;
+        while ((newline = client.pending.find('\n')) != std::string::npos) {
+            std::string line = client.pending.substr(0, newline);
+            client.pending.erase(0, newline + 1);
+
+            ControlBatch batch = {};
+            batch.received = received;
+            std::string error;
+            std::string reply = "ok\n";
+            if (!parseLine(line, batch, error)) {
+                reply = "error " + error + "\n";
+            } else if (batch.count > 0 && !submit(batch)) {
+                reply = "error busy\n";
+            }
+            send(client.fd, reply.data(), reply.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+
+        if (client.pending.size() > MAX_LINE) {
+            return false; // not speaking the protocol
+        }
+    }
+}
+
+bool ControlServer::submit(ControlBatch& batch) {
+    if (!queue.push(batch)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (wakeCallback) {
+        wakeCallback();
+    }
+    return true;
+}
+
+bool ControlServer::parseLine(const std::string& line, ControlBatch& batch, std::string& error) {
+    std::stringstream commands(line);
+    std::string text;
+    while (std::getline(commands, text, ';')) {
+        std::istringstream fields(text);
+        std::vector<std::string> words;
+        for (std::string word; fields >> word;) {
+            words.push_back(word);
+        }
+        if (words.empty()) {
+            continue;
+        }
+
+        const std::string& verb = words[0];
+        ControlCommand command = {ControlCommand::Type::BLINK, 0, 0, 0};
+        if (verb == "pose" && (words.size() == 2 || words.size() == 3)) {
+            command.type = ControlCommand::Type::SET_POSE;
+            if (!parseInt(words[1], command.pose) || (words.size() == 3 && !parseInt(words[2], command.expression))) {
+                error = "pose expects <id> [<expression>]";
+                return false;
+            }
+        } else if ((verb == "expression" || verb == "expr") && words.size() == 2) {
+            command.type = ControlCommand::Type::SET_EXPRESSION;
+            if (!parseInt(words[1], command.expression)) {
+                error = "expression expects a number";
+                return false;
+            }
+        } else if (verb == "flip" && words.size() <= 2) {
+            command.type = ControlCommand::Type::FLIP;
+            command.value = -1;
+            if (words.size() == 2) {
+                if (words[1] != "on" && words[1] != "off") {
+                    error = "flip expects on or off";
+                    return false;
+                }
+                command.value = words[1] == "on" ? 1 : 0;
+            }
+        } else if (verb == "blink" && words.size() == 1) {
+            command.type = ControlCommand::Type::BLINK;
+        } else if (verb == "key" && words.size() == 2 && words[1].size() == 1) {
+            command.type = ControlCommand::Type::KEY;
+            command.value = std::tolower(static_cast<unsigned char>(words[1][0]));
+        } else if (verb == "avatar" && words.size() == 2) {
+            command.type = ControlCommand::Type::SELECT;
+            if (!parseInt(words[1], command.value)) {
+                error = "avatar expects a number";
+                return false;
+            }
+        } else {
+            error = "unknown command '" + text + "'";
+            return false;
+        }
+
+        if (!addCommand(batch, command, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ControlServer::parseOsc(const uint8_t* data, size_t size, ControlBatch& batch, std::string& error) {
+    return parseOscPacket(data, size, batch, error, 0);
+}
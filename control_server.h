@@ -0,0 +1,112 @@
+#ifndef CONTROL_SERVER_H
+#define CONTROL_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_queue.h"
+
+// One avatar change requested over the control API
+struct ControlCommand {
+    enum class Type : uint8_t {
+        SET_POSE,       // pose, expression (0 = the pose's default)
+        SET_EXPRESSION, // expression
+        FLIP,           // value: 0 off, 1 on, -1 toggle
+        BLINK,
+        KEY,            // value: key code, handled like a key press (no cooldown)
+        SELECT          // value: avatar (1-based) the following commands apply to
+    };
+
+    Type type;
+    int pose;
+    int expression;
+    int value;
+};
+
+// Commands that arrived together (one line, datagram or OSC bundle) and are
+// applied in the same tick
+struct ControlBatch {
+    static constexpr int MAX_COMMANDS = 8;
+
+    ControlCommand commands[MAX_COMMANDS];
+    int count;
+    std::chrono::steady_clock::time_point received; // for command-to-frame latency
+};
+
+// Remote control without synthetic key presses: a Unix domain stream socket
+// taking text commands, and optionally an OSC listener on a UDP port, served
+// by one I/O thread. Parsed batches go into a lock-free SPSC queue that the
+// main loop drains, woken through the callback.
+//
+// Text protocol, one line per batch, commands separated by ';', one reply line
+// ("ok" or "error <reason>") per batch:
+//   pose <id> [<expression>] | expression <n> | flip [on|off] | blink | key <c> | avatar <n>
+// OSC addresses: /avatar/pose i [i], /avatar/expression i, /avatar/flip [i],
+// /avatar/blink, /avatar/key s, /avatar/select i (floats accepted for ints);
+// a bundle is one batch. A selection stays in effect for later batches.
+class ControlServer {
+private:
+    std::string socketPath;
+    int oscPort;
+    int listenFd;
+    int udpFd;
+    struct Client {
+        int fd;
+        std::string pending; // partial line
+    };
+    std::vector<Client> clients;
+
+    SpscQueue<ControlBatch, 64> queue;
+    std::function<void()> wakeCallback;
+    std::atomic<uint64_t> dropped;
+
+    std::thread ioThread;
+    std::atomic<bool> running;
+
+    static constexpr size_t MAX_CLIENTS = 16;
+    static constexpr size_t MAX_LINE = 1024;
+
+public:
+    // Empty path or port 0 disables that listener
+    ControlServer(const std::string& unixSocketPath, int udpPort);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // Called from the I/O thread after each queued batch (set before start)
+    void setWakeCallback(std::function<void()> callback) { wakeCallback = std::move(callback); }
+
+    // Bind the listeners and start the I/O thread; false if none could be opened
+    bool start();
+    void stop();
+
+    // Main thread: next queued batch; false when the queue is empty
+    bool pop(ControlBatch& batch) { return queue.pop(batch); }
+
+    // Batches dropped because the main loop fell behind
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Parse one text line into batch; false with a reason on a syntax error
+    static bool parseLine(const std::string& line, ControlBatch& batch, std::string& error);
+
+    // Parse one OSC packet (message or bundle) into batch
+    static bool parseOsc(const uint8_t* data, size_t size, ControlBatch& batch, std::string& error);
+
+private:
+    bool openUnixSocket();
+    bool openUdpSocket();
+    void ioLoop();
+    void acceptClient();
+    bool readClient(Client& client); // false when the client went away
+    bool submit(ControlBatch& batch);
+    void closeAll();
+};
+
+#endif // CONTROL_SERVER_H
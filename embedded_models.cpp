@@ -1,10 +1,6 @@
 #include "embedded_models.h"
 
 #include <cstddef>
-#include <fstream>
-#include <iostream>
-#include <filesystem>
-#include <sys/stat.h>
 
 // Embedded image: 1-1.png
 static const unsigned char image_1_1_png[] = {
@@ -245505,32 +245501,12 @@ const EmbeddedImage embedded_images[] = {
 
 const int embedded_images_count = 20;
 
-// Function to extract embedded images to a temporary directory
-std::string extractEmbeddedImagesToTemp() {
-    // Create a unique temporary directory
-    std::string temp_dir;
-    char template_dir[] = "/tmp/chiemodel-XXXXXX";
-    char* result = mkdtemp(template_dir);
-    if (result == nullptr) {
-        std::cerr << "Failed to create temporary directory for embedded models!" << std::endl;
-        return "";
-    }
-
-    temp_dir = result;
-    std::cout << "Extracting embedded models to: " << temp_dir << std::endl;
-
-    // Extract each image
+// Find an embedded image by file name, nullptr if not embedded
+const EmbeddedImage* findEmbeddedImage(const std::string& name) {
     for (int i = 0; i < embedded_images_count; i++) {
-        std::string file_path = temp_dir + "/" + embedded_images[i].name;
-        std::ofstream outfile(file_path, std::ios::binary);
-        if (!outfile) {
-            std::cerr << "Failed to write embedded image: " << embedded_images[i].name << std::endl;
-            continue;
+        if (name == embedded_images[i].name) {
+            return &embedded_images[i];
         }
-        outfile.write(reinterpret_cast<const char*>(embedded_images[i].data), embedded_images[i].size);
-        outfile.close();
-        std::cout << "Extracted: " << embedded_images[i].name << std::endl;
     }
-
-    return temp_dir;
+    return nullptr;
 }
@@ -15,7 +15,8 @@ struct EmbeddedImage {
 extern const EmbeddedImage embedded_images[];
 extern const int embedded_images_count;
 
-// Helper function to extract embedded images to a temporary directory
-std::string extractEmbeddedImagesToTemp();
+// Find an embedded image by file name (e.g. "1-2.png"), nullptr if not embedded.
+// Decode in place with IMG_Load_RW(SDL_RWFromConstMem(data, size), 1).
+const EmbeddedImage* findEmbeddedImage(const std::string& name);
 
 #endif // EMBEDDED_MODELS_H
@@ -0,0 +1,89 @@
+#include "file_watcher.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+FileWatcher::FileWatcher(const std::string& watchedDirectory)
+    : directory(watchedDirectory)
+    , inotifyFd(-1), watchDescriptor(-1)
+    , running(false) {
+}
+
+FileWatcher::~FileWatcher() {
+    stop();
+}
+
+bool FileWatcher::start() {
+    if (running) return true;
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        std::cerr << "Failed to initialize inotify: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watchDescriptor < 0) {
+        std::cerr << "Failed to watch " << directory << ": " << strerror(errno) << std::endl;
+        ::close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+
+    running = true;
+    watchThread = std::thread(&FileWatcher::watchLoop, this);
+    std::cout << "Watching " << directory << " for changes" << std::endl;
+    return true;
+}
+
+void FileWatcher::stop() {
+    running = false;
+    if (watchThread.joinable()) {
+        watchThread.join();
+    }
+    if (inotifyFd >= 0) {
+        ::close(inotifyFd); // removes the watch
+        inotifyFd = -1;
+        watchDescriptor = -1;
+    }
+}
+
+void FileWatcher::watchLoop() {
+    // Events are variable length; the buffer must be aligned for inotify_event
+    alignas(inotify_event) char buffer[4096];
+    std::vector<std::string> changed;
+    auto lastEvent = std::chrono::steady_clock::now();
+
+    while (running) {
+        // Short timeout while changes wait for the quiet period, and so stop() never waits long
+        pollfd fd = {inotifyFd, POLLIN, 0};
+        int timeout = changed.empty() ? 100 : static_cast<int>(QUIET_PERIOD.count() / 3);
+        if (poll(&fd, 1, timeout) > 0) {
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* position = buffer; position < buffer + length;) {
+                    auto* event = reinterpret_cast<inotify_event*>(position);
+                    if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                        std::string name(event->name);
+                        if (std::find(changed.begin(), changed.end(), name) == changed.end()) {
+                            changed.push_back(name);
+                        }
+                    }
+                    position += sizeof(inotify_event) + event->len;
+                }
+                lastEvent = std::chrono::steady_clock::now();
+            }
+        }
+
+        if (!changed.empty() && std::chrono::steady_clock::now() - lastEvent >= QUIET_PERIOD) {
+            if (changeCallback) {
+                changeCallback(changed);
+            }
+            changed.clear();
+        }
+    }
+}
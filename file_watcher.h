@@ -0,0 +1,47 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reports files written in a directory (inotify on Linux), on its own thread.
+// A file counts when it is closed after writing or moved in, which is how
+// editors and exporters save. Names are collected until the directory has
+// been quiet for a moment, so one save (or a batch export) is delivered once.
+class FileWatcher {
+private:
+    std::string directory;
+    int inotifyFd;
+    int watchDescriptor;
+    std::function<void(const std::vector<std::string>&)> changeCallback;
+
+    std::thread watchThread;
+    std::atomic<bool> running;
+
+    const std::chrono::milliseconds QUIET_PERIOD{150};
+
+public:
+    explicit FileWatcher(const std::string& watchedDirectory);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Called on the watch thread with the file names (no directory) that changed (set before start)
+    void setChangeCallback(std::function<void(const std::vector<std::string>&)> callback) {
+        changeCallback = std::move(callback);
+    }
+
+    // Start watching; false if the directory cannot be watched
+    bool start();
+    void stop();
+
+private:
+    void watchLoop();
+};
+
+#endif // FILE_WATCHER_H
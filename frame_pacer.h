@@ -0,0 +1,65 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+
+// Schedules animation frames of one render target at its present rate (the
+// display refresh, or the frame rate of what consumes the output) instead of
+// a fixed 16 ms tick. Owned by the thread that presents the target.
+//
+// With vsync, a present returns at a vblank: the next frame is started a
+// render margin before the following one so its present lands on it rather
+// than sleeping on top of the vsync wait. Without vsync, frames stay on a
+// fixed grid so cadence does not drift with render time. Missed slots are
+// skipped, never caught up with a burst.
+class FramePacer {
+public:
+    static constexpr double DEFAULT_RATE = 60.0;
+
+private:
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point phase; // last vblank (vsync) or grid slot
+    bool hasPhase;
+    bool vsync;
+
+public:
+    explicit FramePacer(double rate = DEFAULT_RATE, bool presentsOnVsync = false)
+        : hasPhase(false) {
+        setRate(rate, presentsOnVsync);
+    }
+
+    // Frames per second (non-positive: DEFAULT_RATE); vsync if presents block on vblank
+    void setRate(double rate, bool presentsOnVsync) {
+        if (!(rate > 0)) rate = DEFAULT_RATE;
+        interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / rate));
+        vsync = presentsOnVsync;
+        hasPhase = false;
+    }
+
+    std::chrono::steady_clock::duration getInterval() const { return interval; }
+
+    // A present just returned at time now
+    void presented(std::chrono::steady_clock::time_point now) {
+        if (vsync || !hasPhase || now < phase || now - phase >= 4 * interval) {
+            phase = now;
+        } else {
+            phase += ((now - phase) / interval) * interval;
+        }
+        hasPhase = true;
+    }
+
+    // When to start drawing the next frame, always after now
+    std::chrono::steady_clock::time_point nextFrameTime(std::chrono::steady_clock::time_point now) const {
+        if (!hasPhase) {
+            return now + interval;
+        }
+        auto next = phase + interval - (vsync ? interval / 4 : std::chrono::steady_clock::duration::zero());
+        if (next <= now) {
+            next += ((now - next) / interval + 1) * interval;
+        }
+        return next;
+    }
+};
+
+#endif // FRAME_PACER_H
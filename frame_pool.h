@@ -0,0 +1,69 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Fixed-size frame buffers for consumers that keep frames past
+// FrameSink::pushFrame (e.g. handing them to a writer thread). Buffers are
+// allocated on first use, up to maxFrames, and recycled when the last owner
+// lets go, so a steady stream allocates nothing. acquire() and the release
+// are thread safe; the pool must outlive every frame it hands out.
+class FramePool {
+public:
+    struct Recycler {
+        FramePool* pool = nullptr;
+        void operator()(uint8_t* buffer) const { pool->recycle(buffer); }
+    };
+    using Frame = std::unique_ptr<uint8_t[], Recycler>;
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<uint8_t[]>> freeBuffers;
+    size_t frameBytes;
+    size_t maxFrames;
+    size_t allocated;
+
+public:
+    FramePool(size_t bytesPerFrame, size_t frameLimit)
+        : frameBytes(bytesPerFrame), maxFrames(frameLimit), allocated(0) {
+        freeBuffers.reserve(frameLimit);
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // A free buffer of getFrameBytes() bytes (old contents); null once all are in use
+    Frame acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeBuffers.empty()) {
+            Frame frame(freeBuffers.back().release(), Recycler{this});
+            freeBuffers.pop_back();
+            return frame;
+        }
+        if (allocated == maxFrames) {
+            return Frame(nullptr, Recycler{this});
+        }
+        allocated++;
+        return Frame(new uint8_t[frameBytes], Recycler{this});
+    }
+
+    size_t getFrameBytes() const { return frameBytes; }
+
+    // Buffers ever allocated (never more than the limit)
+    size_t getAllocatedCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return allocated;
+    }
+
+private:
+    void recycle(uint8_t* buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeBuffers.emplace_back(buffer);
+    }
+};
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,29 @@
+#ifndef FRAME_SINK_H
+#define FRAME_SINK_H
+
+#include <SDL2/SDL.h>
+#include <chrono>
+
+// Where OutputPipeline sends composited output frames (virtual camera, shared
+// memory). Called on the thread that draws the output.
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+
+    // New RGBA32 frame (R,G,B,A byte order); only dirtyRect differs from the previous one
+    virtual void pushFrame(const void* rgbaPixels, int pitch, const SDL_Rect& dirtyRect) = 0;
+
+    // Consumers that need a steady stream write the last frame again
+    virtual void repeatFrame() {}
+
+    // Frames per second the consumer takes, 0 if it takes whatever arrives;
+    // paces a headless output
+    virtual double getFrameRate() const { return 0.0; }
+
+    // When repeatFrame() next has work to do; time_point::max() if never
+    virtual std::chrono::steady_clock::time_point getNextRepeatTime() const {
+        return std::chrono::steady_clock::time_point::max();
+    }
+};
+
+#endif // FRAME_SINK_H
@@ -0,0 +1,299 @@
+#!/usr/bin/env python3
+"""Build a pre-decoded, memory-mappable asset pack from <pose>-<expression>.png files.
+
+ResourceManager mmaps the pack and wraps each image in an SDL_Surface without
+copying or decoding, so startup does no PNG work and pixels stay in the page
+cache shared between instances.
+
+Expressions of a pose differ from each other only around the face, so each
+pose keeps one whole base image (its lowest expression above 0) and every
+other expression is stored as the bounding box of its pixels that differ from
+the base. The runtime draws the base with that patch in place, which cuts
+decoded memory and atlas uploads to a fraction. Images that differ over more
+than half their area are stored whole; --no-patches stores everything whole.
+Expression 0 is always stored whole: base_expression 0 means "not a patch".
+
+Layout (little endian):
+  header, 64 bytes:
+    char     magic[8]      "CHIEPAK\\0"
+    uint32   version       2
+    uint32   entry_count
+    uint32   pixel_format  SDL_PixelFormatEnum of the stored pixels
+    uint32   index_offset  offset of the entry table
+    uint32   alignment     alignment of every pixel block (page size)
+    uint8    reserved[36]
+  entry table, 56 bytes per entry:
+    int32    pose, expression
+    uint32   width, height, pitch
+    uint32   compression   0 = raw, 1 = LZ4 block
+    uint64   offset        start of the pixel block
+    uint32   stored_size   bytes in the file
+    uint32   raw_size      bytes once decompressed (pitch * height)
+    int32    base_expression  0 = stored whole, else a patch over that expression
+    uint32   patch_x, patch_y top-left of the patch in the base image
+    uint32   reserved
+  pixel blocks, each aligned to `alignment`
+"""
+import os
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = b"CHIEPAK\0"
+VERSION = 2
+ALIGNMENT = 4096
+HEADER_SIZE = 64
+ENTRY_FORMAT = "<iiIIIIQIIiIII"
+ENTRY_SIZE = struct.calcsize(ENTRY_FORMAT)
+
+# SDL_PixelFormatEnum values (stable SDL2 ABI)
+PIXEL_FORMATS = {
+    "argb8888": 0x16362004,  # bytes B,G,R,A - preferred by the GL/D3D renderers
+    "abgr8888": 0x16762004,  # bytes R,G,B,A
+}
+
+IMAGE_NAME = re.compile(r"^(\d+)-(\d+)\.png$")
+
+# Largest patch, as a fraction of the image area, still worth storing as one
+MAX_PATCH_FRACTION = 0.5
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def decode_png(path):
+    """Decode an 8-bit non-interlaced PNG to (width, height, RGBA bytes)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError(f"{path}: not a PNG file")
+
+    pos = 8
+    idat = bytearray()
+    palette = None
+    transparency = None
+    while pos < len(data):
+        length, chunk_type = struct.unpack(">I4s", data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        if chunk_type == b"IHDR":
+            width, height, depth, color_type, _, _, interlace = struct.unpack(">IIBBBBB", chunk)
+        elif chunk_type == b"PLTE":
+            palette = chunk
+        elif chunk_type == b"tRNS":
+            transparency = chunk
+        elif chunk_type == b"IDAT":
+            idat += chunk
+        elif chunk_type == b"IEND":
+            break
+        pos += 12 + length
+
+    if depth != 8 or interlace != 0:
+        raise ValueError(f"{path}: only 8-bit non-interlaced PNGs are supported")
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color_type]
+    stride = width * channels
+    raw = zlib.decompress(bytes(idat))
+    pixels = bytearray(stride * height)
+    prior = bytearray(stride)
+
+    # Undo per-row filters
+    for y in range(height):
+        filter_type = raw[y * (stride + 1)]
+        row = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        if filter_type == 1:
+            for i in range(channels, stride):
+                row[i] = (row[i] + row[i - channels]) & 0xFF
+        elif filter_type == 2:
+            row = bytearray((r + p) & 0xFF for r, p in zip(row, prior))
+        elif filter_type == 3:
+            for i in range(stride):
+                left = row[i - channels] if i >= channels else 0
+                row[i] = (row[i] + ((left + prior[i]) >> 1)) & 0xFF
+        elif filter_type == 4:
+            for i in range(stride):
+                left = row[i - channels] if i >= channels else 0
+                up_left = prior[i - channels] if i >= channels else 0
+                row[i] = (row[i] + paeth(left, prior[i], up_left)) & 0xFF
+        pixels[y * stride:(y + 1) * stride] = row
+        prior = row
+
+    # Expand to RGBA
+    count = width * height
+    rgba = bytearray(count * 4)
+    if color_type == 6:
+        rgba[:] = pixels
+    elif color_type == 2:
+        for c in range(3):
+            rgba[c::4] = pixels[c::3]
+        rgba[3::4] = b"\xff" * count
+    elif color_type == 0 or color_type == 4:
+        for c in range(3):
+            rgba[c::4] = pixels[0::channels]
+        rgba[3::4] = pixels[1::2] if color_type == 4 else b"\xff" * count
+    else:
+        alpha = (transparency or b"") + b"\xff" * 256
+        for i, index in enumerate(pixels):
+            rgba[i * 4:i * 4 + 3] = palette[index * 3:index * 3 + 3]
+            rgba[i * 4 + 3] = alpha[index]
+
+    return width, height, rgba
+
+
+def to_pixel_format(rgba, pixel_format):
+    if pixel_format == "abgr8888":
+        return bytes(rgba)
+    out = bytearray(len(rgba))
+    out[0::4] = rgba[2::4]
+    out[1::4] = rgba[1::4]
+    out[2::4] = rgba[0::4]
+    out[3::4] = rgba[3::4]
+    return bytes(out)
+
+
+def diff_rect(width, base, rgba):
+    """Bounding box (x, y, w, h) of the pixels that differ between two RGBA
+    images of the same size, None if they are identical."""
+    stride = width * 4
+    top = bottom = None
+    left, right = width, -1
+    for y in range(len(base) // stride):
+        row_base = base[y * stride:(y + 1) * stride]
+        row = rgba[y * stride:(y + 1) * stride]
+        if row_base == row:
+            continue
+        first = 0
+        while row_base[first * 4:first * 4 + 4] == row[first * 4:first * 4 + 4]:
+            first += 1
+        last = width - 1
+        while row_base[last * 4:last * 4 + 4] == row[last * 4:last * 4 + 4]:
+            last -= 1
+        left, right = min(left, first), max(right, last)
+        top = y if top is None else top
+        bottom = y
+    if top is None:
+        return None
+    return left, top, right - left + 1, bottom - top + 1
+
+
+def crop(width, rgba, rect):
+    x, y, w, h = rect
+    stride = width * 4
+    return b"".join(bytes(rgba[(y + row) * stride + x * 4:(y + row) * stride + (x + w) * 4]) for row in range(h))
+
+
+def align(offset):
+    return (offset + ALIGNMENT - 1) // ALIGNMENT * ALIGNMENT
+
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith("--")]
+    flags = [a for a in sys.argv[1:] if a.startswith("--")]
+
+    if len(args) < 2:
+        print(f"Usage: {sys.argv[0]} <model_dir> <output_pak_file> [--lz4] [--no-patches] "
+              "[--format=argb8888|abgr8888]")
+        sys.exit(1)
+
+    model_dir, output_file = args[0], args[1]
+    use_lz4 = "--lz4" in flags
+    use_patches = "--no-patches" not in flags
+    pixel_format = "argb8888"
+    for flag in flags:
+        if flag.startswith("--format="):
+            pixel_format = flag.split("=", 1)[1]
+    if pixel_format not in PIXEL_FORMATS:
+        print(f"Error: unknown pixel format {pixel_format}")
+        sys.exit(1)
+
+    if use_lz4:
+        try:
+            import lz4.block
+        except ImportError:
+            print("Error: --lz4 needs the python 'lz4' package (pip install lz4)")
+            sys.exit(1)
+
+    if not os.path.isdir(model_dir):
+        print(f"Error: {model_dir} is not a directory")
+        sys.exit(1)
+
+    images = []
+    for file in os.listdir(model_dir):
+        match = IMAGE_NAME.match(file)
+        if match:
+            images.append((int(match.group(1)), int(match.group(2)), file))
+
+    if not images:
+        print(f"Error: No <pose>-<expression>.png files found in {model_dir}")
+        sys.exit(1)
+
+    # Sort to ensure consistent ordering
+    images.sort()
+
+    # Lowest expression of every pose (sorted, so the first seen). Never 0:
+    # patches name their base in base_expression, where 0 means stored whole.
+    # Expression 0 sorts before the base, so it is stored whole too.
+    bases = {}
+    for pose, expression, _ in images:
+        if expression != 0:
+            bases.setdefault(pose, expression)
+
+    entries = []
+    blocks = []
+    base_images = {}
+    whole_bytes = 0
+    offset = align(HEADER_SIZE + ENTRY_SIZE * len(images))
+    for pose, expression, file in images:
+        width, height, rgba = decode_png(os.path.join(model_dir, file))
+        whole_bytes += width * height * 4
+        base_expression, patch_x, patch_y = 0, 0, 0
+        if expression == bases.get(pose):
+            base_images[pose] = (width, height, rgba)
+        elif use_patches and pose in base_images and base_images[pose][:2] == (width, height):
+            # Identical to the base: a single pixel of it keeps the entry valid
+            rect = diff_rect(width, base_images[pose][2], rgba) or (0, 0, 1, 1)
+            if rect[2] * rect[3] <= width * height * MAX_PATCH_FRACTION:
+                base_expression, patch_x, patch_y = bases[pose], rect[0], rect[1]
+                rgba = crop(width, rgba, rect)
+                width, height = rect[2], rect[3]
+        pixels = to_pixel_format(rgba, pixel_format)
+        stored = pixels
+        compression = 0
+        if use_lz4:
+            compressed = lz4.block.compress(pixels, store_size=False)
+            if len(compressed) < len(pixels):
+                stored, compression = compressed, 1
+
+        entries.append(struct.pack(ENTRY_FORMAT, pose, expression, width, height, width * 4,
+                                   compression, offset, len(stored), len(pixels),
+                                   base_expression, patch_x, patch_y, 0))
+        blocks.append((offset, stored))
+        offset = align(offset + len(stored))
+        if base_expression:
+            print(f"Packed {file}: {width}x{height} patch at {patch_x},{patch_y} over "
+                  f"{pose}-{base_expression}, {len(stored)} bytes")
+        else:
+            print(f"Packed {file}: {width}x{height}, {len(stored)} bytes")
+
+    with open(output_file, "wb") as f:
+        header = struct.pack("<8sIIIII", MAGIC, VERSION, len(entries),
+                             PIXEL_FORMATS[pixel_format], HEADER_SIZE, ALIGNMENT)
+        f.write(header.ljust(HEADER_SIZE, b"\0"))
+        f.write(b"".join(entries))
+        for block_offset, stored in blocks:
+            f.seek(block_offset)
+            f.write(stored)
+        f.truncate(offset)
+
+    pixel_bytes = sum(len(stored) for _, stored in blocks)
+    print(f"Generated asset pack with {len(entries)} images in {output_file} "
+          f"({pixel_bytes} pixel bytes, {whole_bytes} stored whole)")
+
+
+if __name__ == "__main__":
+    main()
@@ -2,14 +2,174 @@
 import os
 import sys
 import base64
+import re
+import struct
+
+# Display names of the poses that have key bindings
+POSE_NAMES = {
+    1: "santai",
+    3: "satu tangan",
+    4: "belakang tangan",
+    6: "wawa",
+}
+
+# (key, pose, expression) - one keyboard column per pose (QWERTY layout)
+KEY_BINDINGS = [
+    ("q", 1, 2), ("a", 1, 3), ("z", 1, 4),
+    ("w", 3, 2), ("s", 3, 3), ("x", 3, 4),
+    ("e", 4, 2), ("d", 4, 3), ("c", 4, 4),
+    ("r", 6, 2), ("f", 6, 3), ("v", 6, 4),
+]
+
+IMAGE_NAME = re.compile(r"^(\d+)-(\d+)\.png$")
+
+
+def png_size(path):
+    with open(path, "rb") as f:
+        header = f.read(24)
+    if len(header) < 24 or header[:8] != b"\x89PNG\r\n\x1a\n":
+        return None
+    return struct.unpack(">II", header[16:24])
+
+
+def write_manifest(model_dir, image_files, output_file):
+    """Write the constexpr manifest header (asset_manifest.h)"""
+    poses = {}
+    for image_file in image_files:
+        match = IMAGE_NAME.match(image_file)
+        if not match:
+            continue
+        pose, expression = int(match.group(1)), int(match.group(2))
+        size = png_size(os.path.join(model_dir, image_file))
+        if expression < 1 or size is None:
+            continue
+        info = poses.setdefault(pose, {"expressions": 0, "width": 0, "height": 0})
+        info["expressions"] = max(info["expressions"], expression)
+        info["width"] = max(info["width"], size[0])
+        info["height"] = max(info["height"], size[1])
+
+    if not poses:
+        print(f"Error: No <pose>-<expression>.png files found in {model_dir}")
+        sys.exit(1)
+
+    for key, pose, expression in KEY_BINDINGS:
+        if pose not in poses or expression > poses[pose]["expressions"]:
+            print(f"Warning: key {key} is bound to missing image {pose}-{expression}.png")
+
+    pose_ids = sorted(poses)
+    max_pose = pose_ids[-1]
+    max_expressions = max(info["expressions"] for info in poses.values())
+    pose_index = [pose_ids.index(p) if p in poses else -1 for p in range(max_pose + 1)]
+
+    with open(output_file, "w") as f:
+        f.write(f"// Generated by generate_embedded_models.py from {os.path.basename(os.path.normpath(model_dir))}/ - do not edit.\n")
+        f.write("// Regenerate with: make manifest\n")
+        f.write("#ifndef ASSET_MANIFEST_H\n#define ASSET_MANIFEST_H\n\n")
+        f.write("#include <SDL2/SDL.h>\n\n")
+        f.write("namespace manifest {\n\n")
+        f.write("struct PoseInfo {\n")
+        f.write("    int id;\n")
+        f.write("    const char* name;    // \"\" if the pose has no display name\n")
+        f.write("    int expressionCount; // expressions 1..expressionCount\n")
+        f.write("    int width;           // largest image of the pose\n")
+        f.write("    int height;\n")
+        f.write("};\n\n")
+        f.write("struct KeyBinding {\n")
+        f.write("    SDL_Keycode key;\n")
+        f.write("    int pose;\n")
+        f.write("    int expression;\n")
+        f.write("};\n\n")
+
+        f.write("inline constexpr PoseInfo POSES[] = {\n")
+        for pose in pose_ids:
+            info = poses[pose]
+            name = POSE_NAMES.get(pose, "")
+            f.write(f"    {{{pose}, \"{name}\", {info['expressions']}, {info['width']}, {info['height']}}},\n")
+        f.write("};\n")
+        f.write(f"inline constexpr int POSE_COUNT = {len(pose_ids)};\n")
+        f.write(f"inline constexpr int MAX_POSE_ID = {max_pose};\n")
+        f.write(f"inline constexpr int MAX_EXPRESSIONS = {max_expressions};\n\n")
+
+        f.write("inline constexpr KeyBinding KEY_BINDINGS[] = {\n")
+        for key, pose, expression in KEY_BINDINGS:
+            f.write(f"    {{SDLK_{key}, {pose}, {expression}}},\n")
+        f.write("};\n")
+        f.write(f"inline constexpr int KEY_BINDING_COUNT = {len(KEY_BINDINGS)};\n\n")
+
+        f.write("// Index into POSES by pose id, -1 for ids without images\n")
+        f.write("inline constexpr int POSE_INDEX[MAX_POSE_ID + 1] = {" + ", ".join(map(str, pose_index)) + "};\n\n")
+
+        f.write(MANIFEST_FUNCTIONS)
+        f.write("\n} // namespace manifest\n\n#endif // ASSET_MANIFEST_H\n")
+
+    print(f"Generated manifest for {len(pose_ids)} poses and {len(KEY_BINDINGS)} key bindings in {output_file}")
+
+
+# Lookups over the tables above, written verbatim into the manifest
+MANIFEST_FUNCTIONS = """\
+// Dense image slots: every (pose, expression) of the manifest has an index in
+// [0, SLOT_COUNT), so per-image state can live in flat arrays
+inline constexpr int SLOT_COUNT = POSE_COUNT * MAX_EXPRESSIONS;
+
+constexpr const PoseInfo* findPose(int pose) {
+    return (pose >= 0 && pose <= MAX_POSE_ID && POSE_INDEX[pose] >= 0) ? &POSES[POSE_INDEX[pose]] : nullptr;
+}
+
+// Slot of an image, -1 if the manifest does not know it
+constexpr int slotOf(int pose, int expression) {
+    const PoseInfo* info = findPose(pose);
+    if (!info || expression < 1 || expression > info->expressionCount) {
+        return -1;
+    }
+    return POSE_INDEX[pose] * MAX_EXPRESSIONS + expression - 1;
+}
+
+// Bindings are ASCII keys: binding index per key code, -1 if unbound
+inline constexpr int KEY_TABLE_SIZE = 128;
+
+struct KeyTable {
+    signed char binding[KEY_TABLE_SIZE];
+};
+
+constexpr KeyTable makeKeyTable() {
+    KeyTable table = {};
+    for (int key = 0; key < KEY_TABLE_SIZE; key++) {
+        table.binding[key] = -1;
+    }
+    for (int i = 0; i < KEY_BINDING_COUNT; i++) {
+        table.binding[KEY_BINDINGS[i].key] = static_cast<signed char>(i);
+    }
+    return table;
+}
+
+inline constexpr KeyTable KEY_TABLE = makeKeyTable();
+
+constexpr const KeyBinding* findBinding(SDL_Keycode key) {
+    return (key >= 0 && key < KEY_TABLE_SIZE && KEY_TABLE.binding[key] >= 0) ? &KEY_BINDINGS[KEY_TABLE.binding[key]]
+                                                                             : nullptr;
+}
+
+static_assert(KEY_BINDING_COUNT < 128, "binding index must fit a signed char");
+"""
+
 
 def main():
-    if len(sys.argv) < 3:
-        print(f"Usage: {sys.argv[0]} <model_dir> <output_cpp_file>")
+    args = sys.argv[1:]
+    manifest_file = None
+    if "--manifest" in args:
+        index = args.index("--manifest")
+        if index + 1 >= len(args):
+            args = []
+        else:
+            manifest_file = args[index + 1]
+            del args[index:index + 2]
+
+    if not args or (len(args) < 2 and not manifest_file):
+        print(f"Usage: {sys.argv[0]} <model_dir> [<output_cpp_file>] [--manifest <asset_manifest.h>]")
         sys.exit(1)
     
-    model_dir = sys.argv[1]
-    output_file = sys.argv[2]
+    model_dir = args[0]
+    output_file = args[1] if len(args) > 1 else None
     
     if not os.path.isdir(model_dir):
         print(f"Error: {model_dir} is not a directory")
@@ -28,15 +188,16 @@ def main():
     # Sort to ensure consistent ordering
     image_files.sort()
     
+    if manifest_file:
+        write_manifest(model_dir, image_files, manifest_file)
+        if not output_file:
+            return
+    
     # Generate the C++ code
     with open(output_file, "w") as f:
         # Write header
         f.write('#include "embedded_models.h"\n\n')
-        f.write('#include <cstddef>\n')
-        f.write('#include <fstream>\n')
-        f.write('#include <iostream>\n')
-        f.write('#include <filesystem>\n')
-        f.write('#include <sys/stat.h>\n\n')
+        f.write('#include <cstddef>\n\n')
         
         # Write each image as a byte array
         for image_file in image_files:
@@ -70,34 +231,15 @@ def main():
         # Write count of embedded images
         f.write(f"const int embedded_images_count = {len(image_files)};\n\n")
         
-        # Add function to extract images to temp directory
-        f.write("// Function to extract embedded images to a temporary directory\n")
-        f.write("std::string extractEmbeddedImagesToTemp() {\n")
-        f.write("    // Create a unique temporary directory\n")
-        f.write("    std::string temp_dir;\n")
-        f.write("    char template_dir[] = \"/tmp/chiemodel-XXXXXX\";\n")
-        f.write("    char* result = mkdtemp(template_dir);\n")
-        f.write("    if (result == nullptr) {\n")
-        f.write("        std::cerr << \"Failed to create temporary directory for embedded models!\" << std::endl;\n")
-        f.write("        return \"\";\n")
-        f.write("    }\n\n")
-        f.write("    temp_dir = result;\n")
-        f.write("    std::cout << \"Extracting embedded models to: \" << temp_dir << std::endl;\n\n")
-        
-        f.write("    // Extract each image\n")
+        # Add lookup function (images are decoded straight from memory)
+        f.write("// Find an embedded image by file name, nullptr if not embedded\n")
+        f.write("const EmbeddedImage* findEmbeddedImage(const std::string& name) {\n")
         f.write("    for (int i = 0; i < embedded_images_count; i++) {\n")
-        f.write("        std::string file_path = temp_dir + \"/\" + embedded_images[i].name;\n")
-        f.write("        std::ofstream outfile(file_path, std::ios::binary);\n")
-        f.write("        if (!outfile) {\n")
-        f.write("            std::cerr << \"Failed to write embedded image: \" << embedded_images[i].name << std::endl;\n")
-        f.write("            continue;\n")
+        f.write("        if (name == embedded_images[i].name) {\n")
+        f.write("            return &embedded_images[i];\n")
         f.write("        }\n")
-        f.write("        outfile.write(reinterpret_cast<const char*>(embedded_images[i].data), embedded_images[i].size);\n")
-        f.write("        outfile.close();\n")
-        f.write("        std::cout << \"Extracted: \" << embedded_images[i].name << std::endl;\n")
-        f.write("    }\n\n")
-        
-        f.write("    return temp_dir;\n")
+        f.write("    }\n")
+        f.write("    return nullptr;\n")
         f.write("}\n")
     
     print(f"Generated C++ code for {len(image_files)} embedded images in {output_file}")
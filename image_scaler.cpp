@@ -0,0 +1,197 @@
+#include "image_scaler.h"
+#include "texture_atlas.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+static_assert(TextureAtlas::PIXEL_FORMAT == SDL_PIXELFORMAT_ARGB8888, "scaler packs ARGB8888 pixels");
+
+namespace {
+
+// Premultiplied RGBA, 0-255 per channel
+struct FloatImage {
+    int width;
+    int height;
+    std::vector<float> pixels;
+
+    FloatImage(int w, int h) : width(w), height(h), pixels(static_cast<size_t>(w) * h * 4) {}
+    float* at(int x, int y) { return &pixels[(static_cast<size_t>(y) * width + x) * 4]; }
+    const float* at(int x, int y) const { return &pixels[(static_cast<size_t>(y) * width + x) * 4]; }
+};
+
+// Source pixels contributing to one destination pixel along an axis
+struct Taps {
+    int first;
+    std::vector<float> weights;
+};
+
+FloatImage premultiply(SDL_Surface* surface) {
+    FloatImage image(surface->w, surface->h);
+    for (int y = 0; y < surface->h; y++) {
+        const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(surface->pixels) + y * surface->pitch);
+        for (int x = 0; x < surface->w; x++) {
+            Uint32 argb = row[x];
+            float alpha = static_cast<float>(argb >> 24);
+            float* p = image.at(x, y);
+            p[0] = static_cast<float>((argb >> 16) & 0xFF) * alpha / 255.0f;
+            p[1] = static_cast<float>((argb >> 8) & 0xFF) * alpha / 255.0f;
+            p[2] = static_cast<float>(argb & 0xFF) * alpha / 255.0f;
+            p[3] = alpha;
+        }
+    }
+    return image;
+}
+
+// One mip level down: 2x2 box filter (an odd last row/column is dropped)
+FloatImage halve(const FloatImage& source) {
+    FloatImage result(std::max(1, source.width / 2), std::max(1, source.height / 2));
+    for (int y = 0; y < result.height; y++) {
+        int y0 = std::min(2 * y, source.height - 1);
+        int y1 = std::min(2 * y + 1, source.height - 1);
+        for (int x = 0; x < result.width; x++) {
+            int x0 = std::min(2 * x, source.width - 1);
+            int x1 = std::min(2 * x + 1, source.width - 1);
+            const float* a = source.at(x0, y0);
+            const float* b = source.at(x1, y0);
+            const float* c = source.at(x0, y1);
+            const float* d = source.at(x1, y1);
+            float* p = result.at(x, y);
+            for (int i = 0; i < 4; i++) {
+                p[i] = (a[i] + b[i] + c[i] + d[i]) * 0.25f;
+            }
+        }
+    }
+    return result;
+}
+
+// Area filter when shrinking (each destination pixel averages the source span
+// it covers), bilinear when enlarging
+std::vector<Taps> axisTaps(int sourceSize, int targetSize) {
+    std::vector<Taps> taps(targetSize);
+    double ratio = static_cast<double>(sourceSize) / targetSize;
+
+    for (int i = 0; i < targetSize; i++) {
+        Taps& tap = taps[i];
+        if (ratio > 1.0) {
+            double start = i * ratio;
+            double end = start + ratio;
+            tap.first = static_cast<int>(start);
+            int last = std::min(sourceSize - 1, static_cast<int>(std::ceil(end)) - 1);
+            for (int s = tap.first; s <= last; s++) {
+                double overlap = std::min(end, s + 1.0) - std::max(start, static_cast<double>(s));
+                tap.weights.push_back(static_cast<float>(overlap / ratio));
+            }
+        } else {
+            double center = (i + 0.5) * ratio - 0.5;
+            int s0 = static_cast<int>(std::floor(center));
+            float fraction = static_cast<float>(center - s0);
+            if (s0 < 0) {
+                s0 = 0;
+                fraction = 0.0f;
+            }
+            if (s0 >= sourceSize - 1) {
+                tap.first = sourceSize - 1;
+                tap.weights = {1.0f};
+            } else {
+                tap.first = s0;
+                tap.weights = {1.0f - fraction, fraction};
+            }
+        }
+    }
+    return taps;
+}
+
+// Separable resample to exactly width x height
+FloatImage resample(const FloatImage& source, int width, int height) {
+    std::vector<Taps> columns = axisTaps(source.width, width);
+    FloatImage horizontal(width, source.height);
+    for (int y = 0; y < source.height; y++) {
+        for (int x = 0; x < width; x++) {
+            const Taps& tap = columns[x];
+            float* p = horizontal.at(x, y);
+            for (size_t k = 0; k < tap.weights.size(); k++) {
+                const float* s = source.at(tap.first + static_cast<int>(k), y);
+                for (int i = 0; i < 4; i++) {
+                    p[i] += s[i] * tap.weights[k];
+                }
+            }
+        }
+    }
+
+    std::vector<Taps> rows = axisTaps(source.height, height);
+    FloatImage result(width, height);
+    for (int y = 0; y < height; y++) {
+        const Taps& tap = rows[y];
+        for (size_t k = 0; k < tap.weights.size(); k++) {
+            for (int x = 0; x < width; x++) {
+                const float* s = horizontal.at(x, tap.first + static_cast<int>(k));
+                float* p = result.at(x, y);
+                for (int i = 0; i < 4; i++) {
+                    p[i] += s[i] * tap.weights[k];
+                }
+            }
+        }
+    }
+    return result;
+}
+
+Uint8 toByte(float value) {
+    return static_cast<Uint8>(std::lround(std::min(255.0f, std::max(0.0f, value))));
+}
+
+} // namespace
+
+SDL_Surface* scaleSurface(SDL_Surface* source, int width, int height) {
+    if (!source || width <= 0 || height <= 0) {
+        return nullptr;
+    }
+
+    SDL_Surface* converted = nullptr;
+    if (source->format->format != TextureAtlas::PIXEL_FORMAT) {
+        converted = SDL_ConvertSurfaceFormat(source, TextureAtlas::PIXEL_FORMAT, 0);
+        if (!converted) {
+            std::cerr << "Failed to convert image for scaling: " << SDL_GetError() << std::endl;
+            return nullptr;
+        }
+        source = converted;
+    }
+
+    SDL_LockSurface(source);
+    FloatImage image = premultiply(source);
+    SDL_UnlockSurface(source);
+    if (converted) {
+        SDL_FreeSurface(converted);
+    }
+
+    while (image.width >= 2 * width && image.height >= 2 * height) {
+        image = halve(image);
+    }
+    if (image.width != width || image.height != height) {
+        image = resample(image, width, height);
+    }
+
+    SDL_Surface* result = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, TextureAtlas::PIXEL_FORMAT);
+    if (!result) {
+        std::cerr << "Failed to create scaled image: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+
+    for (int y = 0; y < height; y++) {
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(result->pixels) + y * result->pitch);
+        for (int x = 0; x < width; x++) {
+            const float* p = image.at(x, y);
+            Uint8 alpha = toByte(p[3]);
+            if (alpha == 0) {
+                row[x] = 0;
+                continue;
+            }
+            float unpremultiply = 255.0f / p[3];
+            row[x] = (static_cast<Uint32>(alpha) << 24) |
+                     (static_cast<Uint32>(toByte(p[0] * unpremultiply)) << 16) |
+                     (static_cast<Uint32>(toByte(p[1] * unpremultiply)) << 8) |
+                     static_cast<Uint32>(toByte(p[2] * unpremultiply));
+        }
+    }
+    return result;
+}
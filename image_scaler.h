@@ -0,0 +1,16 @@
+#ifndef IMAGE_SCALER_H
+#define IMAGE_SCALER_H
+
+#include <SDL2/SDL.h>
+
+// High-quality resampling for images that are scaled once and cached (atlas
+// uploads at an output's scale), not per frame. Works on premultiplied alpha
+// so transparent edges do not bleed dark fringes. Downscaling halves with a
+// 2x2 box filter while the image is at least twice the target (mip levels),
+// then finishes with an exact area filter; upscaling is bilinear.
+//
+// Returns a new surface in TextureAtlas::PIXEL_FORMAT owned by the caller,
+// nullptr on failure or for an empty size.
+SDL_Surface* scaleSurface(SDL_Surface* source, int width, int height);
+
+#endif // IMAGE_SCALER_H
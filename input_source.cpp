@@ -0,0 +1,99 @@
+#include "input_source.h"
+#include <iostream>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <poll.h>
+#include <unistd.h>
+
+StdinInputSource::StdinInputSource(Uint32 keyEventType) : keyEvent(keyEventType), running(false) {
+}
+
+StdinInputSource::~StdinInputSource() {
+    stop();
+}
+
+bool StdinInputSource::start() {
+    if (running) return true;
+
+    running = true;
+    readerThread = std::thread(&StdinInputSource::readLoop, this);
+    std::cout << "Reading commands from stdin (keys per line, 'quit' to exit)" << std::endl;
+    return true;
+}
+
+void StdinInputSource::stop() {
+    running = false;
+    if (readerThread.joinable()) {
+        readerThread.join();
+    }
+}
+
+void StdinInputSource::readLoop() {
+    std::string pending;
+    char buffer[256];
+
+    while (running) {
+        // Poll with a timeout so stop() never waits on a blocking read
+        pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+        int ready = poll(&pfd, 1, 100);
+        if (ready <= 0) {
+            continue;
+        }
+
+        ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (count < 0 && (errno == EINTR || errno == EAGAIN)) {
+            continue;
+        }
+        if (count <= 0) {
+            // End of input (or no usable stdin): stop reading, keep running
+            if (!pending.empty()) {
+                handleLine(pending.c_str());
+            }
+            break;
+        }
+
+        pending.append(buffer, static_cast<size_t>(count));
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            handleLine(pending.substr(0, newline).c_str());
+            pending.erase(0, newline + 1);
+        }
+    }
+
+    running = false;
+}
+
+void StdinInputSource::handleLine(const char* line) {
+    if (strcmp(line, "esc") == 0 || strcmp(line, "quit") == 0 || strcmp(line, "exit") == 0) {
+        pushQuit();
+        return;
+    }
+    if (strcmp(line, "tab") == 0) {
+        pushKey(SDLK_TAB); // next avatar
+        return;
+    }
+
+    for (const char* c = line; *c; c++) {
+        if (isalnum(static_cast<unsigned char>(*c))) {
+            // SDL keycodes for letters and digits are their lowercase ASCII values
+            pushKey(static_cast<SDL_Keycode>(tolower(static_cast<unsigned char>(*c))));
+        }
+    }
+}
+
+void StdinInputSource::pushKey(SDL_Keycode key) const {
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = keyEvent;
+    event.user.code = static_cast<Sint32>(key);
+    SDL_PushEvent(&event);
+}
+
+void StdinInputSource::pushQuit() {
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = SDL_QUIT;
+    SDL_PushEvent(&event);
+}
@@ -0,0 +1,37 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <thread>
+
+// Reads key commands from stdin on a background thread and pushes them
+// into the SDL event queue (headless mode input).
+//
+// Each line is a command: every character is one key press ("q", "w", "g"),
+// applied in order without the interactive key cooldown (they arrive as
+// keyEventType events, the key in user.code); "tab" selects the next avatar;
+// "esc", "quit" or "exit" quits. End of input only stops the reader, so a
+// headless instance started with stdin closed or at /dev/null keeps running
+// for its other inputs.
+class StdinInputSource {
+private:
+    Uint32 keyEvent;
+    std::thread readerThread;
+    std::atomic<bool> running;
+
+public:
+    explicit StdinInputSource(Uint32 keyEventType);
+    ~StdinInputSource();
+
+    bool start();
+    void stop();
+
+private:
+    void readLoop();
+    void handleLine(const char* line);
+    void pushKey(SDL_Keycode key) const;
+    static void pushQuit();
+};
+
+#endif // INPUT_SOURCE_H
@@ -1,11 +1,41 @@
 #include "optimized_avatar_system.h"
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
+#ifdef CHIEMODEL_EMBEDDED_MODELS
+#include "embedded_models.h"
+#endif
+
 // Command line options
 struct Options {
     bool help = false;
     std::string modelDir = "model";
+    bool modelDirGiven = false;
+    bool watch = false;
+    std::string assetPack;
+    std::string cameraDevice;
+    std::string sharedMemoryName;
+    bool transparent = false;
+    std::string recordPath;
+    double recordFrameRate = 30.0;
+    bool headless = false;
+    bool noStdin = false;
+    bool singleThread = false;
+    bool warmStart = false;
+    bool stats = false;
+    std::string statsPath;
+    size_t memoryBudgetMB = 0;
+    std::string controlSocket;
+    int oscPort = 0;
+    bool microphone = false;
+    std::string microphoneDevice;
+    float microphoneThresholdDb = -35.0f;
+    int mouthExpression = 4;
+    int avatarCount = 1;
+    int outputWidth = 800;
+    int outputHeight = 600;
 };
 
 // Parse command line arguments
@@ -20,16 +50,93 @@ Options parseArguments(int argc, char* argv[]) {
                       << "Usage: " << argv[0] << " [options]\n\n"
                       << "Options:\n"
                       << "  --help, -h        Show this help message\n"
-                      << "  --model-dir <dir>  Specify model directory (default: model)\n\n"
+                      << "  --model-dir <dir>  Specify model directory (default: model)\n"
+                      << "  --watch            Reload model images when their files change\n"
+                      << "  --asset-pack <file> Load a pre-decoded pack (make pack) instead of PNGs\n"
+                      << "  --camera <device>  Write output to a v4l2loopback device (e.g. /dev/video20)\n"
+                      << "  --shm[=<name>]     Publish RGBA frames in POSIX shared memory (default /chiemodel)\n"
+                      << "  --transparent      Transparent output background instead of chroma-key green\n"
+                      << "  --record <target>  Record the output: clip.mp4/.mkv (via ffmpeg), a raw NV12\n"
+                      << "                     file, or \"|command\" to pipe raw NV12 frames into\n"
+                      << "  --record-fps <n>   Recording frame rate (default 30)\n"
+                      << "  --output-size <WxH> Output and camera frame size (default 800x600, e.g. 1920x1080)\n"
+                      << "  --headless         No windows; render offscreen, read keys from stdin\n"
+                      << "  --no-stdin         Headless: do not read stdin (e.g. when driven by --control)\n"
+                      << "  --single-thread    Draw the output window on the main thread\n"
+                      << "  --warm-start       Decode the whole model on all cores at startup\n"
+                      << "  --stats[=<file>]   Report frame timings and cache use every 5 s to stderr,\n"
+                      << "                     or as JSON lines to <file>\n"
+                      << "  --memory-budget <MB> Cap decoded images plus textures; least recently\n"
+                      << "                     used images are dropped and reloaded on demand\n"
+                      << "  --control <path>   Accept commands on a Unix socket (e.g. \"pose 3 2; blink\")\n"
+                      << "  --osc-port <port>  Accept OSC commands (/avatar/pose ...) on localhost UDP\n"
+                      << "  --mic[=<device>]   Open the mouth while the microphone hears speech\n"
+                      << "  --mic-threshold <dB> RMS level that opens the mouth (default -35 dBFS)\n"
+                      << "  --mouth-expression <n> Expression shown while the mouth is open (default 4)\n"
+                      << "  --avatars <n>      Show n avatars side by side, each with its own pose and\n"
+                      << "                     expression (Tab or \"avatar <n>\" selects one; max 32)\n\n"
                       << "Keyboard Controls:\n"
                       << "  1-9, 0           Change avatar pose (body position)\n"
                       << "  Q, W, E, R...      Change facial expression\n"
                       << "  G                  Toggle horizontal flip\n"
+                      << "  Tab                Select the next avatar (--avatars)\n"
                       << "  ESC                Exit application\n\n"
                       << std::endl;
             options.help = true;
         } else if (arg == "--model-dir" && i + 1 < argc) {
             options.modelDir = argv[++i];
+            options.modelDirGiven = true;
+        } else if (arg == "--watch") {
+            options.watch = true;
+        } else if (arg == "--asset-pack" && i + 1 < argc) {
+            options.assetPack = argv[++i];
+        } else if (arg == "--camera" && i + 1 < argc) {
+            options.cameraDevice = argv[++i];
+        } else if (arg == "--shm") {
+            options.sharedMemoryName = "/chiemodel";
+        } else if (arg.rfind("--shm=", 0) == 0) {
+            options.sharedMemoryName = arg.substr(6);
+        } else if (arg == "--transparent") {
+            options.transparent = true;
+        } else if (arg == "--record" && i + 1 < argc) {
+            options.recordPath = argv[++i];
+        } else if (arg == "--record-fps" && i + 1 < argc) {
+            options.recordFrameRate = std::atof(argv[++i]);
+        } else if (arg == "--output-size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.outputWidth, &options.outputHeight) != 2) {
+                std::cerr << "Invalid --output-size, expected <width>x<height>" << std::endl;
+                options.outputWidth = options.outputHeight = 0;
+            }
+        } else if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--no-stdin") {
+            options.noStdin = true;
+        } else if (arg == "--single-thread") {
+            options.singleThread = true;
+        } else if (arg == "--warm-start") {
+            options.warmStart = true;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg.rfind("--stats=", 0) == 0) {
+            options.stats = true;
+            options.statsPath = arg.substr(8);
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            options.memoryBudgetMB = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--control" && i + 1 < argc) {
+            options.controlSocket = argv[++i];
+        } else if (arg == "--osc-port" && i + 1 < argc) {
+            options.oscPort = std::atoi(argv[++i]);
+        } else if (arg == "--mic") {
+            options.microphone = true;
+        } else if (arg.rfind("--mic=", 0) == 0) {
+            options.microphone = true;
+            options.microphoneDevice = arg.substr(6);
+        } else if (arg == "--mic-threshold" && i + 1 < argc) {
+            options.microphoneThresholdDb = static_cast<float>(std::atof(argv[++i]));
+        } else if (arg == "--mouth-expression" && i + 1 < argc) {
+            options.mouthExpression = std::atoi(argv[++i]);
+        } else if (arg == "--avatars" && i + 1 < argc) {
+            options.avatarCount = std::atoi(argv[++i]);
         }
     }
 
@@ -47,7 +154,40 @@ int main(int argc, char* argv[]) {
     // Create and initialize the optimized avatar system
     OptimizedAvatarSystem avatarSystem;
     
-    if (!avatarSystem.initialize(options.modelDir)) {
+    OptimizedAvatarSystem::Config config;
+    config.modelDirectory = options.modelDir;
+    config.watchModel = options.watch;
+#ifdef CHIEMODEL_EMBEDDED_MODELS
+    // Single-binary build: use the compiled-in images unless a directory is given
+    if (!options.modelDirGiven) {
+        config.embeddedImages = embedded_images;
+        config.embeddedImageCount = embedded_images_count;
+    }
+#endif
+    config.assetPack = options.assetPack;
+    config.videoDevice = options.cameraDevice;
+    config.sharedMemoryName = options.sharedMemoryName;
+    config.transparentBackground = options.transparent;
+    config.recordPath = options.recordPath;
+    config.recordFrameRate = options.recordFrameRate;
+    config.outputWidth = options.outputWidth;
+    config.outputHeight = options.outputHeight;
+    config.headless = options.headless;
+    config.stdinCommands = !options.noStdin;
+    config.threadedOutput = !options.singleThread;
+    config.warmStart = options.warmStart;
+    config.stats = options.stats;
+    config.statsPath = options.statsPath;
+    config.memoryBudget = options.memoryBudgetMB * 1024 * 1024;
+    config.controlSocket = options.controlSocket;
+    config.oscPort = options.oscPort;
+    config.microphone = options.microphone;
+    config.microphoneDevice = options.microphoneDevice;
+    config.microphoneThresholdDb = options.microphoneThresholdDb;
+    config.mouthExpression = options.mouthExpression;
+    config.avatarCount = options.avatarCount;
+    
+    if (!avatarSystem.initialize(config)) {
         std::cerr << "Failed to initialize avatar system" << std::endl;
         return 1;
     }
@@ -1,63 +1,281 @@
 #include "optimized_avatar_system.h"
+#include "asset_manifest.h"
+#include "avatar_clock.h"
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
 #include <cstdlib>
 #include <ctime>
 
 OptimizedAvatarSystem::OptimizedAvatarSystem()
     : font(nullptr)
-    , currentPose(1), currentExpression(1), isFlipped(false)
-    , lastKey(0), lastKeyTime(std::chrono::steady_clock::now()) {
+    , sdlInitialized(false)
+    , headless(false)
+    , selectedAvatar(0)
+    , lastKey(0), lastKeyTime(AvatarClock::now())
+    , controlView{}
+    , controlViewValid(false)
+    , previewSink(nullptr), previewTexture(nullptr), previewReady(false)
+    , previewEvent(static_cast<Uint32>(-1))
+    , assetLoadedEvent(static_cast<Uint32>(-1))
+    , controlEvent(static_cast<Uint32>(-1))
+    , audioEvent(static_cast<Uint32>(-1))
+    , stdinKeyEvent(static_cast<Uint32>(-1))
+    , voiceExpression(0)
+    , pendingCommandTime{} {
 }
 
 OptimizedAvatarSystem::~OptimizedAvatarSystem() {
     shutdown();
 }
 
-bool OptimizedAvatarSystem::initialize(const std::string& modelDirectory) {
-    // Initialize random seed
-    srand(static_cast<unsigned int>(time(nullptr)));
-    
-    // Setup mappings
-    setupMappings();
+bool OptimizedAvatarSystem::initialize(const Config& config) {
+    // Initialize random seed (fixed for reproducible runs)
+    srand(config.randomSeed ? config.randomSeed : static_cast<unsigned int>(time(nullptr)));
+    
+    headless = config.headless;
+    voiceExpression = config.microphone ? config.mouthExpression : 0;
+    
+    // Every avatar starts in the default pose with its own animation state, so
+    // transitions and blink schedules are independent; keys drive the first
+    if (config.avatarCount < 1 || config.avatarCount > SceneSnapshot::MAX_AVATARS) {
+        std::cerr << "Invalid avatar count " << config.avatarCount
+                  << " (1 to " << SceneSnapshot::MAX_AVATARS << ")" << std::endl;
+        return false;
+    }
+    avatars.clear();
+    for (int i = 0; i < config.avatarCount; i++) {
+        Avatar avatar = {1, 1, false, std::make_unique<AnimationSystem>()};
+        avatar.animation->setMouthExpression(config.mouthExpression);
+        avatars.push_back(std::move(avatar));
+    }
+    selectedAvatar = 0;
     
     // Initialize SDL
-    if (!initializeSDL()) {
+    if (!initializeSDL(headless)) {
         return false;
     }
     
-    // Initialize fonts
-    if (!initializeFonts()) {
+    // Initialize fonts (only the control panel draws text)
+    if (!headless && !initializeFonts()) {
         std::cerr << "Warning: Failed to initialize fonts, continuing without text rendering" << std::endl;
     }
     
+    if (config.stats) {
+        stats = std::make_unique<Stats>(config.statsPath);
+        if (!stats->open()) {
+            stats.reset();
+        }
+    }
+    
     // Initialize resource manager
     resourceManager = std::make_unique<ResourceManager>();
-    if (!resourceManager->initialize(modelDirectory)) {
+    resourceManager->setStats(stats.get());
+    resourceManager->setMemoryBudget(config.memoryBudget);
+    bool resourcesReady = false;
+    if (!config.assetPack.empty()) {
+        auto pack = std::make_unique<PackAssetSource>();
+        resourcesReady = pack->open(config.assetPack) && resourceManager->initialize(std::move(pack));
+    } else if (config.embeddedImages) {
+        resourcesReady = resourceManager->initialize(
+            std::make_unique<EmbeddedAssetSource>(config.embeddedImages, config.embeddedImageCount));
+    } else {
+        resourcesReady = resourceManager->initialize(config.modelDirectory);
+    }
+    if (!resourcesReady) {
         std::cerr << "Failed to initialize resource manager" << std::endl;
         return false;
     }
     
+    // Decode everything a key press can show in the background while the
+    // windows come up; finished decodes wake the main loop for upload
+    assetLoadedEvent = SDL_RegisterEvents(1);
+    if (assetLoadedEvent != static_cast<Uint32>(-1)) {
+        Uint32 eventType = assetLoadedEvent;
+        resourceManager->setLoadedCallback([eventType]() {
+            SDL_Event event = {};
+            event.type = eventType;
+            SDL_PushEvent(&event);
+        });
+    }
+    std::vector<std::pair<int, int>> reachable = getReachableImages();
+    if (config.warmStart) {
+        resourceManager->warmStart(reachable);
+    }
+    resourceManager->prefetch(reachable);
+    
+    // Edited images are re-decoded on the watcher thread and swapped in between frames
+    if (config.watchModel && !resourceManager->watchForChanges()) {
+        std::cerr << "Warning: Cannot watch the model for changes (only a model directory can be watched)" << std::endl;
+    }
+    
     // Initialize renderer manager
     rendererManager = std::make_unique<RendererManager>();
-    if (!rendererManager->initialize(WINDOW_WIDTH, WINDOW_HEIGHT)) {
+    if (config.outputWidth <= 0 || config.outputHeight <= 0) {
+        std::cerr << "Invalid output size " << config.outputWidth << "x" << config.outputHeight << std::endl;
+        return false;
+    }
+    if (!rendererManager->initialize(WINDOW_WIDTH, WINDOW_HEIGHT, config.outputWidth, config.outputHeight, headless)) {
         std::cerr << "Failed to initialize renderer manager" << std::endl;
         return false;
     }
     
-    // Initialize animation system
-    animationSystem = std::make_unique<AnimationSystem>(resourceManager.get());
+    // Chroma-key green, or alpha for consumers that composite (shared memory)
+    rendererManager->setBackgroundColor(rendererManager->getControlTarget(), BACKGROUND_COLOR);
+    rendererManager->setBackgroundColor(rendererManager->getOutputTarget(),
+                                        config.transparentBackground ? TRANSPARENT_COLOR : BACKGROUND_COLOR);
+    
+    // Atlas textures belong to the renderers; release them whenever a renderer goes away
+    rendererManager->setRendererDestroyedCallback([this](SDL_Renderer* renderer) {
+        if (resourceManager) {
+            resourceManager->clearRendererCache(renderer);
+        }
+        if (textRenderer && textRenderer->getRenderer() == renderer) {
+            textRenderer->clear();
+        }
+        if (previewTexture && rendererManager->getControlTarget()->renderer == renderer) {
+            SDL_DestroyTexture(previewTexture);
+            previewTexture = nullptr;
+        }
+    });
+    
+    if (font && rendererManager->hasControlTarget()) {
+        textRenderer = std::make_unique<TextRenderer>(rendererManager->getControlTarget()->renderer, font);
+    }
+    
+    // Open virtual camera, shared memory output and recording if requested
+    std::vector<std::unique_ptr<FrameSink>> sinks;
+    if (!config.videoDevice.empty()) {
+        auto videoSink = std::make_unique<VideoSink>();
+        if (videoSink->open(config.videoDevice, config.outputWidth, config.outputHeight)) {
+            sinks.push_back(std::move(videoSink));
+        } else {
+            std::cerr << "Warning: Failed to open virtual camera, continuing without it" << std::endl;
+        }
+    }
+    if (!config.sharedMemoryName.empty()) {
+        auto sharedMemorySink = std::make_unique<SharedMemorySink>();
+        if (sharedMemorySink->open(config.sharedMemoryName, config.outputWidth, config.outputHeight)) {
+            sinks.push_back(std::move(sharedMemorySink));
+        } else {
+            std::cerr << "Warning: Failed to open shared memory output, continuing without it" << std::endl;
+        }
+    }
+    if (!config.recordPath.empty()) {
+        auto recordSink = std::make_unique<RecordSink>();
+        if (recordSink->open(config.recordPath, config.outputWidth, config.outputHeight, config.recordFrameRate)) {
+            sinks.push_back(std::move(recordSink));
+        } else {
+            std::cerr << "Warning: Failed to start recording, continuing without it" << std::endl;
+        }
+    }
+    bool hasSinks = !sinks.empty();
+    
+    // The control panel shows the output through one more sink rather than
+    // drawing the model itself: the only atlas is the one the output pipeline
+    // builds on its renderer, so the images are uploaded (and resident) once
+    if (rendererManager->hasControlTarget()) {
+        // Output scaled to fit the left half of the panel
+        float fit = std::min(static_cast<float>(WINDOW_WIDTH / 2) / config.outputWidth,
+                             static_cast<float>(WINDOW_HEIGHT) / config.outputHeight);
+        int previewWidth = std::max(1, static_cast<int>(config.outputWidth * fit));
+        int previewHeight = std::max(1, static_cast<int>(config.outputHeight * fit));
+        previewTexture = SDL_CreateTexture(rendererManager->getControlTarget()->renderer, SDL_PIXELFORMAT_RGBA32,
+                                           SDL_TEXTUREACCESS_STREAMING, previewWidth, previewHeight);
+        previewEvent = SDL_RegisterEvents(1);
+        if (previewTexture && previewEvent != static_cast<Uint32>(-1)) {
+            SDL_SetTextureBlendMode(previewTexture, SDL_BLENDMODE_NONE);
+            auto preview = std::make_unique<PreviewSink>(config.outputWidth, config.outputHeight,
+                                                         previewWidth, previewHeight);
+            Uint32 eventType = previewEvent;
+            preview->setWakeCallback([eventType]() {
+                SDL_Event event = {};
+                event.type = eventType;
+                SDL_PushEvent(&event);
+            });
+            previewSink = preview.get();
+            sinks.push_back(std::move(preview));
+        } else {
+            std::cerr << "Warning: Failed to create the output preview, continuing without it" << std::endl;
+        }
+    }
+    
+    outputPipeline = std::make_unique<OutputPipeline>(rendererManager.get(), resourceManager.get(), std::move(sinks));
+    outputPipeline->setStats(stats.get());
+    outputPipeline->setImageScale(static_cast<float>(config.outputHeight) / WINDOW_HEIGHT);
+    if (!outputPipeline->start(config.threadedOutput)) {
+        std::cerr << "Failed to initialize output" << std::endl;
+        return false;
+    }
+    
+    // Remote control: commands are queued by the server's I/O thread and
+    // applied here, woken through an SDL event like finished decodes
+    if (!config.controlSocket.empty() || config.oscPort > 0) {
+        controlServer = std::make_unique<ControlServer>(config.controlSocket, config.oscPort);
+        controlEvent = SDL_RegisterEvents(1);
+        if (controlEvent != static_cast<Uint32>(-1)) {
+            Uint32 eventType = controlEvent;
+            controlServer->setWakeCallback([eventType]() {
+                SDL_Event event = {};
+                event.type = eventType;
+                SDL_PushEvent(&event);
+            });
+        }
+        if (controlEvent == static_cast<Uint32>(-1) || !controlServer->start()) {
+            std::cerr << "Warning: Failed to start the control server, continuing without it" << std::endl;
+            controlServer.reset();
+        }
+    }
+    
+    // Voice: the audio thread only flips atomics; the change reaches the main
+    // loop as an event and the output with the next render
+    if (config.microphone) {
+        VoiceActivityDetector::Settings voice;
+        voice.openDb = config.microphoneThresholdDb;
+        voice.closeDb = config.microphoneThresholdDb - 8.0f;
+        audioInput = std::make_unique<AudioInput>(config.microphoneDevice, voice);
+        audioEvent = SDL_RegisterEvents(1);
+        if (audioEvent != static_cast<Uint32>(-1)) {
+            Uint32 eventType = audioEvent;
+            audioInput->setWakeCallback([eventType]() {
+                SDL_Event event = {};
+                event.type = eventType;
+                SDL_PushEvent(&event);
+            });
+        }
+        if (config.mouthExpression < 1 || config.mouthExpression > manifest::MAX_EXPRESSIONS ||
+            audioEvent == static_cast<Uint32>(-1) || !audioInput->start()) {
+            std::cerr << "Warning: Failed to start voice input, continuing without it" << std::endl;
+            audioInput.reset();
+        }
+    }
+    
+    // Without windows there is no keyboard focus; take commands from stdin
+    if (headless && config.stdinCommands) {
+        stdinKeyEvent = SDL_RegisterEvents(1);
+        if (stdinKeyEvent != static_cast<Uint32>(-1)) {
+            stdinInput = std::make_unique<StdinInputSource>(stdinKeyEvent);
+            stdinInput->start();
+        } else {
+            std::cerr << "Warning: Failed to register the stdin key event, continuing without stdin" << std::endl;
+        }
+        if (!hasSinks) {
+            std::cerr << "Warning: Headless mode without --camera, --shm or --record, output is not sent anywhere" << std::endl;
+        }
+    }
     
     std::cout << "Optimized Avatar System initialized successfully" << std::endl;
     return true;
 }
 
-bool OptimizedAvatarSystem::initializeSDL() {
-    // Initialize SDL
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+bool OptimizedAvatarSystem::initializeSDL(bool headlessMode) {
+    // Initialize SDL (headless needs no video subsystem: software renderer + event queue)
+    Uint32 subsystems = headlessMode ? (SDL_INIT_EVENTS | SDL_INIT_TIMER) : SDL_INIT_VIDEO;
+    if (SDL_Init(subsystems) < 0) {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
         return false;
     }
+    sdlInitialized = true;
     
     // Initialize SDL_image
     if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
@@ -83,124 +301,342 @@ bool OptimizedAvatarSystem::initializeFonts() {
     return true;
 }
 
-void OptimizedAvatarSystem::setupMappings() {
-    // Pose definitions
-    poses = {
-        {1, "santai"},
-        {3, "satu tangan"},
-        {4, "belakang tangan"},
-        {6, "wawa"}
+std::vector<std::pair<int, int>> OptimizedAvatarSystem::getReachableImages() const {
+    // Current image first, then every key target, the expression 1 a toggle
+    // returns to and the blink expression of each pose (the same for every avatar)
+    const Avatar& avatar = avatars[selectedAvatar];
+    std::vector<std::pair<int, int>> reachable = {{avatar.pose, avatar.expression}, {avatar.pose, 3}};
+    auto add = [&reachable](int pose, int expression) {
+        if (std::find(reachable.begin(), reachable.end(), std::make_pair(pose, expression)) == reachable.end()) {
+            reachable.emplace_back(pose, expression);
+        }
     };
     
-    // Key mappings
-    keyMappings = {
-        {SDLK_q, PoseExpression(1, 2)},
-        {SDLK_a, PoseExpression(1, 3)},
-        {SDLK_z, PoseExpression(1, 4)},
-        {SDLK_w, PoseExpression(3, 2)},
-        {SDLK_s, PoseExpression(3, 3)},
-        {SDLK_x, PoseExpression(3, 4)},
-        {SDLK_e, PoseExpression(4, 2)},
-        {SDLK_d, PoseExpression(4, 3)},
-        {SDLK_c, PoseExpression(4, 4)},
-        {SDLK_r, PoseExpression(6, 2)},
-        {SDLK_f, PoseExpression(6, 3)},
-        {SDLK_v, PoseExpression(6, 4)},
-    };
+    for (const auto& binding : manifest::KEY_BINDINGS) {
+        add(binding.pose, binding.expression);
+    }
+    for (const auto& binding : manifest::KEY_BINDINGS) {
+        add(binding.pose, 1);
+        add(binding.pose, 3);
+        if (voiceExpression > 0) {
+            add(binding.pose, voiceExpression);
+        }
+    }
+    return reachable;
 }
 
 void OptimizedAvatarSystem::run() {
     std::cout << "Optimized Avatar System running. Press keys to change expressions, ESC to exit." << std::endl;
     
+    // Initial render
+    render();
+    
+    // Sleep until input arrives or the next deadline (animation frame, blink,
+    // camera repeat when single-threaded); idle this wakes rarely
+    while (step(getWaitTimeout())) {
+    }
+}
+
+bool OptimizedAvatarSystem::step(int timeoutMs) {
     bool running = true;
     SDL_Event event;
     
-    // Initial render
+    if (SDL_WaitEventTimeout(&event, timeoutMs)) {
+        StageTimer timer(stats.get(), Stats::Stage::EVENTS);
+        running = handleEvent(event);
+        while (running && SDL_PollEvent(&event)) {
+            running = handleEvent(event);
+        }
+    }
+    if (!running) {
+        return false;
+    }
+    
+    // Update animations
+    updateAnimations();
+    
+    // Cheap when nothing changed: damage tracking skips drawing and presents
     render();
     
-    while (running) {
-        // Process events
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
-                running = false;
-            } else if (event.type == SDL_KEYDOWN) {
-                if (event.key.keysym.sym == SDLK_ESCAPE) {
-                    running = false;
-                } else if (shouldProcessKey(event.key.keysym.sym)) {
-                    handleKeyPress(event.key.keysym.sym);
-                    lastKey = event.key.keysym.sym;
-                    lastKeyTime = std::chrono::steady_clock::now();
-                }
-            }
+    if (stats && std::chrono::steady_clock::now() >= stats->getNextReportTime()) {
+        reportStats();
+    }
+    return true;
+}
+
+void OptimizedAvatarSystem::triggerBlink() {
+    selected().animation->startBlink();
+}
+
+bool OptimizedAvatarSystem::handleEvent(const SDL_Event& event) {
+    if (event.type == SDL_QUIT) {
+        return false;
+    } else if (event.type == SDL_WINDOWEVENT) {
+        // The output target belongs to the output thread; ask it to repaint
+        auto* target = rendererManager->getTargetForWindowEvent(event.window);
+        if (target == rendererManager->getOutputTarget()) {
+            outputPipeline->invalidate();
+        } else if (target) {
+            rendererManager->invalidate(target);
         }
-        
-        // Update animations
-        updateAnimations();
-        
-        // Render only when needed
-        if (animationSystem->isAnimationPlaying() || animationSystem->shouldBlink()) {
-            render();
+    } else if (event.type == assetLoadedEvent) {
+        // Only the output renderer has an atlas; its thread does the uploads
+        outputPipeline->notifyAssetsLoaded();
+    } else if (event.type == controlEvent) {
+        applyControlCommands();
+    } else if (event.type == audioEvent) {
+        applyAudioState();
+    } else if (event.type == previewEvent) {
+        // Presented with the control panel in render()
+        if (previewSink && previewSink->updateTexture(previewTexture)) {
+            previewReady = true;
+            rendererManager->invalidate(rendererManager->getControlTarget());
         }
-        
-        // Frame rate limiting
-        rendererManager->waitForNextFrame();
+    } else if (event.type == stdinKeyEvent) {
+        // Scripted keys are applied in order, like remote KEY commands
+        SDL_Keycode key = static_cast<SDL_Keycode>(event.user.code);
+        handleKeyPress(key);
+        lastKey = key;
+        lastKeyTime = AvatarClock::now();
+    } else if (event.type == SDL_KEYDOWN) {
+        if (event.key.keysym.sym == SDLK_ESCAPE) {
+            return false;
+        } else if (shouldProcessKey(event.key.keysym.sym)) {
+            handleKeyPress(event.key.keysym.sym);
+            lastKey = event.key.keysym.sym;
+            lastKeyTime = AvatarClock::now();
+        }
+    }
+    return true;
+}
+
+int OptimizedAvatarSystem::getWaitTimeout() const {
+    // A threaded output schedules its own frames and camera repeats
+    auto deadline = outputPipeline->getNextDeadline();
+    for (const Avatar& avatar : avatars) {
+        deadline = std::min(deadline, avatar.animation->getNextDeadline());
+    }
+
+    if (stats) {
+        deadline = std::min(deadline, stats->getNextReportTime());
     }
+    
+    auto now = AvatarClock::now();
+    if (deadline <= now) {
+        return 0;
+    }
+    
+    // Round up so we never wake just before the deadline and spin
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+    return static_cast<int>(std::min<std::chrono::milliseconds::rep>(remaining.count(), MAX_WAIT.count()));
 }
 
-void OptimizedAvatarSystem::handleKeyPress(SDL_Keycode key) {
+void OptimizedAvatarSystem::handleKeyPress(SDL_Keycode key, bool renderNow) {
+    Avatar& avatar = selected();
+    
+    // Next avatar
+    if (key == SDLK_TAB) {
+        selectAvatar((selectedAvatar + 1) % static_cast<int>(avatars.size()));
+        if (renderNow) render();
+        return;
+    }
+    
     // Handle horizontal flip
     if (key == SDLK_g) {
-        isFlipped = !isFlipped;
-        std::cout << "Toggled horizontal flip: " << (isFlipped ? "ON" : "OFF") << std::endl;
-        render();
+        avatar.flipped = !avatar.flipped;
+        std::cout << "Toggled horizontal flip: " << (avatar.flipped ? "ON" : "OFF") << std::endl;
+        if (renderNow) render();
         return;
     }
     
-    // Check if key is mapped
-    auto it = keyMappings.find(key);
-    if (it == keyMappings.end()) {
+    // Check if key is mapped (constexpr table indexed by key code)
+    const manifest::KeyBinding* binding = manifest::findBinding(key);
+    if (!binding) {
         return;
     }
     
-    const PoseExpression& mapping = it->second;
-    int oldPose = currentPose;
+    const manifest::KeyBinding& mapping = *binding;
     
-    if (mapping.pose == currentPose) {
+    if (mapping.pose == avatar.pose) {
         // Same pose - toggle expression
         if (key == lastKey) {
-            currentExpression = (currentExpression == 1) ? mapping.expression : 1;
-            std::cout << "Toggled to Pose " << currentPose << ", Expression " << currentExpression << std::endl;
+            avatar.expression = (avatar.expression == 1) ? mapping.expression : 1;
+            std::cout << "Toggled to Pose " << avatar.pose << ", Expression " << avatar.expression << std::endl;
         } else {
-            currentExpression = mapping.expression;
-            std::cout << "Changed to Pose " << currentPose << ", Expression " << currentExpression << std::endl;
+            avatar.expression = mapping.expression;
+            std::cout << "Changed to Pose " << avatar.pose << ", Expression " << avatar.expression << std::endl;
         }
     } else {
         // New pose - play transition animation
-        int newExpression = mapping.expression;
-        std::cout << "Transitioning to Pose " << mapping.pose << ", Expression " << newExpression << std::endl;
+        setPose(mapping.pose, mapping.expression);
+    }
+    
+    if (renderNow) render();
+}
+
+void OptimizedAvatarSystem::setPose(int pose, int expression) {
+    Avatar& avatar = selected();
+    if (pose != avatar.pose) {
+        std::cout << "Transitioning to Pose " << pose << ", Expression " << expression << std::endl;
+        avatar.animation->playPoseTransition(avatar.pose, pose);
+        avatar.pose = pose;
+    }
+    avatar.expression = expression;
+}
+
+void OptimizedAvatarSystem::selectAvatar(int index) {
+    if (index == selectedAvatar) return;
+    
+    // The voice follows the selection: the avatar left behind closes its mouth
+    bool mouthOpen = selected().animation->isMouthOpen();
+    selected().animation->setMouthOpen(false);
+    selectedAvatar = index;
+    selected().animation->setMouthOpen(mouthOpen);
+    std::cout << "Selected avatar " << index + 1 << " of " << avatars.size() << std::endl;
+}
+
+void OptimizedAvatarSystem::applyControlCommands() {
+    if (!controlServer) return;
+    
+    // Each batch is applied whole before the next render, so a pose and its
+    // expression never reach the output as two frames
+    ControlBatch batch;
+    bool applied = false;
+    while (controlServer->pop(batch)) {
+        for (int i = 0; i < batch.count; i++) {
+            applyControlCommand(batch.commands[i]);
+        }
+        if (pendingCommandTime == std::chrono::steady_clock::time_point{} || batch.received < pendingCommandTime) {
+            pendingCommandTime = batch.received;
+        }
+        applied = true;
+    }
+    if (applied) {
+        render();
+    }
+}
+
+void OptimizedAvatarSystem::applyControlCommand(const ControlCommand& command) {
+    switch (command.type) {
+        case ControlCommand::Type::SET_POSE: {
+            const manifest::PoseInfo* pose = manifest::findPose(command.pose);
+            int expression = command.expression ? command.expression : 1;
+            if (!pose || expression < 1 || expression > pose->expressionCount) {
+                std::cerr << "Control: no image for pose " << command.pose << ", expression " << expression << std::endl;
+                return;
+            }
+            setPose(command.pose, expression);
+            break;
+        }
+        case ControlCommand::Type::SET_EXPRESSION: {
+            const manifest::PoseInfo* pose = manifest::findPose(selected().pose);
+            if (!pose || command.expression < 1 || command.expression > pose->expressionCount) {
+                std::cerr << "Control: no expression " << command.expression << " for pose " << selected().pose << std::endl;
+                return;
+            }
+            selected().expression = command.expression;
+            break;
+        }
+        case ControlCommand::Type::FLIP:
+            selected().flipped = command.value < 0 ? !selected().flipped : command.value != 0;
+            break;
+        case ControlCommand::Type::BLINK:
+            selected().animation->startBlink();
+            break;
+        case ControlCommand::Type::SELECT:
+            if (command.value < 1 || command.value > static_cast<int>(avatars.size())) {
+                std::cerr << "Control: no avatar " << command.value << " (" << avatars.size() << " in the scene)" << std::endl;
+                return;
+            }
+            selectAvatar(command.value - 1);
+            break;
+        case ControlCommand::Type::KEY:
+            // Remote keys are explicit requests: no cooldown, but they toggle like keys
+            handleKeyPress(command.value, false);
+            lastKey = command.value;
+            lastKeyTime = AvatarClock::now();
+            break;
+    }
+}
 
-        animationSystem->playPoseTransition(oldPose, mapping.pose);
-        currentPose = mapping.pose;
-        currentExpression = newExpression;
+void OptimizedAvatarSystem::applyAudioState() {
+    if (!audioInput) return;
+    
+    // Latest state only: flaps that came and went before this event are moot
+    bool open = audioInput->isMouthOpen();
+    AnimationSystem& animation = *selected().animation;
+    if (open == animation.isMouthOpen()) {
+        return;
     }
+    animation.setMouthOpen(open);
     
-    render();
+    // Measured like a command: detection to the first output frame showing it
+    auto detected = audioInput->getChangeTime();
+    if (pendingCommandTime == std::chrono::steady_clock::time_point{} || detected < pendingCommandTime) {
+        pendingCommandTime = detected;
+    }
 }
 
 bool OptimizedAvatarSystem::shouldProcessKey(SDL_Keycode key) {
-    auto now = std::chrono::steady_clock::now();
+    auto now = AvatarClock::now();
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastKeyTime);
     return elapsed >= KEY_COOLDOWN;
 }
 
 void OptimizedAvatarSystem::updateAnimations() {
-    animationSystem->update();
+    StageTimer timer(stats.get(), Stats::Stage::ANIMATION);
+    for (Avatar& avatar : avatars) {
+        avatar.animation->update();
+    }
+}
+
+Stats::Resources OptimizedAvatarSystem::getResourceUsage() const {
+    int hits = 0, misses = 0;
+    Stats::Resources resources = {0, 0, 0, 0, 0};
+    resourceManager->getCacheStats(hits, misses);
+    resourceManager->getMemoryStats(resources.surfaceBytes, resources.textureBytes);
+    resources.evictions = resourceManager->getEvictionCount();
+    resources.cacheHits = static_cast<uint64_t>(hits);
+    resources.cacheMisses = static_cast<uint64_t>(misses);
+    return resources;
+}
+
+void OptimizedAvatarSystem::reportStats() {
+    stats->report(getResourceUsage());
 }
 
 void OptimizedAvatarSystem::render() {
-    renderControlPanel();
-    renderOutputWindow();
-    rendererManager->present();
+    SceneSnapshot scene;
+    scene.count = static_cast<int>(avatars.size());
+    for (int i = 0; i < scene.count; i++) {
+        const Avatar& avatar = avatars[i];
+        scene.avatars[i] = avatar.animation->makeSnapshot(avatar.pose, avatar.expression, avatar.flipped);
+    }
+    
+    // Output: the pipeline samples the snapshots itself (on its thread if threaded)
+    outputPipeline->publish(scene, pendingCommandTime);
+    pendingCommandTime = {};
+    outputPipeline->update();
+    
+    // Control panel: full repaint when the status or the preview changed
+    if (rendererManager->hasControlTarget()) {
+        auto* controlTarget = rendererManager->getControlTarget();
+        const AvatarSnapshot& snapshot = scene.avatars[selectedAvatar];
+        ControlView view{selected().pose, snapshot.expression, selectedAvatar, selected().flipped};
+        if (!controlViewValid || !(view == controlView)) {
+            rendererManager->invalidate(controlTarget);
+        }
+        if (rendererManager->isDirty(controlTarget)) {
+            StageTimer timer(stats.get(), Stats::Stage::CONTROL_RENDER);
+            renderControlPanel();
+            controlView = view;
+            controlViewValid = true;
+        }
+        if (rendererManager->isDirty(controlTarget)) {
+            StageTimer timer(stats.get(), Stats::Stage::CONTROL_PRESENT);
+            rendererManager->present(controlTarget);
+        }
+    }
 }
 
 void OptimizedAvatarSystem::renderControlPanel() {
@@ -209,68 +645,38 @@ void OptimizedAvatarSystem::renderControlPanel() {
     // Clear control panel
     rendererManager->clearTarget(controlTarget, {0, 0, 0, 255});
     
-    // Get current texture
-    SDL_Texture* currentTex = getCurrentTexture();
-    if (currentTex) {
-        // Render in left third of control panel
-        int texWidth, texHeight;
-        SDL_QueryTexture(currentTex, nullptr, nullptr, &texWidth, &texHeight);
-        
-        SDL_Rect destRect;
-        destRect.w = texWidth;
-        destRect.h = texHeight;
-        destRect.x = (WINDOW_WIDTH / 3 - texWidth) / 2;
-        destRect.y = (WINDOW_HEIGHT - texHeight) / 2;
-        
-        if (isFlipped) {
-            SDL_RenderCopyEx(controlTarget->renderer, currentTex, nullptr, &destRect, 0, nullptr, SDL_FLIP_HORIZONTAL);
-        } else {
-            SDL_RenderCopy(controlTarget->renderer, currentTex, nullptr, &destRect);
-        }
+    // Output preview, centered in the left half (a frame or two behind the
+    // output: it arrives through the output's readback)
+    if (previewTexture && previewReady) {
+        int width = previewSink->getWidth(), height = previewSink->getHeight();
+        SDL_Rect destRect = {(WINDOW_WIDTH / 2 - width) / 2, (WINDOW_HEIGHT - height) / 2, width, height};
+        SDL_RenderCopy(controlTarget->renderer, previewTexture, nullptr, &destRect);
     }
     
     // Render UI elements
     renderUIElements();
 }
 
-void OptimizedAvatarSystem::renderOutputWindow() {
-    auto* outputTarget = rendererManager->getOutputTarget();
-    
-    // Clear output window
-    rendererManager->clearTarget(outputTarget, BACKGROUND_COLOR);
-    
-    // Get current texture or animation frame
-    SDL_Texture* currentTex = getCurrentTexture();
-    if (currentTex) {
-        rendererManager->renderTextureToTarget(outputTarget, currentTex, isFlipped);
-    }
-}
-
 void OptimizedAvatarSystem::renderUIElements() {
-    if (!font) return;
+    if (!textRenderer) return;
     
-    auto* controlTarget = rendererManager->getControlTarget();
     SDL_Color white = {255, 255, 255, 255};
     
-    // Status text
-    std::string poseName = poses.count(currentPose) ? poses[currentPose] : std::to_string(currentPose);
-    std::string statusText = "Current: Pose " + std::to_string(currentPose) +
+    // Status text (rasterized once per distinct value)
+    const Avatar& avatar = selected();
+    const manifest::PoseInfo* pose = manifest::findPose(avatar.pose);
+    std::string poseName = (pose && pose->name[0]) ? pose->name : std::to_string(avatar.pose);
+    std::string statusText = "Current: Pose " + std::to_string(avatar.pose) +
                            " (" + poseName + "), Exp " + std::to_string(getEffectiveExpression()) +
-                           ", Flip: " + (isFlipped ? "ON" : "OFF");
-    
-    SDL_Surface* textSurface = TTF_RenderText_Solid(font, statusText.c_str(), white);
-    if (textSurface) {
-        SDL_Texture* textTexture = SDL_CreateTextureFromSurface(controlTarget->renderer, textSurface);
-        if (textTexture) {
-            SDL_Rect textRect = {20, 20, textSurface->w, textSurface->h};
-            SDL_RenderCopy(controlTarget->renderer, textTexture, nullptr, &textRect);
-            SDL_DestroyTexture(textTexture);
-        }
-        SDL_FreeSurface(textSurface);
+                           ", Flip: " + (avatar.flipped ? "ON" : "OFF");
+    if (avatars.size() > 1) {
+        statusText = "Avatar " + std::to_string(selectedAvatar + 1) + "/" + std::to_string(avatars.size()) +
+                     " " + statusText;
     }
+    textRenderer->drawText(statusText, 20, 20, white);
     
-    // Controls guide
-    const char* controls[] = {
+    // Controls guide (static, one texture)
+    static const std::vector<std::string> controls = {
         "Controls:",
         "Q,A,Z: Pose 1",
         "W,S,X: Pose 3", 
@@ -279,54 +685,66 @@ void OptimizedAvatarSystem::renderUIElements() {
         "G: Flip",
         "ESC: Exit"
     };
-    
-    int yPos = 70;
-    for (const char* control : controls) {
-        textSurface = TTF_RenderText_Solid(font, control, white);
-        if (textSurface) {
-            SDL_Texture* textTexture = SDL_CreateTextureFromSurface(controlTarget->renderer, textSurface);
-            if (textTexture) {
-                SDL_Rect textRect = {WINDOW_WIDTH / 2, yPos, textSurface->w, textSurface->h};
-                SDL_RenderCopy(controlTarget->renderer, textTexture, nullptr, &textRect);
-                SDL_DestroyTexture(textTexture);
-            }
-            SDL_FreeSurface(textSurface);
-        }
-        yPos += 25;
-    }
-}
-
-SDL_Texture* OptimizedAvatarSystem::getCurrentTexture() {
-    int effectiveExpression = getEffectiveExpression();
-    
-    // Check if we have an animation frame
-    SDL_Surface* animFrame = animationSystem->getCurrentFrame();
-    if (animFrame) {
-        return SDL_CreateTextureFromSurface(rendererManager->getControlTarget()->renderer, animFrame);
+    textRenderer->drawLines(controls, WINDOW_WIDTH / 2, 70, 25, white);
+    if (avatars.size() > 1) {
+        textRenderer->drawText("Tab: Next avatar", WINDOW_WIDTH / 2, 70 + 25 * static_cast<int>(controls.size()), white);
     }
-    
-    // Get regular texture
-    return resourceManager->getImageTexture(currentPose, effectiveExpression, 
-                                          rendererManager->getControlTarget()->renderer);
 }
 
 int OptimizedAvatarSystem::getEffectiveExpression() {
-    return animationSystem->getCurrentExpression(currentExpression);
+    const Avatar& avatar = selected();
+    return avatar.animation->getCurrentExpression(avatar.expression);
 }
 
 void OptimizedAvatarSystem::shutdown() {
+    if (!sdlInitialized) {
+        return;
+    }
+    
     std::cout << "Shutting down Optimized Avatar System..." << std::endl;
     
+    textRenderer.reset();
     if (font) {
         TTF_CloseFont(font);
         font = nullptr;
     }
     
-    // Smart pointers will automatically clean up
+    if (stdinInput) {
+        stdinInput->stop();
+        stdinInput.reset();
+    }
+    
+    audioInput.reset();
+    
+    if (controlServer) {
+        controlServer->stop();
+        controlServer.reset();
+    }
+    
+    // Last partial window
+    if (stats && resourceManager) {
+        reportStats();
+    }
+    
+    // Stops the output thread, which destroys the output renderer it owns
+    // (and the preview sink, after its last push)
+    outputPipeline.reset();
+    previewSink = nullptr;
+    if (previewTexture) {
+        SDL_DestroyTexture(previewTexture);
+        previewTexture = nullptr;
+    }
+    
+    // Everything SDL-backed must go before SDL_Quit: renderers first (their
+    // atlases are released through the destroy callback), then the surfaces
+    avatars.clear();
+    rendererManager.reset();
+    resourceManager.reset();
     
     TTF_Quit();
     IMG_Quit();
     SDL_Quit();
+    sdlInitialized = false;
     
     std::cout << "Shutdown complete." << std::endl;
 }
\ No newline at end of file
@@ -7,75 +7,172 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <vector>
 #include <chrono>
 
 #include "resource_manager.h"
 #include "renderer_manager.h"
 #include "animation_system.h"
+#include "video_sink.h"
+#include "shm_sink.h"
+#include "record_sink.h"
+#include "preview_sink.h"
+#include "output_pipeline.h"
+#include "input_source.h"
+#include "control_server.h"
+#include "audio_input.h"
+#include "text_renderer.h"
+#include "stats.h"
 
 class OptimizedAvatarSystem {
 public:
-    struct PoseExpression {
-        int pose;
-        int expression;
-        PoseExpression(int p, int e) : pose(p), expression(e) {}
+    struct Config {
+        std::string modelDirectory = "model";
+        bool watchModel = false; // reload images whose files in modelDirectory change
+        const EmbeddedImage* embeddedImages = nullptr; // if set, used instead of modelDirectory
+        int embeddedImageCount = 0;
+        std::string assetPack; // pre-decoded pack from generate_asset_pack.py, preferred if set
+        std::string videoDevice; // empty = no virtual camera
+        std::string sharedMemoryName; // empty = no shared memory output
+        bool transparentBackground = false; // output background alpha 0 instead of green
+        std::string recordPath;  // file, clip.mp4 via ffmpeg or "|command"; empty = no recording
+        double recordFrameRate = 30.0;
+        int outputWidth = 800;   // output window/target and sink frame size; images
+        int outputHeight = 600;  // scale with the height (native size at 600)
+        bool headless = false;   // no windows, commands from stdin
+        bool stdinCommands = true; // headless: read key commands from stdin
+        bool threadedOutput = true; // draw the output on its own thread
+        bool warmStart = false;  // decode the whole model on all cores before starting
+        bool stats = false;      // periodic timing/cache report
+        std::string statsPath;   // JSON lines file for the report, stderr if empty
+        unsigned randomSeed = 0; // blink timing seed, 0 = seed from the time
+        size_t memoryBudget = 0; // bytes for decoded surfaces + atlas textures, 0 = unlimited
+        std::string controlSocket; // Unix socket path for remote commands, empty = none
+        int oscPort = 0;           // localhost UDP port for OSC commands, 0 = none
+        bool microphone = false;   // open the mouth while the microphone hears speech
+        std::string microphoneDevice; // SDL capture device name, empty = default
+        float microphoneThresholdDb = -35.0f; // RMS level that opens the mouth
+        int mouthExpression = 4;   // expression shown while the mouth is open
+        int avatarCount = 1;       // avatars side by side in the output, each with its own state
     };
 
 private:
     // Core components
     std::unique_ptr<ResourceManager> resourceManager;
     std::unique_ptr<RendererManager> rendererManager;
-    std::unique_ptr<AnimationSystem> animationSystem;
+    std::unique_ptr<OutputPipeline> outputPipeline; // output window/offscreen target and camera
+    std::unique_ptr<StdinInputSource> stdinInput;
+    std::unique_ptr<ControlServer> controlServer; // nullptr unless --control / --osc-port
+    std::unique_ptr<AudioInput> audioInput; // nullptr unless --mic
+    std::unique_ptr<Stats> stats; // nullptr unless --stats
     
     // UI components
     TTF_Font* font;
+    std::unique_ptr<TextRenderer> textRenderer; // control panel text, cached as textures
     
     // State management
-    int currentPose;
-    int currentExpression;
-    bool isFlipped;
+    bool sdlInitialized;
+    bool headless;
+    
+    // One avatar of the output scene: its own pose, expression, flip,
+    // transitions and blinks. All of them draw from the same atlases.
+    struct Avatar {
+        int pose;
+        int expression;
+        bool flipped;
+        std::unique_ptr<AnimationSystem> animation;
+    };
+    std::vector<Avatar> avatars; // drawing order, at least one after initialize
+    int selectedAvatar;          // the one keys, commands and the voice change
     SDL_Keycode lastKey;
     std::chrono::steady_clock::time_point lastKeyTime;
     
+    // What the control panel's status line shows; it is redrawn when this
+    // changes or a new output frame reaches the preview
+    struct ControlView {
+        int statusPose;
+        int statusExpression;
+        int statusAvatar;
+        bool statusFlipped;
+        
+        bool operator==(const ControlView& other) const {
+            return statusPose == other.statusPose && statusExpression == other.statusExpression &&
+                   statusAvatar == other.statusAvatar && statusFlipped == other.statusFlipped;
+        }
+    };
+    ControlView controlView;
+    bool controlViewValid;
+    
+    // Output preview on the control panel. The model's textures live only on
+    // the output renderer; the panel shows the output's frames in one texture.
+    PreviewSink* previewSink;   // owned by outputPipeline; nullptr without a control panel
+    SDL_Texture* previewTexture; // on the control renderer
+    bool previewReady;          // the texture holds a frame
+    Uint32 previewEvent;        // pushed by the output thread when the preview changed
+    Uint32 assetLoadedEvent;    // pushed by loader threads to wake the main loop
+    Uint32 controlEvent;        // pushed by the control server when commands are queued
+    Uint32 audioEvent;          // pushed when the microphone opens or closes the mouth
+    Uint32 stdinKeyEvent;       // pushed by the stdin reader per scripted key (user.code)
+    int voiceExpression;        // open mouth expression with --mic (prefetched), else 0
+    std::chrono::steady_clock::time_point pendingCommandTime; // oldest command not yet published
+    
     // Configuration
     const int WINDOW_WIDTH = 800;
-    const int WINDOW_HEIGHT = 600;
+    const int WINDOW_HEIGHT = 600; // also the output height at which images are drawn 1:1
     const std::chrono::milliseconds KEY_COOLDOWN{100};
+    const std::chrono::milliseconds MAX_WAIT{1000}; // upper bound on one idle sleep
     const SDL_Color BACKGROUND_COLOR = {0, 255, 0, 255};
-    
-    // Poses and key mappings
-    std::map<int, std::string> poses;
-    std::map<SDL_Keycode, PoseExpression> keyMappings;
+    const SDL_Color TRANSPARENT_COLOR = {0, 0, 0, 0};
     
 public:
     OptimizedAvatarSystem();
     ~OptimizedAvatarSystem();
     
-    bool initialize(const std::string& modelDirectory);
+    bool initialize(const Config& config);
     void run();
     void shutdown();
     
+    // One main loop iteration: wait up to timeoutMs for events, handle them,
+    // animate and render. False once the app should quit. run() is
+    // step(getWaitTimeout()) in a loop; the benchmark drives it directly.
+    bool step(int timeoutMs);
+    int getWaitTimeout() const; // ms until the next scheduled deadline
+    
+    // Start a blink now on the selected avatar (scripted input; blinks are otherwise scheduled)
+    void triggerBlink();
+    
+    // Cache and memory totals, as reported by --stats
+    Stats::Resources getResourceUsage() const;
+    
 private:
-    bool initializeSDL();
+    bool initializeSDL(bool headlessMode);
     bool initializeFonts();
-    void setupMappings();
+    std::vector<std::pair<int, int>> getReachableImages() const;
     
     // Event handling
-    void handleKeyPress(SDL_Keycode key);
+    bool handleEvent(const SDL_Event& event); // false when the app should quit
+    void handleKeyPress(SDL_Keycode key, bool renderNow = true); // false: caller renders
     bool shouldProcessKey(SDL_Keycode key);
+    void applyControlCommands();
+    void applyControlCommand(const ControlCommand& command);
+    void applyAudioState();
+    void setPose(int pose, int expression); // transition if the pose changes
+    Avatar& selected() { return avatars[selectedAvatar]; }
+    void selectAvatar(int index); // the voice moves along
     
     // Rendering
     void renderControlPanel();
-    void renderOutputWindow();
     void render();
     void renderUIElements();
     
     // Animation
     void updateAnimations();
     
+    // Instrumentation
+    void reportStats();
+    
     // Utility
     std::string getModelDirectory();
-    SDL_Texture* getCurrentTexture();
     int getEffectiveExpression();
 };
 
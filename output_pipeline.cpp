@@ -0,0 +1,364 @@
+#include "output_pipeline.h"
+#include "avatar_clock.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+OutputPipeline::OutputPipeline(RendererManager* renderers, ResourceManager* resources,
+                               std::vector<std::unique_ptr<FrameSink>> frameSinks)
+    : rendererManager(renderers)
+    , resourceManager(resources)
+    , sinks(std::move(frameSinks))
+    , stats(nullptr)
+    , imageScale(1.0f)
+    , redrawRequested(false)
+    , lastPublished{}, hasPublished(false)
+    , commandTimestamp(0)
+    , current{}, hasSnapshot(false)
+    , shownViews{}, shownRects{}, shownCount(0), shownValid(false)
+    , uploadsPending(false)
+    , shownCommandTime(0)
+    , wakeRequested(false), stopRequested(false)
+    , threaded(false), rendererCreated(false) {
+    sceneImages.reserve(SceneSnapshot::MAX_AVATARS);
+    if (!sinks.empty()) {
+        auto* outputTarget = rendererManager->getOutputTarget();
+        sinkPixels.resize(static_cast<size_t>(outputTarget->width) * outputTarget->height * 4);
+    }
+}
+
+OutputPipeline::~OutputPipeline() {
+    stop();
+}
+
+bool OutputPipeline::start(bool threadedOutput) {
+    if (threadedOutput) {
+        std::promise<bool> ready;
+        std::future<bool> started = ready.get_future();
+        outputThread = std::thread(&OutputPipeline::threadMain, this, std::move(ready));
+        if (started.get()) {
+            threaded = true;
+            return true;
+        }
+
+        outputThread.join();
+        std::cerr << "Warning: Output thread could not create its renderer, rendering output on the main thread" << std::endl;
+    }
+
+    return createRenderer();
+}
+
+void OutputPipeline::stop() {
+    if (outputThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopRequested = true;
+        }
+        wakeCondition.notify_one();
+        outputThread.join();
+        threaded = false;
+    } else if (rendererCreated) {
+        rendererManager->destroyOutputRenderer();
+        rendererCreated = false;
+    }
+}
+
+bool OutputPipeline::createRenderer() {
+    if (!rendererManager->createOutputRenderer()) {
+        std::cerr << "Failed to create output renderer" << std::endl;
+        return false;
+    }
+    rendererCreated = true;
+
+    // Animate at the display's refresh rate; headless, at the rate the sinks take frames
+    auto* outputTarget = rendererManager->getOutputTarget();
+    double rate = outputTarget->refreshRate;
+    if (rate <= 0) {
+        for (const auto& sink : sinks) {
+            rate = std::max(rate, sink->getFrameRate());
+        }
+    }
+    pacer.setRate(rate, outputTarget->vsync);
+
+    // Pack every image into the output renderer's atlas up front, at output size
+    // (in memory, premultiplied, when the output is composited on the CPU)
+    resourceManager->buildAtlas(outputTarget->renderer, imageScale, rendererManager->hasCpuCompositor(outputTarget));
+    return true;
+}
+
+void OutputPipeline::threadMain(std::promise<bool> ready) {
+    // The renderer and its textures must be created, used and destroyed on this thread
+    if (!createRenderer()) {
+        ready.set_value(false);
+        return;
+    }
+    ready.set_value(true);
+
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            auto wakeAt = std::min(deadline, AvatarClock::now() + MAX_WAIT);
+            wakeCondition.wait_until(lock, wakeAt, [this] { return wakeRequested || stopRequested; });
+            if (stopRequested) {
+                break;
+            }
+            wakeRequested = false;
+        }
+
+        auto now = AvatarClock::now();
+        drawFrame(now);
+        deadline = nextDeadline(now);
+    }
+
+    rendererManager->destroyOutputRenderer();
+    rendererCreated = false;
+}
+
+void OutputPipeline::wake() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeRequested = true;
+    }
+    wakeCondition.notify_one();
+}
+
+void OutputPipeline::publish(const SceneSnapshot& snapshot, std::chrono::steady_clock::time_point commandTime) {
+    if (hasPublished && snapshot == lastPublished) {
+        return;
+    }
+    lastPublished = snapshot;
+    hasPublished = true;
+
+    // Stamp before the write so the reader sees it with the snapshot; keep the
+    // oldest if the output thread has not caught up yet
+    if (commandTime != std::chrono::steady_clock::time_point{}) {
+        int64_t expected = 0;
+        commandTimestamp.compare_exchange_strong(expected, commandTime.time_since_epoch().count(),
+                                                 std::memory_order_relaxed);
+    }
+
+    snapshots.write(snapshot);
+    if (threaded) {
+        wake();
+    }
+}
+
+void OutputPipeline::invalidate() {
+    redrawRequested.store(true, std::memory_order_relaxed);
+    if (threaded) {
+        wake();
+    }
+}
+
+void OutputPipeline::notifyAssetsLoaded() {
+    if (threaded) {
+        wake();
+    }
+}
+
+void OutputPipeline::update() {
+    if (!threaded && rendererCreated) {
+        drawFrame(AvatarClock::now());
+    }
+}
+
+std::chrono::steady_clock::time_point OutputPipeline::getNextDeadline() const {
+    if (threaded) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return nextDeadline(AvatarClock::now());
+}
+
+std::chrono::steady_clock::time_point OutputPipeline::nextDeadline(std::chrono::steady_clock::time_point now) const {
+    auto deadline = std::chrono::steady_clock::time_point::max();
+
+    // Sample a running transition once per present, and once more at its end
+    // so the final pose is drawn
+    if (hasSnapshot && current.isAnimatingAt(now)) {
+        deadline = std::min(pacer.nextFrameTime(now), current.nextTransitionEnd(now));
+    }
+
+    // Uploads continue, and readbacks in flight are collected, on the next frame
+    if (uploadsPending || rendererManager->hasPendingReadback(rendererManager->getOutputTarget())) {
+        deadline = std::min(deadline, pacer.nextFrameTime(now));
+    }
+
+    for (const auto& sink : sinks) {
+        deadline = std::min(deadline, sink->getNextRepeatTime());
+    }
+    return deadline;
+}
+
+void OutputPipeline::drawFrame(std::chrono::steady_clock::time_point now) {
+    // Prefetched images reach the atlas a slice per frame, before any key needs them;
+    // reloaded ones all at once, between frames
+    SDL_Renderer* renderer = rendererManager->getOutputTarget()->renderer;
+    bool reloaded = resourceManager->applyReloads(renderer);
+    uploadsPending = resourceManager->uploadPendingImages(renderer, UPLOAD_BUDGET);
+
+    SceneSnapshot latest;
+    if (snapshots.read(latest)) {
+        current = latest;
+        hasSnapshot = true;
+        int64_t stamp = commandTimestamp.exchange(0, std::memory_order_relaxed);
+        if (stamp != 0 && shownCommandTime == 0) {
+            shownCommandTime = stamp;
+        }
+    }
+
+    bool rendered = false;
+    if (hasSnapshot) {
+        if (redrawRequested.exchange(false, std::memory_order_relaxed) || reloaded) {
+            shownValid = false;
+        }
+
+        AvatarView views[SceneSnapshot::MAX_AVATARS];
+        for (int i = 0; i < current.count; i++) {
+            views[i] = current.avatars[i].evaluate(now);
+        }
+        invalidateScene(views, current.count);
+
+        auto* outputTarget = rendererManager->getOutputTarget();
+        if (rendererManager->isDirty(outputTarget)) {
+            renderScene();
+            {
+                StageTimer timer(stats, Stats::Stage::OUTPUT_PRESENT);
+                rendererManager->present(outputTarget);
+            }
+            pacer.presented(AvatarClock::now());
+            recordCommandLatency();
+            rendered = true;
+        }
+    }
+
+    // Readbacks of earlier frames complete while nothing new is drawn
+    if (!rendered) {
+        collectSinkFrames();
+    }
+
+    // Keep the virtual camera fed with the last frame while idle
+    for (auto& sink : sinks) {
+        sink->repeatFrame();
+    }
+}
+
+void OutputPipeline::recordCommandLatency() {
+    if (shownCommandTime == 0) {
+        return;
+    }
+    // Real time on purpose: the command was stamped by the I/O thread's clock
+    if (stats) {
+        std::chrono::steady_clock::time_point received{std::chrono::steady_clock::duration(shownCommandTime)};
+        stats->record(Stats::Stage::COMMAND_LATENCY, std::chrono::steady_clock::now() - received);
+    }
+    shownCommandTime = 0;
+}
+
+SDL_Rect OutputPipeline::getAvatarArea(int index, int count) const {
+    auto* outputTarget = rendererManager->getOutputTarget();
+    int left = outputTarget->width * index / count;
+    int right = outputTarget->width * (index + 1) / count;
+    return {left, 0, right - left, outputTarget->height};
+}
+
+void OutputPipeline::invalidateScene(const AvatarView* views, int count) {
+    auto* outputTarget = rendererManager->getOutputTarget();
+
+    // Avatars added or removed move every column
+    if (!shownValid || count != shownCount) {
+        rendererManager->invalidate(outputTarget);
+    }
+
+    // Every image of this frame stays put while the later ones are uploaded
+    sceneImages.clear();
+    resourceManager->beginScene();
+    for (int i = 0; i < count; i++) {
+        const AvatarView& view = views[i];
+        ModelImage image = resourceManager->getModelImage(view.pose, view.expression, outputTarget->renderer);
+        SDL_Rect imageRect = {0, 0, 0, 0};
+        if (image.isValid()) {
+            SDL_Rect area = getAvatarArea(i, count);
+            imageRect = view.transform.apply(area.x, area.y, area.w, area.h, image.base.rect.w, image.base.rect.h);
+        }
+        sceneImages.push_back({image, imageRect, view.flipped});
+
+        const AvatarView& shownView = shownViews[i];
+        SDL_Rect diff;
+        if (!shownValid || count != shownCount) {
+            // Whole target already damaged
+        } else if (view == shownView) {
+            // Nothing visible changed
+        } else if (view.pose == shownView.pose && view.flipped == shownView.flipped &&
+                   view.transform == shownView.transform &&
+                   resourceManager->getExpressionDiffRect(view.pose, shownView.expression, view.expression, diff)) {
+            // Expression change (e.g. a blink): only the pixels that differ, usually the face
+            if (diff.w > 0 && diff.h > 0) {
+                if (imageScale != 1.0f) {
+                    // Diffs are in source pixels; resampling spreads a change by up to a pixel
+                    int left = static_cast<int>(std::floor(diff.x * imageScale)) - 1;
+                    int top = static_cast<int>(std::floor(diff.y * imageScale)) - 1;
+                    int right = static_cast<int>(std::ceil((diff.x + diff.w) * imageScale)) + 1;
+                    int bottom = static_cast<int>(std::ceil((diff.y + diff.h) * imageScale)) + 1;
+                    diff = {left, top, right - left, bottom - top};
+                }
+                SDL_Rect damage = diff;
+                damage.x = view.flipped ? imageRect.x + imageRect.w - diff.x - diff.w : imageRect.x + diff.x;
+                damage.y = imageRect.y + diff.y;
+                rendererManager->invalidate(outputTarget, damage);
+            }
+        } else {
+            // Moved or different image: old and new footprint
+            rendererManager->invalidate(outputTarget, shownRects[i]);
+            rendererManager->invalidate(outputTarget, imageRect);
+        }
+
+        shownViews[i] = view;
+        shownRects[i] = imageRect;
+    }
+    shownCount = count;
+    shownValid = true;
+}
+
+void OutputPipeline::renderScene() {
+    auto* outputTarget = rendererManager->getOutputTarget();
+
+    // Images placed by their transition transforms while those play; only the dirty region is repainted
+    {
+        StageTimer timer(stats, Stats::Stage::OUTPUT_RENDER);
+        rendererManager->renderSceneToTarget(outputTarget, sceneImages.data(), static_cast<int>(sceneImages.size()));
+    }
+
+    updateSinks(outputTarget->dirtyRect);
+}
+
+void OutputPipeline::updateSinks(const SDL_Rect& dirtyRect) {
+    if (sinks.empty()) return;
+    StageTimer timer(stats, Stats::Stage::CAMERA_WRITE);
+
+    // Only the damaged region is read back; the rest of sinkPixels is still
+    // current. Sinks get frames as the asynchronous reads complete.
+    auto* outputTarget = rendererManager->getOutputTarget();
+    SDL_Rect delivered;
+    rendererManager->readTargetPixels(outputTarget, sinkPixels.data(), outputTarget->width * 4, dirtyRect, delivered);
+    pushSinkFrame(delivered);
+}
+
+void OutputPipeline::collectSinkFrames() {
+    auto* outputTarget = rendererManager->getOutputTarget();
+    if (sinks.empty() || !rendererManager->hasPendingReadback(outputTarget)) return;
+    StageTimer timer(stats, Stats::Stage::CAMERA_WRITE);
+
+    SDL_Rect delivered;
+    rendererManager->collectTargetPixels(outputTarget, sinkPixels.data(), outputTarget->width * 4, delivered);
+    pushSinkFrame(delivered);
+}
+
+void OutputPipeline::pushSinkFrame(const SDL_Rect& dirtyRect) {
+    if (dirtyRect.w <= 0 || dirtyRect.h <= 0) return;
+
+    int pitch = rendererManager->getOutputTarget()->width * 4;
+    for (auto& sink : sinks) {
+        sink->pushFrame(sinkPixels.data(), pitch, dirtyRect);
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef OUTPUT_PIPELINE_H
+#define OUTPUT_PIPELINE_H
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "animation_system.h"
+#include "frame_pacer.h"
+#include "frame_sink.h"
+#include "renderer_manager.h"
+#include "resource_manager.h"
+#include "stats.h"
+#include "triple_buffer.h"
+
+// Draws the output window (or the headless offscreen target) and feeds the
+// frame sinks (virtual camera, shared memory). Threaded, the output renderer lives on a dedicated thread:
+// the main thread publishes scene snapshots through a lock-free triple buffer
+// and never waits on vsync, readback or YUV conversion. The condition variable
+// is only a wakeup; no state is shared under it.
+//
+// Inline (--single-thread, or if the thread cannot create its renderer) the
+// same code runs on the main thread from update().
+//
+// A scene of several avatars is laid out side by side: avatar i of n is
+// centered in the i-th of n equal columns of the output, drawn in order so
+// overlapping neighbours stack left to right. Damage is tracked per avatar
+// and the dirty region is drawn in one batch (RendererManager), so a blink
+// in a crowd repaints one face, not the crowd.
+class OutputPipeline {
+private:
+    RendererManager* rendererManager;
+    ResourceManager* resourceManager;
+    std::vector<std::unique_ptr<FrameSink>> sinks;
+    std::vector<Uint8> sinkPixels; // last frame read back, always complete (may trail the window)
+    Stats* stats;
+    float imageScale; // output images are pre-scaled by this in the atlas
+
+    // Main thread -> output thread
+    TripleBuffer<SceneSnapshot> snapshots;
+    std::atomic<bool> redrawRequested; // window exposed or resized
+    SceneSnapshot lastPublished;       // main thread only
+    bool hasPublished;
+    std::atomic<int64_t> commandTimestamp; // steady_clock ns of the oldest unshown command, 0 if none
+
+    // Output thread only (main thread when inline)
+    SceneSnapshot current;
+    bool hasSnapshot;
+    AvatarView shownViews[SceneSnapshot::MAX_AVATARS]; // what the output currently shows
+    SDL_Rect shownRects[SceneSnapshot::MAX_AVATARS];   // where each image was last drawn
+    int shownCount;
+    bool shownValid;
+    std::vector<SceneImage> sceneImages; // this frame's images, placed (reserved up front)
+    bool uploadsPending;    // budget ran out with decoded images left to upload
+    FramePacer pacer;       // transition frames at the output's present rate
+    int64_t shownCommandTime; // command behind the snapshot being drawn, 0 if none
+
+    std::thread outputThread;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool wakeRequested;
+    bool stopRequested;
+    bool threaded;
+    bool rendererCreated;
+
+    const std::chrono::milliseconds MAX_WAIT{1000};     // upper bound on one idle sleep
+    const std::chrono::microseconds UPLOAD_BUDGET{2000}; // texture uploads per frame
+
+public:
+    OutputPipeline(RendererManager* renderers, ResourceManager* resources,
+                   std::vector<std::unique_ptr<FrameSink>> frameSinks);
+    ~OutputPipeline();
+
+    OutputPipeline(const OutputPipeline&) = delete;
+    OutputPipeline& operator=(const OutputPipeline&) = delete;
+
+    // Time output stages into target (set before start)
+    void setStats(Stats* target) { stats = target; }
+    
+    // Draw images at scale times their size, resampled once per image (set before start)
+    void setImageScale(float scale) { imageScale = scale; }
+
+    // Create the output renderer, on a new thread if threadedOutput. Falls back
+    // to inline rendering if the thread cannot create it; false if neither works.
+    bool start(bool threadedOutput);
+
+    // Stop the thread and destroy the output renderer (idempotent)
+    void stop();
+
+    // Main thread: hand over the latest state (ignored if unchanged). With a
+    // commandTime, the time until the change is presented is recorded as
+    // command latency.
+    void publish(const SceneSnapshot& snapshot,
+                 std::chrono::steady_clock::time_point commandTime = {});
+
+    // Any thread: repaint the whole output on the next frame
+    void invalidate();
+
+    // Any thread: decoded images are waiting to be uploaded to the output atlas
+    void notifyAssetsLoaded();
+
+    // Inline mode: draw and present the latest snapshot, keep the sinks fed
+    void update();
+
+    // Inline mode: when update() next has work to do; max() when threaded
+    std::chrono::steady_clock::time_point getNextDeadline() const;
+
+    bool isThreaded() const { return threaded; }
+
+private:
+    bool createRenderer();
+    void threadMain(std::promise<bool> ready);
+    void wake();
+
+    // One output frame at time now
+    void drawFrame(std::chrono::steady_clock::time_point now);
+    std::chrono::steady_clock::time_point nextDeadline(std::chrono::steady_clock::time_point now) const;
+
+    // Area avatar index of count is centered in
+    SDL_Rect getAvatarArea(int index, int count) const;
+    
+    // Place views into sceneImages and damage what changed since the last frame
+    void invalidateScene(const AvatarView* views, int count);
+    void recordCommandLatency();
+    void renderScene();
+    void updateSinks(const SDL_Rect& dirtyRect); // read back a drawn frame
+    void collectSinkFrames();                     // readbacks finished while idle
+    void pushSinkFrame(const SDL_Rect& dirtyRect);
+};
+
+#endif // OUTPUT_PIPELINE_H
@@ -0,0 +1,66 @@
+#include "preview_sink.h"
+#include <algorithm>
+
+PreviewSink::PreviewSink(int outputWidth, int outputHeight, int previewWidth, int previewHeight)
+    : frameWidth(outputWidth), frameHeight(outputHeight)
+    , width(std::max(1, previewWidth)), height(std::max(1, previewHeight))
+    , pixels(static_cast<size_t>(width) * height, 0)
+    , dirty{0, 0, 0, 0} {
+    // Sample the frame pixel under each preview pixel's center
+    columns.resize(width);
+    for (int x = 0; x < width; x++) {
+        columns[x] = static_cast<int>((2 * static_cast<int64_t>(x) + 1) * frameWidth / (2 * width));
+    }
+    rows.resize(height);
+    for (int y = 0; y < height; y++) {
+        rows[y] = static_cast<int>((2 * static_cast<int64_t>(y) + 1) * frameHeight / (2 * height));
+    }
+}
+
+void PreviewSink::pushFrame(const void* rgbaPixels, int pitch, const SDL_Rect& dirtyRect) {
+    // Preview pixels sampled from inside dirtyRect (the maps are ascending)
+    int x0 = static_cast<int>(std::lower_bound(columns.begin(), columns.end(), dirtyRect.x) - columns.begin());
+    int x1 = static_cast<int>(std::lower_bound(columns.begin(), columns.end(), dirtyRect.x + dirtyRect.w) - columns.begin());
+    int y0 = static_cast<int>(std::lower_bound(rows.begin(), rows.end(), dirtyRect.y) - rows.begin());
+    int y1 = static_cast<int>(std::lower_bound(rows.begin(), rows.end(), dirtyRect.y + dirtyRect.h) - rows.begin());
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int y = y0; y < y1; y++) {
+            const Uint32* source = reinterpret_cast<const Uint32*>(
+                static_cast<const Uint8*>(rgbaPixels) + static_cast<size_t>(rows[y]) * pitch);
+            Uint32* out = pixels.data() + static_cast<size_t>(y) * width;
+            for (int x = x0; x < x1; x++) {
+                out[x] = source[columns[x]];
+            }
+        }
+
+        // One wakeup until the main thread has taken the changes
+        SDL_Rect changed = {x0, y0, x1 - x0, y1 - y0};
+        wake = dirty.w <= 0 || dirty.h <= 0;
+        if (wake) {
+            dirty = changed;
+        } else {
+            SDL_UnionRect(&dirty, &changed, &dirty);
+        }
+    }
+    if (wake && wakeCallback) {
+        wakeCallback();
+    }
+}
+
+bool PreviewSink::updateTexture(SDL_Texture* texture) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!texture || dirty.w <= 0 || dirty.h <= 0) {
+        return false;
+    }
+
+    const Uint32* first = pixels.data() + static_cast<size_t>(dirty.y) * width + dirty.x;
+    SDL_UpdateTexture(texture, &dirty, first, width * static_cast<int>(sizeof(Uint32)));
+    dirty = {0, 0, 0, 0};
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef PREVIEW_SINK_H
+#define PREVIEW_SINK_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "frame_sink.h"
+
+// Control panel view of the output. SDL renderers cannot share textures, so
+// instead of a second atlas (every image uploaded again, GPU memory doubled)
+// the control panel shows the frames the output pipeline already reads back
+// for its other sinks. The model's textures stay resident once, on the output
+// renderer. Frames are downscaled (nearest neighbour) into a small RGBA
+// buffer on the output thread; the main thread copies the changed part into
+// one streaming texture on its own renderer.
+class PreviewSink : public FrameSink {
+private:
+    int frameWidth, frameHeight; // output frames
+    int width, height;           // preview
+    std::vector<int> columns;    // frame column of each preview column
+    std::vector<int> rows;       // frame row of each preview row
+
+    std::mutex mutex;
+    std::vector<Uint32> pixels;  // preview, RGBA32 bytes (guarded)
+    SDL_Rect dirty;              // preview pixels changed since the last update (guarded)
+    std::function<void()> wakeCallback;
+
+public:
+    PreviewSink(int outputWidth, int outputHeight, int previewWidth, int previewHeight);
+
+    PreviewSink(const PreviewSink&) = delete;
+    PreviewSink& operator=(const PreviewSink&) = delete;
+
+    // Called on the output thread when a frame changed the preview after the
+    // last update (set before the pipeline starts)
+    void setWakeCallback(std::function<void()> callback) { wakeCallback = std::move(callback); }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    void pushFrame(const void* rgbaPixels, int pitch, const SDL_Rect& dirtyRect) override;
+
+    // Main thread: copy what changed into texture (previewWidth x previewHeight,
+    // SDL_PIXELFORMAT_RGBA32, streaming); false if nothing did
+    bool updateTexture(SDL_Texture* texture);
+};
+
+#endif // PREVIEW_SINK_H
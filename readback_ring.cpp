@@ -0,0 +1,235 @@
+#include "readback_ring.h"
+#include <SDL2/SDL_opengl.h>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+Uint8* framePosition(void* pixels, int pitch, int x, int y) {
+    return static_cast<Uint8*>(pixels) + static_cast<size_t>(y) * pitch + static_cast<size_t>(x) * 4;
+}
+
+// Synchronous fallback: SDL_RenderReadPixels waits for the GPU to finish
+class SyncReadbackRing : public ReadbackRing {
+private:
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+
+public:
+    SyncReadbackRing(SDL_Renderer* targetRenderer, SDL_Texture* targetTexture)
+        : renderer(targetRenderer), texture(targetTexture) {}
+
+    bool read(const SDL_Rect& rect, void* pixels, int pitch, SDL_Rect& delivered) override {
+        delivered = {0, 0, 0, 0};
+        if (SDL_SetRenderTarget(renderer, texture) != 0) {
+            std::cerr << "Failed to set render target for readback: " << SDL_GetError() << std::endl;
+            return false;
+        }
+
+        int result = SDL_RenderReadPixels(renderer, &rect, SDL_PIXELFORMAT_RGBA32,
+                                          framePosition(pixels, pitch, rect.x, rect.y), pitch);
+        SDL_SetRenderTarget(renderer, nullptr);
+
+        if (result != 0) {
+            std::cerr << "Failed to read back target pixels: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        delivered = rect;
+        return true;
+    }
+
+    void collect(void*, int, SDL_Rect& delivered, bool) override { delivered = {0, 0, 0, 0}; }
+    bool hasPending() const override { return false; }
+    const char* getName() const override { return "sync"; }
+};
+
+// Pixel pack buffers with fences. GL 3.2 (or ARB_sync plus 3.0 buffer
+// mapping), loaded through SDL so nothing links against libGL. SDL's GL
+// renderer keeps its context current on the thread that uses it, and nothing
+// else draws on that thread, so calls made between SDL calls hit its context.
+class GlReadbackRing : public ReadbackRing {
+private:
+    using ReadPixelsFunction = void (APIENTRY*)(GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, void*);
+    using PixelStoreFunction = void (APIENTRY*)(GLenum, GLint);
+
+    struct Functions {
+        PFNGLGENBUFFERSPROC genBuffers;
+        PFNGLDELETEBUFFERSPROC deleteBuffers;
+        PFNGLBINDBUFFERPROC bindBuffer;
+        PFNGLBUFFERDATAPROC bufferData;
+        PFNGLMAPBUFFERRANGEPROC mapBufferRange;
+        PFNGLUNMAPBUFFERPROC unmapBuffer;
+        PFNGLFENCESYNCPROC fenceSync;
+        PFNGLCLIENTWAITSYNCPROC clientWaitSync;
+        PFNGLDELETESYNCPROC deleteSync;
+        ReadPixelsFunction readPixels;
+        PixelStoreFunction pixelStore;
+    };
+
+    struct Slot {
+        GLuint buffer;
+        GLsync fence;
+        SDL_Rect rect;
+    };
+
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+    int width, height;
+    Functions gl;
+    Slot slots[DEPTH];
+    int oldest;  // first slot in flight
+    int pending; // slots in flight
+
+    static constexpr GLuint64 WAIT_TIMEOUT_NS = 1000000000; // a wedged GPU must not hang the output
+
+    template <typename Function>
+    static bool load(Function& function, const char* name) {
+        function = reinterpret_cast<Function>(SDL_GL_GetProcAddress(name));
+        return function != nullptr;
+    }
+
+public:
+    GlReadbackRing(SDL_Renderer* targetRenderer, SDL_Texture* targetTexture, int targetWidth, int targetHeight)
+        : renderer(targetRenderer), texture(targetTexture)
+        , width(targetWidth), height(targetHeight)
+        , gl{}, slots{}, oldest(0), pending(0) {}
+
+    ~GlReadbackRing() override {
+        for (auto& slot : slots) {
+            if (slot.fence) gl.deleteSync(slot.fence);
+            if (slot.buffer) gl.deleteBuffers(1, &slot.buffer);
+        }
+    }
+
+    bool initialize() {
+        bool loaded = load(gl.genBuffers, "glGenBuffers") && load(gl.deleteBuffers, "glDeleteBuffers") &&
+                      load(gl.bindBuffer, "glBindBuffer") && load(gl.bufferData, "glBufferData") &&
+                      load(gl.mapBufferRange, "glMapBufferRange") && load(gl.unmapBuffer, "glUnmapBuffer") &&
+                      load(gl.fenceSync, "glFenceSync") && load(gl.clientWaitSync, "glClientWaitSync") &&
+                      load(gl.deleteSync, "glDeleteSync") && load(gl.readPixels, "glReadPixels") &&
+                      load(gl.pixelStore, "glPixelStorei");
+        if (!loaded) {
+            return false;
+        }
+
+        // Make sure the renderer's context is the current one, then allocate
+        // every buffer once; reads never reallocate
+        if (SDL_SetRenderTarget(renderer, texture) != 0) {
+            return false;
+        }
+        SDL_RenderFlush(renderer);
+        GLsizeiptr frameBytes = static_cast<GLsizeiptr>(width) * height * 4;
+        for (auto& slot : slots) {
+            gl.genBuffers(1, &slot.buffer);
+            gl.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            gl.bufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+        }
+        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        SDL_SetRenderTarget(renderer, nullptr);
+        return slots[DEPTH - 1].buffer != 0;
+    }
+
+    bool read(const SDL_Rect& rect, void* pixels, int pitch, SDL_Rect& delivered) override {
+        collect(pixels, pitch, delivered, false);
+        if (pending == DEPTH) {
+            // Every buffer in flight: the GPU is more than DEPTH frames behind
+            SDL_Rect waited;
+            if (deliverOldest(pixels, pitch, waited, true)) {
+                SDL_UnionRect(&delivered, &waited, &delivered);
+            } else {
+                releaseOldest(); // GPU wedged: drop that read rather than block the output
+            }
+        }
+
+        // The texture must be bound, and SDL's queued draws issued, before the read
+        if (SDL_SetRenderTarget(renderer, texture) != 0) {
+            std::cerr << "Failed to set render target for readback: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        SDL_RenderFlush(renderer);
+
+        // SDL keeps render target textures top-down, so rect needs no flip
+        Slot& slot = slots[(oldest + pending) % DEPTH];
+        size_t offset = (static_cast<size_t>(rect.y) * width + rect.x) * 4;
+        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        gl.pixelStore(GL_PACK_ALIGNMENT, 4);
+        gl.pixelStore(GL_PACK_ROW_LENGTH, width);
+        gl.readPixels(rect.x, rect.y, rect.w, rect.h, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(offset));
+        gl.pixelStore(GL_PACK_ROW_LENGTH, 0);
+        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = gl.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.rect = rect;
+        SDL_SetRenderTarget(renderer, nullptr);
+
+        if (!slot.fence) {
+            return false;
+        }
+        pending++;
+        return true;
+    }
+
+    void collect(void* pixels, int pitch, SDL_Rect& delivered, bool wait) override {
+        delivered = {0, 0, 0, 0};
+        SDL_Rect rect;
+        while (pending > 0 && deliverOldest(pixels, pitch, rect, wait)) {
+            SDL_UnionRect(&delivered, &rect, &delivered);
+        }
+    }
+
+    bool hasPending() const override { return pending > 0; }
+    const char* getName() const override { return "gl-pbo"; }
+
+private:
+    // Copy the oldest read out if the GPU is done with it (or wait for it)
+    bool deliverOldest(void* pixels, int pitch, SDL_Rect& delivered, bool wait) {
+        delivered = {0, 0, 0, 0};
+        Slot& slot = slots[oldest];
+        GLenum status = gl.clientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? WAIT_TIMEOUT_NS : 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+
+        if (status != GL_WAIT_FAILED) {
+            size_t rowBytes = static_cast<size_t>(width) * 4;
+            const SDL_Rect& rect = slot.rect;
+            gl.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            const Uint8* mapped = static_cast<const Uint8*>(gl.mapBufferRange(
+                GL_PIXEL_PACK_BUFFER, static_cast<GLintptr>(rect.y * rowBytes),
+                static_cast<GLsizeiptr>(rect.h * rowBytes), GL_MAP_READ_BIT));
+            if (mapped) {
+                for (int y = 0; y < rect.h; y++) {
+                    memcpy(framePosition(pixels, pitch, rect.x, rect.y + y), mapped + y * rowBytes + rect.x * 4,
+                           static_cast<size_t>(rect.w) * 4);
+                }
+                gl.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+                delivered = rect;
+            }
+            gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        releaseOldest();
+        return true;
+    }
+
+    void releaseOldest() {
+        Slot& slot = slots[oldest];
+        gl.deleteSync(slot.fence);
+        slot.fence = nullptr;
+        oldest = (oldest + 1) % DEPTH;
+        pending--;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<ReadbackRing> ReadbackRing::create(SDL_Renderer* renderer, SDL_Texture* texture, int width, int height) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0 && strcmp(info.name, "opengl") == 0) {
+        auto ring = std::make_unique<GlReadbackRing>(renderer, texture, width, height);
+        if (ring->initialize()) {
+            return ring;
+        }
+        std::cerr << "Warning: OpenGL pixel buffers unavailable, reading output back synchronously" << std::endl;
+    }
+    return std::make_unique<SyncReadbackRing>(renderer, texture);
+}
@@ -0,0 +1,42 @@
+#ifndef READBACK_RING_H
+#define READBACK_RING_H
+
+#include <SDL2/SDL.h>
+#include <memory>
+
+// Reads a render target texture back to memory without stalling the GPU
+// every frame. On the OpenGL renderer each read goes into one of DEPTH pixel
+// pack buffers and is fenced; it is copied out once the GPU has finished it,
+// usually one or two presents later. A read only waits when all buffers are
+// still in flight. Other renderers (software, Direct3D, Metal) offer no
+// asynchronous path through SDL and read synchronously; for the headless
+// software renderer that is a plain memory copy anyway.
+//
+// Pixels are RGBA32 (R,G,B,A bytes) and land at their position in a
+// full-frame buffer, so callers can pass damaged regions only. Create, use and
+// destroy on the thread that owns the renderer.
+class ReadbackRing {
+public:
+    static constexpr int DEPTH = 3;
+
+    virtual ~ReadbackRing() = default;
+
+    // Ring for texture on renderer (the GL one if the renderer supports it)
+    static std::unique_ptr<ReadbackRing> create(SDL_Renderer* renderer, SDL_Texture* texture, int width, int height);
+
+    // Queue a read of rect, then copy every read that has completed (oldest
+    // first) into pixels. delivered is the union of the copied regions,
+    // empty if none completed yet. False if the read could not be issued.
+    virtual bool read(const SDL_Rect& rect, void* pixels, int pitch, SDL_Rect& delivered) = 0;
+
+    // Copy completed reads without queueing a new one; wait for all of them if asked
+    virtual void collect(void* pixels, int pitch, SDL_Rect& delivered, bool wait) = 0;
+
+    // Reads queued but not yet delivered
+    virtual bool hasPending() const = 0;
+
+    // "gl-pbo" or "sync", for logging
+    virtual const char* getName() const = 0;
+};
+
+#endif // READBACK_RING_H
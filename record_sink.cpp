@@ -0,0 +1,285 @@
+#include "record_sink.h"
+#include "color_convert.h"
+#include <iostream>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+namespace {
+
+bool hasEncodedExtension(const std::string& path) {
+    static const char* const EXTENSIONS[] = {".mp4", ".mkv", ".mov", ".webm", ".avi"};
+    for (const char* extension : EXTENSIONS) {
+        size_t length = strlen(extension);
+        if (path.size() > length && path.compare(path.size() - length, length, extension) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+RecordSink::RecordSink()
+    : width(0), height(0), frameBytes(0)
+    , fd(-1), child(-1)
+    , hasFrame(false)
+    , tickInterval(std::chrono::milliseconds(33))
+    , wakeRequested(false), stopRequested(false)
+    , failed(false)
+    , framesQueued(0), repeatsQueued(0), ticksDropped(0) {
+}
+
+RecordSink::~RecordSink() {
+    close();
+}
+
+bool RecordSink::open(const std::string& destination, int frameWidth, int frameHeight, double frameRate) {
+    close();
+
+    // NV12 subsamples chroma 2x2
+    if (frameWidth <= 0 || frameHeight <= 0 || (frameWidth % 2) || (frameHeight % 2) || !(frameRate > 0)) {
+        std::cerr << "Invalid recording format: " << frameWidth << "x" << frameHeight << " at " << frameRate << " fps" << std::endl;
+        return false;
+    }
+
+    target = destination;
+    width = frameWidth;
+    height = frameHeight;
+    frameBytes = static_cast<size_t>(width) * height * 3 / 2;
+    if (!openDestination(frameRate)) {
+        close();
+        return false;
+    }
+
+    pool = std::make_unique<FramePool>(frameBytes, QUEUE_DEPTH + 3);
+    latest = FramePool::Frame(nullptr, FramePool::Recycler{pool.get()});
+    tickInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / frameRate));
+    hasFrame = false;
+    failed = false;
+    stopRequested = false;
+    framesQueued = repeatsQueued = ticksDropped = 0;
+    writerThread = std::thread(&RecordSink::writerMain, this);
+
+    std::cout << "Recording " << width << "x" << height << " NV12 at " << frameRate << " fps to " << target << std::endl;
+    return true;
+}
+
+bool RecordSink::openDestination(double frameRate) {
+    std::vector<std::string> arguments;
+    if (!target.empty() && target[0] == '|') {
+        arguments = {"/bin/sh", "-c", target.substr(1)};
+    } else if (hasEncodedExtension(target)) {
+        char size[32], rate[32];
+        snprintf(size, sizeof(size), "%dx%d", width, height);
+        snprintf(rate, sizeof(rate), "%g", frameRate);
+        arguments = {"ffmpeg", "-hide_banner", "-loglevel", "error", "-y",
+                     "-f", "rawvideo", "-pix_fmt", "nv12", "-video_size", size, "-framerate", rate,
+                     "-i", "pipe:0", "-pix_fmt", "yuv420p", target};
+    } else {
+        fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "Failed to open recording " << target << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) != 0) {
+        std::cerr << "Failed to create recording pipe: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::vector<char*> argv;
+    for (auto& argument : arguments) {
+        argv.push_back(&argument[0]);
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipeFds[0], STDIN_FILENO);
+    int result = posix_spawnp(&child, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(pipeFds[0]);
+
+    if (result != 0) {
+        std::cerr << "Failed to start " << argv[0] << " for recording: " << strerror(result) << std::endl;
+        ::close(pipeFds[1]);
+        child = -1;
+        return false;
+    }
+
+    // A recorder that exits shows up as EPIPE on the writer instead of killing us
+    signal(SIGPIPE, SIG_IGN);
+    fd = pipeFds[1];
+    return true;
+}
+
+void RecordSink::close() {
+    if (writerThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopRequested = true;
+        }
+        wakeCondition.notify_one();
+        writerThread.join();
+    }
+    latest.reset();
+
+    // Closing the pipe ends the stream; ffmpeg then finalizes the file
+    bool wasOpen = fd >= 0;
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (child > 0) {
+        int status = 0;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "Warning: Recorder for " << target << " exited abnormally" << std::endl;
+        }
+        child = -1;
+    }
+    pool.reset();
+
+    if (wasOpen) {
+        std::cout << "Recording finished: " << target << " (" << framesQueued << " frames, "
+                  << repeatsQueued << " repeats, " << ticksDropped << " dropped)" << std::endl;
+    }
+    hasFrame = false;
+}
+
+void RecordSink::pushFrame(const void* rgbaPixels, int pitch, const SDL_Rect&) {
+    if (!isOpen() || !rgbaPixels || failed.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // A frame not queued yet is simply replaced by the newer one
+    if (!latest) {
+        latest = pool->acquire();
+        if (!latest) {
+            return; // cannot happen: the pool covers every buffer in flight
+        }
+    }
+
+    uint8_t* yPlane = latest.get();
+    getColorConvertKernels().rgbaToNv12(static_cast<const uint8_t*>(rgbaPixels), pitch,
+                                        yPlane, width, yPlane + static_cast<size_t>(width) * height, width,
+                                        width, height);
+
+    if (!hasFrame) {
+        hasFrame = true;
+        nextTick = std::chrono::steady_clock::now();
+    }
+}
+
+void RecordSink::repeatFrame() {
+    if (!isOpen() || !hasFrame) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - nextTick > std::chrono::seconds(1)) {
+        // Output thread stalled (or the machine slept): skip rather than burst
+        auto missed = (now - nextTick) / tickInterval;
+        ticksDropped += static_cast<uint64_t>(missed);
+        nextTick += missed * tickInterval;
+    }
+    while (nextTick <= now) {
+        tick();
+        nextTick += tickInterval;
+    }
+}
+
+double RecordSink::getFrameRate() const {
+    return std::chrono::duration<double>(std::chrono::seconds(1)) / tickInterval;
+}
+
+std::chrono::steady_clock::time_point RecordSink::getNextRepeatTime() const {
+    if (!isOpen() || !hasFrame) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return nextTick;
+}
+
+void RecordSink::tick() {
+    if (failed.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // A new image if one arrived since the last tick, otherwise a repeat
+    Item item;
+    bool isNew = static_cast<bool>(latest);
+    if (isNew) {
+        item.frame = std::move(latest);
+    }
+
+    if (!queue.push(std::move(item))) {
+        ticksDropped++;
+        if (isNew) {
+            latest = std::move(item.frame); // goes out with the next tick that fits
+        }
+        return;
+    }
+
+    if (isNew) {
+        framesQueued++;
+    } else {
+        repeatsQueued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeRequested = true;
+    }
+    wakeCondition.notify_one();
+}
+
+void RecordSink::writerMain() {
+    FramePool::Frame last(nullptr, FramePool::Recycler{pool.get()});
+
+    while (true) {
+        Item item;
+        if (queue.pop(item)) {
+            if (item.frame) {
+                last = std::move(item.frame);
+            }
+            if (last && !failed.load(std::memory_order_relaxed) && !writeAll(last.get(), frameBytes)) {
+                std::cerr << "Recording to " << target << " failed: " << strerror(errno) << std::endl;
+                failed = true;
+            }
+            continue;
+        }
+
+        // Drain everything before honouring a stop
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        if (stopRequested) {
+            break;
+        }
+        wakeCondition.wait(lock, [this] { return wakeRequested || stopRequested; });
+        wakeRequested = false;
+    }
+}
+
+bool RecordSink::writeAll(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
@@ -0,0 +1,88 @@
+#ifndef RECORD_SINK_H
+#define RECORD_SINK_H
+
+#include <SDL2/SDL.h>
+#include <sys/types.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "frame_pool.h"
+#include "frame_sink.h"
+#include "spsc_queue.h"
+
+// Records the output as a constant frame rate NV12 stream (--record):
+//   clip.mp4 (.mkv, .mov, .webm, .avi)  encoded by an ffmpeg subprocess
+//   |<command>                          raw NV12 on the command's stdin
+//   anything else                       raw NV12 file (play with ffplay -f rawvideo)
+//
+// Frames are converted on the output thread into pooled buffers and written
+// by a writer thread through a bounded queue. Between changes a tick queues
+// a repeat, which writes the writer's last frame again without converting or
+// copying it. When the writer falls behind (slow disk, busy encoder) ticks
+// are dropped and counted instead of blocking the output; the newest image is
+// kept and goes out with the next tick that fits.
+class RecordSink : public FrameSink {
+private:
+    struct Item {
+        FramePool::Frame frame; // null: repeat the previous frame
+    };
+    static constexpr size_t QUEUE_DEPTH = 16;
+
+    std::string target;
+    int width, height;
+    size_t frameBytes;
+    int fd;
+    pid_t child; // ffmpeg or the pipe command, -1 for a file
+
+    // Output thread
+    std::unique_ptr<FramePool> pool; // queue + writer's current and last + latest
+    FramePool::Frame latest;         // newest converted frame not yet queued
+    bool hasFrame;
+    std::chrono::steady_clock::duration tickInterval;
+    std::chrono::steady_clock::time_point nextTick;
+
+    // Output thread -> writer thread
+    SpscQueue<Item, QUEUE_DEPTH> queue;
+    std::thread writerThread;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool wakeRequested;
+    bool stopRequested;
+    std::atomic<bool> failed; // write error; stop queueing
+
+    uint64_t framesQueued, repeatsQueued;
+    uint64_t ticksDropped; // constant rate ticks lost to a full queue
+
+public:
+    RecordSink();
+    ~RecordSink();
+
+    RecordSink(const RecordSink&) = delete;
+    RecordSink& operator=(const RecordSink&) = delete;
+
+    // Start recording frameWidth x frameHeight (even) frames to destination at frameRate
+    bool open(const std::string& destination, int frameWidth, int frameHeight, double frameRate);
+
+    // Write out what is queued, then end the stream (ffmpeg finishes the file)
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    void pushFrame(const void* rgbaPixels, int pitch, const SDL_Rect& dirtyRect) override;
+    void repeatFrame() override;
+    double getFrameRate() const override;
+    std::chrono::steady_clock::time_point getNextRepeatTime() const override;
+
+private:
+    bool openDestination(double frameRate);
+    void tick();
+    void queueItem(Item& item);
+    void writerMain();
+    bool writeAll(const uint8_t* data, size_t size);
+};
+
+#endif // RECORD_SINK_H
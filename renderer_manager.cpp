@@ -1,12 +1,72 @@
 #include "renderer_manager.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
+namespace {
+
+// Calls draw(texture, source, dest) for each part of image placed at destRect:
+// the whole base, or the base around the patch and then the patch. A patch
+// replaces the base pixels under it, so the base is not drawn there (its
+// semi-transparent pixels would otherwise be blended twice).
+template <typename Draw>
+void forEachImagePart(const ModelImage& image, const SDL_Rect& destRect, bool flipped, Draw draw) {
+    const TextureRegion& base = image.base;
+    SDL_Rect bounds = {0, 0, base.rect.w, base.rect.h};
+    SDL_Rect patch = {image.patchPosition.x, image.patchPosition.y, image.patch.rect.w, image.patch.rect.h};
+    if (!image.hasPatch() || !SDL_IntersectRect(&patch, &bounds, &patch)) {
+        draw(base.texture, base.rect, destRect);
+        return;
+    }
+    
+    // Parts are placed on destination edges rounded from image edges, so
+    // neighbouring parts meet exactly even while a transition scales them
+    auto place = [&](const SDL_Rect& part) {
+        int left = flipped ? base.rect.w - part.x - part.w : part.x;
+        int x0 = destRect.x + static_cast<int>(std::lround(static_cast<double>(left) * destRect.w / base.rect.w));
+        int x1 = destRect.x + static_cast<int>(std::lround(static_cast<double>(left + part.w) * destRect.w / base.rect.w));
+        int y0 = destRect.y + static_cast<int>(std::lround(static_cast<double>(part.y) * destRect.h / base.rect.h));
+        int y1 = destRect.y + static_cast<int>(std::lround(static_cast<double>(part.y + part.h) * destRect.h / base.rect.h));
+        return SDL_Rect{x0, y0, x1 - x0, y1 - y0};
+    };
+    
+    // Base above, below, left and right of the patch, then the patch
+    SDL_Rect parts[4] = {
+        {0, 0, bounds.w, patch.y},
+        {0, patch.y + patch.h, bounds.w, bounds.h - patch.y - patch.h},
+        {0, patch.y, patch.x, patch.h},
+        {patch.x + patch.w, patch.y, bounds.w - patch.x - patch.w, patch.h},
+    };
+    for (const SDL_Rect& part : parts) {
+        if (part.w > 0 && part.h > 0) {
+            draw(base.texture, SDL_Rect{base.rect.x + part.x, base.rect.y + part.y, part.w, part.h}, place(part));
+        }
+    }
+    draw(image.patch.texture, SDL_Rect{image.patch.rect.x + patch.x - image.patchPosition.x,
+                                       image.patch.rect.y + patch.y - image.patchPosition.y, patch.w, patch.h},
+         place(patch));
+}
+
+} // namespace
+
+SDL_Rect DrawTransform::apply(int areaX, int areaY, int areaWidth, int areaHeight, int w, int h) const {
+    int scaledWidth = static_cast<int>(std::lround(w * scaleX));
+    int scaledHeight = static_cast<int>(std::lround(h * scaleY));
+    
+    SDL_Rect rect;
+    rect.w = scaledWidth;
+    rect.h = scaledHeight;
+    rect.x = areaX + (areaWidth - scaledWidth) / 2 + static_cast<int>(std::lround(offsetX));
+    rect.y = areaY + (areaHeight - h) / 2 + (h - scaledHeight) + static_cast<int>(std::lround(offsetY));
+    return rect;
+}
+
 RendererManager::RendererManager() 
-    : controlTarget{nullptr, nullptr, nullptr, 0, 0, false, {}}
-    , outputTarget{nullptr, nullptr, nullptr, 0, 0, false, {}}
-    , controlNeedsRedraw(true)
-    , outputNeedsRedraw(true)
-    , lastFrameTime(std::chrono::steady_clock::now()) {
+    : controlTarget{nullptr, nullptr, nullptr, nullptr, 0, 0, false, {0, 0, 0, 0}, {}, {0, 255, 0, 255}, 0.0, false, nullptr, nullptr, false, {}, {}, {}}
+    , outputTarget{nullptr, nullptr, nullptr, nullptr, 0, 0, false, {0, 0, 0, 0}, {}, {0, 255, 0, 255}, 0.0, false, nullptr, nullptr, false, {}, {}, {}}
+    , headless(false) {
 }
 
 RendererManager::~RendererManager() {
@@ -14,12 +74,24 @@ RendererManager::~RendererManager() {
     destroyTarget(outputTarget);
 }
 
-bool RendererManager::initialize(int windowWidth, int windowHeight) {
+bool RendererManager::initialize(int windowWidth, int windowHeight, int outputWidth, int outputHeight,
+                                 bool headlessMode) {
+    headless = headlessMode;
+    outputTarget.width = outputWidth;
+    outputTarget.height = outputHeight;
+    
+    if (headless) {
+        // No control panel and no windows; output goes to sinks only
+        return true;
+    }
+    
     if (!initializeTarget(controlTarget, "ChieModel Control", windowWidth, windowHeight)) {
         return false;
     }
     
-    if (!initializeTarget(outputTarget, "ChieModel Output", windowWidth, windowHeight)) {
+    // Windows belong to the main thread; the output renderer is created by
+    // createOutputRenderer() on whichever thread draws the output
+    if (!createWindow(outputTarget, "ChieModel Output", outputWidth, outputHeight)) {
         destroyTarget(controlTarget);
         return false;
     }
@@ -27,7 +99,32 @@ bool RendererManager::initialize(int windowWidth, int windowHeight) {
     return true;
 }
 
+bool RendererManager::createOutputRenderer() {
+    if (headless) {
+        return initializeOffscreenTarget(outputTarget, outputTarget.width, outputTarget.height);
+    }
+    return createRenderer(outputTarget);
+}
+
+void RendererManager::destroyOutputRenderer() {
+    releaseRenderer(outputTarget);
+}
+
 bool RendererManager::initializeTarget(RenderTarget& target, const char* title, int width, int height) {
+    if (!createWindow(target, title, width, height)) {
+        return false;
+    }
+    
+    if (!createRenderer(target)) {
+        SDL_DestroyWindow(target.window);
+        target.window = nullptr;
+        return false;
+    }
+    
+    return true;
+}
+
+bool RendererManager::createWindow(RenderTarget& target, const char* title, int width, int height) {
     target.window = SDL_CreateWindow(title,
                                    SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
                                    width, height,
@@ -37,31 +134,93 @@ bool RendererManager::initializeTarget(RenderTarget& target, const char* title,
         return false;
     }
     
+    target.width = width;
+    target.height = height;
+    return true;
+}
+
+bool RendererManager::createRenderer(RenderTarget& target) {
     target.renderer = SDL_CreateRenderer(target.window, -1, 
                                         SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (!target.renderer) {
         std::cerr << "Failed to create renderer: " << SDL_GetError() << std::endl;
-        SDL_DestroyWindow(target.window);
-        target.window = nullptr;
+        return false;
+    }
+    
+    // Frame pacing follows the display the window opened on; drivers may
+    // silently ignore the vsync request
+    SDL_RendererInfo info;
+    target.vsync = SDL_GetRendererInfo(target.renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+    SDL_DisplayMode mode;
+    target.refreshRate = (SDL_GetWindowDisplayMode(target.window, &mode) == 0 && mode.refresh_rate > 0)
+                         ? mode.refresh_rate : 0.0;
+    
+    target.dirty = true;
+    target.dirtyRect = {0, 0, target.width, target.height};
+    target.lastUpdate = std::chrono::steady_clock::now();
+    
+    if (!createBackbuffer(target)) {
+        SDL_DestroyRenderer(target.renderer);
+        target.renderer = nullptr;
+        return false;
+    }
+    
+    return true;
+}
+
+bool RendererManager::initializeOffscreenTarget(RenderTarget& target, int width, int height) {
+    // Software renderer drawing into a plain surface: no window, no vsync, no GPU memory
+    target.surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!target.surface) {
+        std::cerr << "Failed to create offscreen surface: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    
+    target.renderer = SDL_CreateSoftwareRenderer(target.surface);
+    if (!target.renderer) {
+        std::cerr << "Failed to create software renderer: " << SDL_GetError() << std::endl;
+        SDL_FreeSurface(target.surface);
+        target.surface = nullptr;
         return false;
     }
     
     target.width = width;
     target.height = height;
-    target.needsUpdate = true;
+    target.refreshRate = 0.0;
+    target.vsync = false;
+    target.dirty = true;
+    target.dirtyRect = {0, 0, width, height};
     target.lastUpdate = std::chrono::steady_clock::now();
     
+    // SIMD compositing straight into the surface beats SDL's generic software
+    // blits; CHIEMODEL_COMPOSITOR=sdl keeps the software renderer for comparison
+    const char* compositor = std::getenv("CHIEMODEL_COMPOSITOR");
+    if (!compositor || std::strcmp(compositor, "sdl") != 0) {
+        target.compositor = std::make_unique<CpuCompositor>();
+        std::cout << "Output compositor: " << target.compositor->getKernelName() << ", up to "
+                  << target.compositor->getMaxBands() << " row bands" << std::endl;
+        return true;
+    }
+    
+    if (!createBackbuffer(target)) {
+        SDL_DestroyRenderer(target.renderer);
+        SDL_FreeSurface(target.surface);
+        target.renderer = nullptr;
+        target.surface = nullptr;
+        return false;
+    }
+    
+    return true;
+}
+
+bool RendererManager::createBackbuffer(RenderTarget& target) {
     // Create backbuffer for double buffering
     target.backbuffer = SDL_CreateTexture(target.renderer, 
                                          SDL_PIXELFORMAT_RGBA8888,
                                          SDL_TEXTUREACCESS_TARGET,
-                                         width, height);
+                                         target.width, target.height);
     if (!target.backbuffer) {
         std::cerr << "Failed to create backbuffer: " << SDL_GetError() << std::endl;
-        SDL_DestroyRenderer(target.renderer);
-        SDL_DestroyWindow(target.window);
-        target.renderer = nullptr;
-        target.window = nullptr;
         return false;
     }
     
@@ -69,51 +228,93 @@ bool RendererManager::initializeTarget(RenderTarget& target, const char* title,
 }
 
 void RendererManager::destroyTarget(RenderTarget& target) {
+    releaseRenderer(target);
+    
+    if (target.window) {
+        SDL_DestroyWindow(target.window);
+        target.window = nullptr;
+    }
+}
+
+void RendererManager::releaseRenderer(RenderTarget& target) {
+    // Reads still in flight are dropped with their buffers
+    target.readback.reset();
+    target.compositor.reset();
+    target.geometryFailed = false;
+    
     if (target.backbuffer) {
         SDL_DestroyTexture(target.backbuffer);
         target.backbuffer = nullptr;
     }
     
     if (target.renderer) {
+        if (rendererDestroyedCallback) {
+            rendererDestroyedCallback(target.renderer);
+        }
         SDL_DestroyRenderer(target.renderer);
         target.renderer = nullptr;
     }
     
-    if (target.window) {
-        SDL_DestroyWindow(target.window);
-        target.window = nullptr;
+    if (target.surface) {
+        SDL_FreeSurface(target.surface);
+        target.surface = nullptr;
     }
 }
 
-void RendererManager::present() {
-    auto now = std::chrono::steady_clock::now();
+void RendererManager::invalidate(RenderTarget* target) {
+    if (!target) return;
+    invalidate(target, {0, 0, target->width, target->height});
+}
+
+void RendererManager::invalidate(RenderTarget* target, const SDL_Rect& rect) {
+    if (!target || rect.w <= 0 || rect.h <= 0) {
+        return;
+    }
     
-    if (controlNeedsRedraw) {
-        SDL_RenderPresent(controlTarget.renderer);
-        controlNeedsRedraw = false;
-        controlTarget.lastUpdate = now;
+    SDL_Rect bounds = {0, 0, target->width, target->height};
+    SDL_Rect clipped;
+    if (!SDL_IntersectRect(&rect, &bounds, &clipped)) {
+        return;
     }
     
-    if (outputNeedsRedraw) {
-        SDL_RenderPresent(outputTarget.renderer);
-        outputNeedsRedraw = false;
-        outputTarget.lastUpdate = now;
+    if (target->dirty) {
+        SDL_UnionRect(&target->dirtyRect, &clipped, &target->dirtyRect);
+    } else {
+        target->dirtyRect = clipped;
+        target->dirty = true;
     }
 }
 
-void RendererManager::waitForNextFrame() {
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastFrameTime);
+RendererManager::RenderTarget* RendererManager::getTargetForWindowEvent(const SDL_WindowEvent& event) {
+    if (event.event != SDL_WINDOWEVENT_EXPOSED && event.event != SDL_WINDOWEVENT_SIZE_CHANGED) {
+        return nullptr;
+    }
     
-    if (elapsed < frameInterval) {
-        SDL_Delay(static_cast<Uint32>((frameInterval - elapsed).count()));
+    for (RenderTarget* target : {&controlTarget, &outputTarget}) {
+        if (target->window && SDL_GetWindowID(target->window) == event.windowID) {
+            return target;
+        }
+    }
+    return nullptr;
+}
+
+void RendererManager::present(RenderTarget* target) {
+    if (!target || !target->dirty || !target->renderer) {
+        return;
     }
     
-    lastFrameTime = std::chrono::steady_clock::now();
+    SDL_RenderPresent(target->renderer);
+    target->dirty = false;
+    target->lastUpdate = std::chrono::steady_clock::now();
 }
 
-void RendererManager::renderTextureToTarget(RenderTarget* target, SDL_Texture* texture, bool flipped) {
-    if (!target || !target->renderer || !texture) {
+void RendererManager::renderSceneToTarget(RenderTarget* target, const SceneImage* images, int count) {
+    if (!target || !target->renderer) {
+        return;
+    }
+    
+    if (target->compositor) {
+        composeOnCpu(target, images, count);
         return;
     }
     
@@ -123,40 +324,147 @@ void RendererManager::renderTextureToTarget(RenderTarget* target, SDL_Texture* t
         return;
     }
     
-    // Clear with green background
-    SDL_SetRenderDrawColor(target->renderer, 0, 255, 0, 255);
-    SDL_RenderClear(target->renderer);
-    
-    // Get texture dimensions
-    int texWidth, texHeight;
-    SDL_QueryTexture(texture, nullptr, nullptr, &texWidth, &texHeight);
+    // The backbuffer keeps its contents: only repaint the damaged region.
+    // (SDL_RenderClear ignores the clip rect, so fill the region instead.)
+    SDL_Rect region = target->dirty ? target->dirtyRect : SDL_Rect{0, 0, target->width, target->height};
+    SDL_RenderSetClipRect(target->renderer, &region);
     
-    // Calculate position to center the texture
-    SDL_Rect destRect;
-    destRect.w = texWidth;
-    destRect.h = texHeight;
-    destRect.x = (target->width - texWidth) / 2;
-    destRect.y = (target->height - texHeight) / 2;
+    // Replace (not blend) so a transparent background really clears to alpha 0
+    const SDL_Color& background = target->background;
+    SDL_SetRenderDrawBlendMode(target->renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(target->renderer, background.r, background.g, background.b, background.a);
+    SDL_RenderFillRect(target->renderer, &region);
     
-    // Render with optional flip
-    if (flipped) {
-        SDL_RenderCopyEx(target->renderer, texture, nullptr, &destRect, 0, nullptr, SDL_FLIP_HORIZONTAL);
-    } else {
-        SDL_RenderCopy(target->renderer, texture, nullptr, &destRect);
+    if (!target->geometryFailed && !drawBatched(target, images, count, region)) {
+        // Part of the batch may be drawn: start the region over, one copy per part
+        std::cerr << "Warning: Batched drawing failed (" << SDL_GetError() << "), drawing images one by one" << std::endl;
+        target->geometryFailed = true;
+        SDL_RenderFillRect(target->renderer, &region);
+    }
+    if (target->geometryFailed) {
+        for (int i = 0; i < count; i++) {
+            if (images[i].image.isValid() && SDL_HasIntersection(&images[i].destRect, &region)) {
+                drawImage(target->renderer, images[i].image, images[i].destRect, images[i].flipped);
+            }
+        }
     }
     
     // Reset render target
+    SDL_RenderSetClipRect(target->renderer, nullptr);
     SDL_SetRenderTarget(target->renderer, nullptr);
     
-    // Copy backbuffer to screen
+    // Copy backbuffer to screen (window contents are undefined after a present)
     SDL_RenderCopy(target->renderer, target->backbuffer, nullptr, nullptr);
+}
+
+bool RendererManager::drawBatched(RenderTarget* target, const SceneImage* images, int count, const SDL_Rect& region) {
+    // Parts are queued as textured quads (two triangles each) and sent as one
+    // draw per run of parts from the same atlas texture; painter's order is
+    // kept, so overlapping avatars still stack correctly
+    std::vector<SDL_Vertex>& vertices = target->vertices;
+    std::vector<int>& indices = target->indices;
+    vertices.clear();
+    indices.clear();
     
-    // Mark as updated
-    if (target == &controlTarget) {
-        controlNeedsRedraw = true;
-    } else if (target == &outputTarget) {
-        outputNeedsRedraw = true;
+    SDL_Texture* batchTexture = nullptr;
+    float textureWidth = 1.0f, textureHeight = 1.0f;
+    bool drawn = true;
+    auto flush = [&]() {
+        if (!vertices.empty()) {
+            drawn = SDL_RenderGeometry(target->renderer, batchTexture, vertices.data(), static_cast<int>(vertices.size()),
+                                       indices.data(), static_cast<int>(indices.size())) == 0 && drawn;
+            vertices.clear();
+            indices.clear();
+        }
+    };
+    
+    const SDL_Color white = {255, 255, 255, 255};
+    for (int i = 0; i < count && drawn; i++) {
+        const SceneImage& scene = images[i];
+        if (!scene.image.isValid() || !SDL_HasIntersection(&scene.destRect, &region)) {
+            continue;
+        }
+        
+        forEachImagePart(scene.image, scene.destRect, scene.flipped,
+                         [&](SDL_Texture* texture, const SDL_Rect& source, const SDL_Rect& dest) {
+            if (texture != batchTexture) {
+                flush();
+                batchTexture = texture;
+                int w = 1, h = 1;
+                SDL_QueryTexture(texture, nullptr, nullptr, &w, &h);
+                textureWidth = static_cast<float>(w);
+                textureHeight = static_cast<float>(h);
+            }
+            
+            float u0 = source.x / textureWidth, u1 = (source.x + source.w) / textureWidth;
+            float v0 = source.y / textureHeight, v1 = (source.y + source.h) / textureHeight;
+            if (scene.flipped) {
+                std::swap(u0, u1);
+            }
+            float x0 = static_cast<float>(dest.x), x1 = static_cast<float>(dest.x + dest.w);
+            float y0 = static_cast<float>(dest.y), y1 = static_cast<float>(dest.y + dest.h);
+            
+            int first = static_cast<int>(vertices.size());
+            vertices.push_back({{x0, y0}, white, {u0, v0}});
+            vertices.push_back({{x1, y0}, white, {u1, v0}});
+            vertices.push_back({{x1, y1}, white, {u1, v1}});
+            vertices.push_back({{x0, y1}, white, {u0, v1}});
+            for (int corner : {0, 1, 2, 0, 2, 3}) {
+                indices.push_back(first + corner);
+            }
+        });
     }
+    flush();
+    return drawn;
+}
+
+void RendererManager::drawImage(SDL_Renderer* renderer, const ModelImage& image, const SDL_Rect& destRect,
+                                bool flipped) {
+    forEachImagePart(image, destRect, flipped, [&](SDL_Texture* texture, const SDL_Rect& source, const SDL_Rect& dest) {
+        if (flipped) {
+            SDL_RenderCopyEx(renderer, texture, &source, &dest, 0, nullptr, SDL_FLIP_HORIZONTAL);
+        } else {
+            SDL_RenderCopy(renderer, texture, &source, &dest);
+        }
+    });
+}
+
+void RendererManager::composeOnCpu(RenderTarget* target, const SceneImage* images, int count) {
+    // Same damage handling and placement as the renderer path; images come from a CPU atlas page
+    SDL_Rect region = target->dirty ? target->dirtyRect : SDL_Rect{0, 0, target->width, target->height};
+    const SDL_Color& background = target->background;
+    Uint32 fill = SDL_MapRGBA(target->surface->format, background.r, background.g, background.b, background.a);
+    
+    std::vector<CompositeLayer>& layers = target->layers;
+    layers.clear();
+    for (int i = 0; i < count; i++) {
+        const ModelImage& image = images[i].image;
+        const TextureRegion& base = image.base;
+        if (!base.pixels || !SDL_HasIntersection(&images[i].destRect, &region)) {
+            continue;
+        }
+        
+        CompositeLayer layer = {{base.pixels, base.pitch, base.rect.w, base.rect.h}, images[i].destRect, images[i].flipped};
+        if (image.hasPatch()) {
+            const TextureRegion& patch = image.patch;
+            layer.image.patchPixels = patch.pixels;
+            layer.image.patchPitch = patch.pitch;
+            layer.image.patchRect = {image.patchPosition.x, image.patchPosition.y, patch.rect.w, patch.rect.h};
+        }
+        layers.push_back(layer);
+    }
+    target->compositor->compose(static_cast<uint32_t*>(target->surface->pixels), target->surface->pitch,
+                                target->width, target->height, region, fill,
+                                layers.data(), static_cast<int>(layers.size()));
+}
+
+void RendererManager::setBackgroundColor(RenderTarget* target, const SDL_Color& color) {
+    if (!target) {
+        return;
+    }
+    
+    target->background = color;
+    invalidate(target);
 }
 
 void RendererManager::clearTarget(RenderTarget* target, const SDL_Color& color) {
@@ -164,12 +472,54 @@ void RendererManager::clearTarget(RenderTarget* target, const SDL_Color& color)
         return;
     }
     
+    if (target->compositor) {
+        SDL_FillRect(target->surface, nullptr, SDL_MapRGBA(target->surface->format, color.r, color.g, color.b, color.a));
+        return;
+    }
+    
     SDL_SetRenderDrawColor(target->renderer, color.r, color.g, color.b, color.a);
     SDL_RenderClear(target->renderer);
+}
+
+bool RendererManager::readTargetPixels(RenderTarget* target, void* pixels, int pitch, const SDL_Rect& rect,
+                                       SDL_Rect& delivered) {
+    delivered = {0, 0, 0, 0};
+    if (target && target->compositor && pixels) {
+        return copySurfacePixels(target, pixels, pitch, rect, delivered);
+    }
+    if (!target || !target->renderer || !target->backbuffer || !pixels) {
+        return false;
+    }
+    
+    if (!target->readback) {
+        target->readback = ReadbackRing::create(target->renderer, target->backbuffer, target->width, target->height);
+        std::cout << "Output readback: " << target->readback->getName() << std::endl;
+    }
+    return target->readback->read(rect, pixels, pitch, delivered);
+}
+
+void RendererManager::collectTargetPixels(RenderTarget* target, void* pixels, int pitch, SDL_Rect& delivered) {
+    delivered = {0, 0, 0, 0};
+    if (target && target->readback && pixels) {
+        target->readback->collect(pixels, pitch, delivered, false);
+    }
+}
+
+bool RendererManager::copySurfacePixels(RenderTarget* target, void* pixels, int pitch, const SDL_Rect& rect,
+                                        SDL_Rect& delivered) {
+    // Composited on the CPU: the frame is already in memory, nothing to wait for
+    SDL_Rect bounds = {0, 0, target->width, target->height};
+    if (!SDL_IntersectRect(&rect, &bounds, &delivered)) {
+        delivered = {0, 0, 0, 0};
+        return true;
+    }
     
-    if (target == &controlTarget) {
-        controlNeedsRedraw = true;
-    } else if (target == &outputTarget) {
-        outputNeedsRedraw = true;
+    const SDL_Surface* surface = target->surface;
+    size_t rowBytes = static_cast<size_t>(delivered.w) * 4;
+    for (int y = delivered.y; y < delivered.y + delivered.h; y++) {
+        std::memcpy(static_cast<Uint8*>(pixels) + static_cast<size_t>(y) * pitch + delivered.x * 4,
+                    static_cast<const Uint8*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch + delivered.x * 4,
+                    rowBytes);
     }
-}
\ No newline at end of file
+    return true;
+}
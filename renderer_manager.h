@@ -4,6 +4,36 @@
 #include <SDL2/SDL.h>
 #include <memory>
 #include <chrono>
+#include <functional>
+#include <vector>
+
+#include "compositor.h"
+#include "readback_ring.h"
+#include "texture_atlas.h"
+
+// Placement applied at draw time relative to the centered image (pose transitions).
+// Scaling keeps the bottom edge in place so squash and stretch stays grounded.
+struct DrawTransform {
+    float offsetX = 0.0f;
+    float offsetY = 0.0f; // negative moves up
+    float scaleX = 1.0f;
+    float scaleY = 1.0f;
+    
+    bool operator==(const DrawTransform& other) const {
+        return offsetX == other.offsetX && offsetY == other.offsetY &&
+               scaleX == other.scaleX && scaleY == other.scaleY;
+    }
+    
+    // Destination for an image of w x h centered in an area of areaWidth x areaHeight at (areaX, areaY)
+    SDL_Rect apply(int areaX, int areaY, int areaWidth, int areaHeight, int w, int h) const;
+};
+
+// One image of an output scene and where it is drawn
+struct SceneImage {
+    ModelImage image;
+    SDL_Rect destRect;
+    bool flipped;
+};
 
 class RendererManager {
 public:
@@ -11,58 +41,123 @@ public:
         SDL_Window* window;
         SDL_Renderer* renderer;
         SDL_Texture* backbuffer;
+        SDL_Surface* surface; // offscreen pixels for headless targets
         int width, height;
-        bool needsUpdate;
+        bool dirty;          // something changed since the last present
+        SDL_Rect dirtyRect;  // bounding box of the changes, in target pixels
         std::chrono::steady_clock::time_point lastUpdate;
+        SDL_Color background; // fill behind the image; alpha 0 for a transparent output
+        double refreshRate;   // Hz of the window's display, 0 if unknown or offscreen
+        bool vsync;           // presents block until the next vblank
+        std::unique_ptr<ReadbackRing> readback; // created on the first readback
+        std::unique_ptr<CpuCompositor> compositor; // headless: draws into surface directly, no backbuffer
+        bool geometryFailed;  // SDL_RenderGeometry unsupported: scenes are drawn one copy per part
+        
+        // Scene scratch, reused so steady frames allocate nothing
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+        std::vector<CompositeLayer> layers;
     };
 
 private:
     RenderTarget controlTarget;
     RenderTarget outputTarget;
     
-    // Performance optimization: only render when state changes
-    bool controlNeedsRedraw;
-    bool outputNeedsRedraw;
+    // Headless: no windows, output renders into an offscreen software target
+    bool headless;
     
-    // Frame rate limiting
-    std::chrono::steady_clock::time_point lastFrameTime;
-    const std::chrono::milliseconds frameInterval{16}; // ~60 FPS
+    // Called before a renderer is destroyed so textures created on it are released first
+    std::function<void(SDL_Renderer*)> rendererDestroyedCallback;
     
 public:
     RendererManager();
     ~RendererManager();
     
-    // Initialize both renderers
-    bool initialize(int windowWidth, int windowHeight);
+    // Create the windows and the control renderer (headless: neither). The
+    // output renderer is created separately, on the thread that draws it.
+    bool initialize(int windowWidth, int windowHeight, int outputWidth, int outputHeight,
+                    bool headlessMode = false);
+    
+    // Output renderer (offscreen software renderer when headless). Create, use and
+    // destroy it on one thread; it may differ from the thread that created the window.
+    bool createOutputRenderer();
+    void destroyOutputRenderer();
+    
+    // Register owner of renderer textures (e.g. ResourceManager::clearRendererCache)
+    void setRendererDestroyedCallback(std::function<void(SDL_Renderer*)> callback) {
+        rendererDestroyedCallback = std::move(callback);
+    }
     
     // Get render targets
     RenderTarget* getControlTarget() { return &controlTarget; }
     RenderTarget* getOutputTarget() { return &outputTarget; }
     
-    // Mark render targets as needing update
-    void markControlNeedsRedraw() { controlNeedsRedraw = true; }
-    void markOutputNeedsRedraw() { outputNeedsRedraw = true; }
+    // Damage tracking: add a region (or the whole target) to what must be redrawn
+    void invalidate(RenderTarget* target);
+    void invalidate(RenderTarget* target, const SDL_Rect& rect);
+    bool isDirty(const RenderTarget* target) const { return target && target->dirty; }
+    
+    // Target whose window was exposed or resized by this event, nullptr otherwise
+    RenderTarget* getTargetForWindowEvent(const SDL_WindowEvent& event);
+    
+    // Present target if it is dirty and mark it clean
+    void present(RenderTarget* target);
     
-    // Present renderers (only if needed)
-    void present();
+    // Redraw the dirty region of the target's backbuffer with the scene's
+    // images (atlas sub-rects) in order, then copy the backbuffer to the
+    // window. Images outside the region are skipped; the rest go out as one
+    // SDL_RenderGeometry batch per atlas texture, so many avatars cost about
+    // as many draw calls as one. Over a transparent background the result
+    // has premultiplied alpha. Targets with a CpuCompositor draw from atlases
+    // with CPU pages (hasCpuCompositor).
+    void renderSceneToTarget(RenderTarget* target, const SceneImage* images, int count);
     
-    // Frame rate limiting
-    void waitForNextFrame();
+    // Draw image scaled into destRect on renderer's current target. A patch
+    // replaces the base pixels under it: the base is drawn around the patch,
+    // not under it, so semi-transparent pixels are not blended twice.
+    static void drawImage(SDL_Renderer* renderer, const ModelImage& image, const SDL_Rect& destRect, bool flipped);
     
-    // Render texture to target
-    void renderTextureToTarget(RenderTarget* target, SDL_Texture* texture, bool flipped = false);
+    // Fill used behind the image from the next draw on (repaints the whole target)
+    void setBackgroundColor(RenderTarget* target, const SDL_Color& color);
     
     // Clear target
     void clearTarget(RenderTarget* target, const SDL_Color& color);
     
+    // Read back the target's backbuffer as RGBA32 for CPU consumers (frame
+    // sinks) without stalling the GPU where the renderer allows (ReadbackRing).
+    // Queues a read of rect and copies the reads that have completed since,
+    // each into its position in the full-frame pixels; delivered is their
+    // union, often a frame or two behind rect and empty at first.
+    bool readTargetPixels(RenderTarget* target, void* pixels, int pitch, const SDL_Rect& rect, SDL_Rect& delivered);
+    
+    // Copy reads that completed since the last call (while nothing is drawn)
+    void collectTargetPixels(RenderTarget* target, void* pixels, int pitch, SDL_Rect& delivered);
+    bool hasPendingReadback(const RenderTarget* target) const {
+        return target && target->readback && target->readback->hasPending();
+    }
+    
     // Check if windows are valid
     bool isValid() const {
-        return controlTarget.window && outputTarget.window &&
-               controlTarget.renderer && outputTarget.renderer;
+        if (headless) {
+            return true;
+        }
+        return controlTarget.window && outputTarget.window && controlTarget.renderer;
     }
     
+    bool isHeadless() const { return headless; }
+    bool hasCpuCompositor(const RenderTarget* target) const { return target && target->compositor; }
+    bool hasControlTarget() const { return controlTarget.renderer != nullptr; }
+    
 private:
     bool initializeTarget(RenderTarget& target, const char* title, int width, int height);
+    bool initializeOffscreenTarget(RenderTarget& target, int width, int height);
+    bool createWindow(RenderTarget& target, const char* title, int width, int height);
+    bool createRenderer(RenderTarget& target);
+    bool createBackbuffer(RenderTarget& target);
+    void composeOnCpu(RenderTarget* target, const SceneImage* images, int count);
+    bool drawBatched(RenderTarget* target, const SceneImage* images, int count, const SDL_Rect& region);
+    bool copySurfacePixels(RenderTarget* target, void* pixels, int pitch, const SDL_Rect& rect, SDL_Rect& delivered);
+    void releaseRenderer(RenderTarget& target);
     void destroyTarget(RenderTarget& target);
 };
 
@@ -1,196 +1,825 @@
 #include "resource_manager.h"
+#include "asset_manifest.h"
+#include "image_scaler.h"
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
 #include <SDL2/SDL.h>
 
+namespace {
+
+// Run task(i) for i in [0, count) on up to one thread per core
+unsigned parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(count, 1)));
+    
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            task(i);
+        }
+    };
+    
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return threads;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Smallest atlas page under a memory budget: the shown image, its blink frame
+// and both poses of a transition
+constexpr int MIN_BUDGET_ATLAS_IMAGES = 4;
+
+} // namespace
+
 ResourceManager::ResourceManager() : textureCacheHits(0), textureCacheMisses(0) {
+    images.reserve(manifest::SLOT_COUNT);
+    for (const auto& pose : manifest::POSES) {
+        for (int expression = 1; expression <= manifest::MAX_EXPRESSIONS; expression++) {
+            images.push_back({{pose.id, expression}, nullptr, false, 0});
+        }
+    }
 }
 
 ResourceManager::~ResourceManager() {
-    // Clear texture cache
-    for (auto& pair : textureCache) {
-        SDL_DestroyTexture(pair.second);
-    }
-    textureCache.clear();
+    // Atlases destroy their textures; stop watching and decoding before the source goes
+    watcher.reset();
+    atlases.clear();
+    loader.reset();
 }
 
 bool ResourceManager::initialize(const std::string& modelDir) {
-    modelDirectory = modelDir;
-    
     // Check if directory exists
     if (!std::filesystem::exists(modelDir)) {
         std::cerr << "Model directory does not exist: " << modelDir << std::endl;
         return false;
     }
     
-    // Preload commonly used images
-    preloadCommonImages();
+    return initialize(std::make_unique<FilesystemAssetSource>(modelDir));
+}
+
+bool ResourceManager::initialize(std::unique_ptr<AssetSource> source) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (!source) {
+        return false;
+    }
+    
+    assetSource = std::move(source);
+    std::cout << "Loading model images from " << assetSource->describe() << std::endl;
+    
+    // Nothing is decoded here; callers prefetch what they will show
+    resolvePatches();
+    loader = std::make_unique<AssetLoader>(assetSource.get());
+    loader->setCompletionCallback([this]() {
+        if (loadedCallback) {
+            loadedCallback();
+        }
+    });
     
     return true;
 }
 
-void ResourceManager::preloadCommonImages() {
-    // Preload pose 1 expressions (most commonly used)
-    for (int expression = 1; expression <= 4; expression++) {
-        loadImage(1, expression);
+void ResourceManager::setMemoryBudget(size_t bytes) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    memoryBudget = bytes;
+    enforceBudget();
+}
+
+bool ResourceManager::warmStart(const std::vector<std::pair<int, int>>& priority) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (!assetSource) {
+        return false;
+    }
+    
+    auto phaseStart = std::chrono::steady_clock::now();
+    std::vector<std::pair<int, int>> listing;
+    std::vector<int> ids;
+    for (const auto& image : assetSource->listImages()) {
+        int id = getImageId(image.first, image.second);
+        if (!images[id].loaded) {
+            listing.push_back(image);
+            ids.push_back(id);
+        }
+    }
+    double enumerateTime = millisecondsSince(phaseStart);
+    
+    // Sources are safe to call concurrently for different images
+    phaseStart = std::chrono::steady_clock::now();
+    std::vector<SDL_Surface*> surfaces(listing.size(), nullptr);
+    unsigned threads = parallelFor(listing.size(), [&](size_t i) {
+        surfaces[i] = assetSource->loadSurface(listing[i].first, listing[i].second);
+    });
+    double decodeTime = millisecondsSince(phaseStart);
+    
+    // Convert once here instead of once per renderer atlas
+    phaseStart = std::chrono::steady_clock::now();
+    parallelFor(surfaces.size(), [&](size_t i) {
+        if (surfaces[i] && surfaces[i]->format->format != TextureAtlas::PIXEL_FORMAT) {
+            SDL_Surface* converted = SDL_ConvertSurfaceFormat(surfaces[i], TextureAtlas::PIXEL_FORMAT, 0);
+            if (converted) {
+                SDL_FreeSurface(surfaces[i]);
+                surfaces[i] = converted;
+            }
+        }
+    });
+    double convertTime = millisecondsSince(phaseStart);
+    
+    // One batch handoff
+    int loaded = 0;
+    for (size_t i = 0; i < listing.size(); i++) {
+        loaded += surfaces[i] ? 1 : 0;
+        storeImage(ids[i], surfaces[i]);
+    }
+    
+    std::cout << "Warm start: " << loaded << "/" << listing.size() << " images, enumerate "
+              << enumerateTime << " ms, decode " << decodeTime << " ms (" << threads << " threads), convert "
+              << convertTime << " ms" << std::endl;
+    
+    // Nothing has been looked up yet, so every lastUse is 0 and the budget
+    // would evict in slot order, startup image first. Rank the priority list
+    // newest (first entry last), each patch's base just above the patch.
+    for (auto it = priority.rbegin(); it != priority.rend(); ++it) {
+        int id = getImageId(it->first, it->second);
+        touch(id);
+        if (images[id].baseId >= 0) {
+            touch(images[id].baseId);
+        }
+    }
+    enforceBudget();
+    return loaded == static_cast<int>(listing.size());
+}
+
+void ResourceManager::prefetch(const std::vector<std::pair<int, int>>& imageIds) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (!loader) {
+        return;
+    }
+    
+    for (const auto& image : imageIds) {
+        int id = getImageId(image.first, image.second);
+        int baseId = images[id].baseId;
+        if (baseId >= 0 && !images[baseId].loaded) {
+            // A patch is drawn over its base, so the base is needed first
+            const ImageKey& base = images[baseId].key;
+            loader->request({base.pose, base.expression});
+        }
+        if (!images[id].loaded) {
+            loader->request(image);
+        }
+    }
+}
+
+void ResourceManager::resolvePatches() {
+    int patches = 0;
+    for (const auto& image : assetSource->listImages()) {
+        AssetSource::Patch patch;
+        if (!assetSource->getPatch(image.first, image.second, patch)) {
+            continue;
+        }
+        int id = getImageId(image.first, image.second);
+        images[id].baseId = getImageId(image.first, patch.baseExpression);
+        images[id].patchRect = patch.rect;
+        patches++;
+    }
+    if (patches > 0) {
+        std::cout << patches << " expression(s) stored as face patches" << std::endl;
+    }
+}
+
+int ResourceManager::getImageId(int pose, int expression) {
+    int slot = manifest::slotOf(pose, expression);
+    if (slot >= 0) {
+        return slot;
     }
-    std::cout << "Preloaded commonly used images" << std::endl;
+    
+    auto it = extraIds.find({pose, expression});
+    if (it != extraIds.end()) {
+        return it->second;
+    }
+    
+    int id = static_cast<int>(images.size());
+    images.push_back({{pose, expression}, nullptr, false, 0});
+    extraIds.emplace(ImageKey{pose, expression}, id);
+    return id;
 }
 
-std::unique_ptr<SDL_Surface, void(*)(SDL_Surface*)>& ResourceManager::loadImage(int pose, int expression) {
-    ImageKey key = {pose, expression};
+ResourceManager::ImageSlot& ResourceManager::loadImage(int id) {
+    if (images[id].loaded) {
+        return images[id]; // Already loaded
+    }
+    
+    // Prefetched: take the worker's result (waiting if it is mid-decode)
+    ImageKey key = images[id].key;
+    if (loader && loader->finish({key.pose, key.expression})) {
+        collectLoadedImages();
+        if (images[id].loaded) {
+            return images[id];
+        }
+    }
+    
+    storeImage(id, assetSource ? assetSource->loadSurface(key.pose, key.expression) : nullptr);
+    return images[id];
+}
 
-    // Check if already loaded
-    auto it = images.find(key);
-    if (it != images.end()) {
-        return it->second; // Already loaded
+ResourceManager::RendererAtlas* ResourceManager::findAtlas(SDL_Renderer* renderer) {
+    for (auto& entry : atlases) {
+        if (entry.renderer == renderer) {
+            return &entry;
+        }
     }
+    return nullptr;
+}
 
-    std::string filename = std::to_string(pose) + "-" + std::to_string(expression) + ".png";
-    std::string fullPath = modelDirectory + "/" + filename;
+void ResourceManager::collectLoadedImages() {
+    if (!loader) {
+        return;
+    }
+    
+    std::vector<AssetLoader::LoadedImage> loaded;
+    loader->takeCompleted(loaded);
+    for (const auto& image : loaded) {
+        storeImage(getImageId(image.key.first, image.key.second), image.surface);
+    }
+}
 
-    SDL_Surface* surface = nullptr;
+void ResourceManager::storeImage(int id, SDL_Surface* surface) {
+    SurfacePtr ptr(surface);
+    ImageSlot& slot = images[id];
+    if (slot.loaded) {
+        return; // loaded twice (synchronous miss raced a prefetch); keep the first
+    }
+    
+    setSurface(slot, std::move(ptr));
+    slot.loaded = true;
+    if (surface) {
+        for (auto& entry : atlases) {
+            entry.pendingUploads.push_back(id);
+        }
+    }
+}
 
-    if (std::filesystem::exists(fullPath)) {
-        surface = IMG_Load(fullPath.c_str());
+bool ResourceManager::watchForChanges() {
+    std::string directory;
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        if (watcher) {
+            return true;
+        }
+        directory = assetSource ? assetSource->getWatchDirectory() : std::string();
+    }
+    if (directory.empty()) {
+        return false;
+    }
+    
+    // Not under the lock: the watch thread takes it, and stopping joins that thread
+    auto fileWatcher = std::make_unique<FileWatcher>(directory);
+    fileWatcher->setChangeCallback([this](const std::vector<std::string>& names) {
+        reloadFiles(names);
+    });
+    if (!fileWatcher->start()) {
+        return false;
+    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    watcher = std::move(fileWatcher);
+    return true;
+}
+
+void ResourceManager::reloadFiles(const std::vector<std::string>& names) {
+    // Only images already decoded or uploaded; the rest read the new file when first needed
+    std::vector<std::pair<int, int>> keys;
+    std::vector<float> scales;
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        for (const auto& name : names) {
+            int pose, expression;
+            if (!AssetSource::parseImageName(name, pose, expression)) {
+                continue;
+            }
+            int id = getImageId(pose, expression);
+            bool inAtlas = std::any_of(atlases.begin(), atlases.end(), [id](const RendererAtlas& entry) {
+                return entry.atlas->find(id).isValid();
+            });
+            if (images[id].loaded || inAtlas) {
+                keys.emplace_back(pose, expression);
+            }
+        }
+        for (const auto& entry : atlases) {
+            if (entry.scale != 1.0f && std::find(scales.begin(), scales.end(), entry.scale) == scales.end()) {
+                scales.push_back(entry.scale);
+            }
+        }
+    }
+    if (keys.empty()) {
+        return;
+    }
+    
+    // Decode, convert and resample without the lock: frames keep drawing the old pixels
+    auto start = std::chrono::steady_clock::now();
+    struct Decoded {
+        int pose, expression;
+        SurfacePtr surface;
+        std::vector<std::shared_ptr<SDL_Surface>> scaled; // one per entry of scales
+    };
+    std::vector<Decoded> decoded;
+    for (const auto& key : keys) {
+        SurfacePtr surface(assetSource->loadSurface(key.first, key.second));
+        if (surface && surface->format->format != TextureAtlas::PIXEL_FORMAT) {
+            surface.reset(SDL_ConvertSurfaceFormat(surface.get(), TextureAtlas::PIXEL_FORMAT, 0));
+        }
         if (!surface) {
-            std::cerr << "Failed to load image: " << fullPath << " Error: " << IMG_GetError() << std::endl;
+            // Half written or broken: keep showing the old image
+            std::cerr << "Failed to reload pose " << key.first << " expression " << key.second
+                      << ": " << SDL_GetError() << std::endl;
+            continue;
+        }
+        
+        Decoded image{key.first, key.second, std::move(surface), {}};
+        for (float scale : scales) {
+            int width = std::max(1, static_cast<int>(std::lround(image.surface->w * scale)));
+            int height = std::max(1, static_cast<int>(std::lround(image.surface->h * scale)));
+            image.scaled.emplace_back(scaleSurface(image.surface.get(), width, height), SurfaceDeleter());
+        }
+        decoded.push_back(std::move(image));
+    }
+    
+    // Surface and diffs change together; atlases follow at their next frame
+    int reloaded = 0;
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        for (auto& image : decoded) {
+            int id = getImageId(image.pose, image.expression);
+            setSurface(images[id], std::move(image.surface));
+            images[id].loaded = true;
+            
+            for (auto it = expressionDiffs.begin(); it != expressionDiffs.end();) {
+                int pose = std::get<0>(it->first);
+                bool involved = std::get<1>(it->first) == image.expression || std::get<2>(it->first) == image.expression;
+                it = (pose == image.pose && involved) ? expressionDiffs.erase(it) : std::next(it);
+            }
+            
+            for (auto& entry : atlases) {
+                if (!entry.atlas->find(id).isValid()) {
+                    entry.pendingUploads.push_back(id); // skipped if a draw uploads it first
+                    continue;
+                }
+                std::shared_ptr<SDL_Surface> scaled;
+                auto scale = std::find(scales.begin(), scales.end(), entry.scale);
+                if (scale != scales.end()) {
+                    scaled = image.scaled[scale - scales.begin()];
+                }
+                entry.reloads.push_back({id, scaled});
+            }
+            reloaded++;
         }
+        enforceBudget();
     }
+    
+    std::cout << "Reloaded " << reloaded << " image(s) in " << millisecondsSince(start) << " ms" << std::endl;
+    if (reloaded > 0 && loadedCallback) {
+        loadedCallback();
+    }
+}
 
-    // Create unique_ptr with custom deleter
-    auto ptr = std::unique_ptr<SDL_Surface, void(*)(SDL_Surface*)>(surface, surfaceDeleter);
+bool ResourceManager::applyReloads(SDL_Renderer* renderer) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    RendererAtlas* entry = findAtlas(renderer);
+    if (!entry || entry->reloads.empty()) {
+        return false;
+    }
+    
+    // In order, so the newest of several saves of one file wins. The old
+    // region is normally the same size and is reused in place.
+    for (const auto& reload : entry->reloads) {
+        entry->atlas->remove(reload.id);
+        SDL_Surface* surface = images[reload.id].surface.get();
+        if (reload.scaled && entry->atlas->add(reload.id, reload.scaled.get(), canGrow(*entry)).isValid()) {
+            continue;
+        }
+        if (surface) {
+            addToAtlas(*entry, reload.id, surface); // on failure the next draw uploads it
+        }
+    }
+    entry->reloads.clear();
+    enforceBudget();
+    return true;
+}
 
-    // Insert and return reference
-    auto result = images.insert(std::make_pair(key, std::move(ptr)));
-    return result.first->second;
+SDL_Surface* ResourceManager::getImageSurface(int pose, int expression) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    int id = getImageId(pose, expression);
+    touch(id);
+    SDL_Surface* surface = loadImage(id).surface.get();
+    enforceBudget(id);
+    return surface;
 }
 
-SDL_Surface* ResourceManager::getImageSurface(int pose, int expression) const {
-    ImageKey key = {pose, expression};
+bool ResourceManager::buildAtlas(SDL_Renderer* renderer, float scale, bool cpuPages) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (!renderer || !assetSource) {
+        return false;
+    }
+    
+    if (findAtlas(renderer)) {
+        return true;
+    }
+    
+    collectLoadedImages();
+    std::vector<std::pair<int, int>> listing = assetSource->listImages();
+    
+    // Size pages for the whole model: the manifest knows the image sizes; for
+    // other models use the images decoded so far (poses are the same size).
+    // The atlas opens another page if a later image does not fit.
+    int cellWidth = 0, cellHeight = 0;
+    for (const auto& image : listing) {
+        const manifest::PoseInfo* pose = manifest::findPose(image.first);
+        if (pose && manifest::slotOf(image.first, image.second) >= 0) {
+            cellWidth = std::max(cellWidth, pose->width);
+            cellHeight = std::max(cellHeight, pose->height);
+        }
+    }
+    if (cellWidth == 0 && !listing.empty()) {
+        loadImage(getImageId(listing.front().first, listing.front().second));
+    }
+    for (const auto& image : images) {
+        if (image.surface && image.baseId < 0) {
+            cellWidth = std::max(cellWidth, image.surface->w);
+            cellHeight = std::max(cellHeight, image.surface->h);
+        }
+    }
+    
+    // A patch takes at most its width of a shelf as tall as a whole image, so
+    // all patches together need about their summed width in cells
+    int wholeCount = 0, patchWidth = 0;
+    for (const auto& image : listing) {
+        const ImageSlot& slot = images[getImageId(image.first, image.second)];
+        if (slot.baseId >= 0) {
+            patchWidth += slot.patchRect.w;
+        } else {
+            wholeCount++;
+        }
+    }
+    int reserveCount = wholeCount;
+    if (patchWidth > 0 && cellWidth > 0) {
+        reserveCount += (patchWidth + cellWidth - 1) / cellWidth + 1;
+    }
+    
+    if (scale != 1.0f) {
+        cellWidth = static_cast<int>(std::lround(cellWidth * scale));
+        cellHeight = static_cast<int>(std::lround(cellHeight * scale));
+    }
+    
+    // Under a budget a page holds only the budget's share for this atlas (a
+    // quarter: two renderers' atlases take half, surfaces the rest)
+    if (memoryBudget > 0 && cellWidth > 0) {
+        size_t cellBytes = static_cast<size_t>(cellWidth) * cellHeight * 4;
+        reserveCount = static_cast<int>(std::min<size_t>(reserveCount, memoryBudget / 4 / cellBytes));
+        reserveCount = std::max(reserveCount, MIN_BUDGET_ATLAS_IMAGES);
+    }
+    
+    atlases.push_back({renderer, std::make_unique<TextureAtlas>(renderer, cpuPages), {}, scale, {}});
+    RendererAtlas& entry = atlases.back();
+    TextureAtlas* atlas = entry.atlas.get();
+    atlas->reserve(reserveCount, cellWidth, cellHeight);
     
-    auto it = images.find(key);
-    if (it == images.end()) {
-        // Try to load on demand (const_cast is safe here)
-        const_cast<ResourceManager*>(this)->loadImage(pose, expression);
-        it = images.find(key);
-        if (it == images.end()) {
-            return nullptr;
+    // Most recently used first, so a budget that cuts the upload short keeps the
+    // right ones; whole images before patches, so patches fill the shelves left over
+    std::vector<int> ids;
+    for (size_t id = 0; id < images.size(); id++) {
+        if (images[id].surface) {
+            ids.push_back(static_cast<int>(id));
         }
     }
+    std::sort(ids.begin(), ids.end(), [this](int a, int b) {
+        bool patchA = images[a].baseId >= 0, patchB = images[b].baseId >= 0;
+        return patchA != patchB ? patchB : images[a].lastUse > images[b].lastUse;
+    });
     
-    return it->second.get();
+    auto uploadStart = std::chrono::steady_clock::now();
+    bool complete = true;
+    for (int id : ids) {
+        if (!uploadScaled(entry, id, images[id].surface.get(), canGrow(entry)).isValid()) {
+            complete = false;
+            if (memoryBudget > 0) break; // the rest upload when first drawn
+        }
+    }
+    std::cout << "Uploaded " << atlas->getImageCount() << " images to " << atlas->getPageCount()
+              << " atlas page(s) in " << millisecondsSince(uploadStart) << " ms" << std::endl;
+    enforceBudget();
+    return complete;
 }
 
-SDL_Texture* ResourceManager::getImageTexture(int pose, int expression, SDL_Renderer* renderer) {
-    ImageKey key = {pose, expression};
-    std::pair<ImageKey, SDL_Renderer*> cacheKey = {key, renderer};
+bool ResourceManager::uploadPendingImages(SDL_Renderer* renderer, std::chrono::microseconds budget) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    collectLoadedImages();
+    
+    RendererAtlas* entry = findAtlas(renderer);
+    if (!entry) {
+        return false;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    bool more = false;
+    while (!entry->pendingUploads.empty()) {
+        if (std::chrono::steady_clock::now() - start >= budget) {
+            more = true;
+            break;
+        }
+        
+        // Already there if a miss uploaded it first; gone if evicted meanwhile
+        int id = entry->pendingUploads.back();
+        entry->pendingUploads.pop_back();
+        SDL_Surface* surface = images[id].surface.get();
+        if (surface && !entry->atlas->find(id).isValid() &&
+            !uploadScaled(*entry, id, surface, canGrow(*entry)).isValid() && memoryBudget > 0) {
+            // Full at the budget: prefetches never evict; the rest upload when first drawn
+            entry->pendingUploads.clear();
+        }
+    }
+    enforceBudget();
+    return more;
+}
+
+ModelImage ResourceManager::getModelImage(int pose, int expression, SDL_Renderer* renderer) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    RendererAtlas* entry = findAtlas(renderer);
+    if (!entry) {
+        buildAtlas(renderer);
+        entry = findAtlas(renderer);
+        if (!entry) {
+            return {};
+        }
+    }
+    
+    ModelImage image;
+    int id = getImageId(pose, expression);
+    int baseId = images[id].baseId;
+    if (baseId < 0) {
+        image.base = getRegion(*entry, id, -1);
+        return image;
+    }
     
-    auto it = textureCache.find(cacheKey);
-    if (it != textureCache.end()) {
+    // Without its patch the base would show the wrong expression
+    image.base = getRegion(*entry, baseId, id);
+    image.patch = getRegion(*entry, id, baseId);
+    if (!image.patch.isValid()) {
+        return {};
+    }
+    const SDL_Rect& rect = images[id].patchRect;
+    image.patchPosition = {static_cast<int>(std::lround(rect.x * entry->scale)),
+                           static_cast<int>(std::lround(rect.y * entry->scale))};
+    return image;
+}
+
+void ResourceManager::beginScene() {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    sceneStart = useClock + 1;
+}
+
+TextureRegion ResourceManager::getRegion(RendererAtlas& entry, int id, int keepId) {
+    touch(id);
+    TextureRegion region = entry.atlas->find(id);
+    if (region.isValid()) {
         textureCacheHits++;
-        return it->second;
+        return region;
     }
     
     textureCacheMisses++;
     
-    // Get surface first
-    SDL_Surface* surface = getImageSurface(pose, expression);
+    // Not prefetched, or decoded but not uploaded yet; upload it now
+    StageTimer stall(stats, Stats::Stage::ASSET_STALL);
+    SDL_Surface* surface = loadImage(id).surface.get();
     if (!surface) {
-        return nullptr;
+        return {nullptr, {0, 0, 0, 0}};
     }
     
-    // Create texture from surface
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (!texture) {
-        std::cerr << "Failed to create texture from surface for pose " << pose << " expression " << expression << std::endl;
+    region = addToAtlas(entry, id, surface, keepId);
+    if (!region.isValid()) {
+        const ImageKey& key = images[id].key;
+        std::cerr << "Failed to add pose " << key.pose << " expression " << key.expression << " to texture atlas" << std::endl;
+    }
+    enforceBudget(id);
+    return region;
+}
+
+bool ResourceManager::canGrow(const RendererAtlas& entry) const {
+    return memoryBudget == 0 || entry.atlas->getPageCount() == 0 ||
+           getUsedBytes() + entry.atlas->getPageBytes() <= memoryBudget;
+}
+
+ResourceManager::SurfacePtr ResourceManager::scaleForAtlas(const RendererAtlas& entry, SDL_Surface* surface) {
+    if (!surface || entry.scale == 1.0f) {
         return nullptr;
     }
-    
-    // Cache the texture
-    textureCache[cacheKey] = texture;
-    return texture;
+    int width = std::max(1, static_cast<int>(std::lround(surface->w * entry.scale)));
+    int height = std::max(1, static_cast<int>(std::lround(surface->h * entry.scale)));
+    return SurfacePtr(scaleSurface(surface, width, height));
 }
 
-const std::vector<std::unique_ptr<SDL_Surface, void(*)(SDL_Surface*)>>& ResourceManager::getAnimationFrames(int startPose, int endPose) {
-    std::pair<int, int> transition = {startPose, endPose};
+TextureRegion ResourceManager::uploadScaled(RendererAtlas& entry, int id, SDL_Surface* surface, bool allowNewPage) {
+    SurfacePtr scaled = scaleForAtlas(entry, surface);
+    return entry.atlas->add(id, scaled ? scaled.get() : surface, allowNewPage);
+}
+
+TextureRegion ResourceManager::addToAtlas(RendererAtlas& entry, int id, SDL_Surface* original, int keepId) {
+    // Scaled once, reused by every attempt below
+    SurfacePtr scaled = scaleForAtlas(entry, original);
+    SDL_Surface* surface = scaled ? scaled.get() : original;
     
-    auto it = animationFrames.find(transition);
-    if (it != animationFrames.end()) {
-        return it->second;
-    }
+    bool grow = canGrow(entry);
+    TextureRegion region = entry.atlas->add(id, surface, grow);
     
-    // Generate on-demand
-    generateAnimationFrames(startPose, endPose);
-    return animationFrames[transition];
+    while (!region.isValid() && !grow) {
+        // Smallest slot big enough for this one (a patch must not take a whole
+        // image's slot while a patch's would do), least recently used among equals
+        int victim = -1;
+        int64_t victimArea = 0;
+        for (size_t other = 0; other < images.size(); other++) {
+            SDL_Rect slot = entry.atlas->getSlot(static_cast<int>(other));
+            if (static_cast<int>(other) == id || static_cast<int>(other) == keepId ||
+                images[other].lastUse >= sceneStart || slot.w < surface->w || slot.h < surface->h) {
+                continue;
+            }
+            int64_t area = static_cast<int64_t>(slot.w) * slot.h;
+            if (victim < 0 || area < victimArea ||
+                (area == victimArea && images[other].lastUse < images[victim].lastUse)) {
+                victim = static_cast<int>(other);
+                victimArea = area;
+            }
+        }
+        
+        if (victim < 0) {
+            // Nothing to give up: exceed the budget rather than draw nothing
+            grow = true;
+        } else {
+            entry.atlas->remove(victim);
+            evictions++;
+        }
+        region = entry.atlas->add(id, surface, grow);
+    }
+    return region;
 }
 
-void ResourceManager::generateAnimationFrames(int startPose, int endPose) {
-    const int ANIMATION_FRAMES = 8; // Reduced from 12 for better performance
-    const double JUMP_HEIGHT = 15.0; // Reduced for smoother animation
+bool ResourceManager::getExpressionDiffRect(int pose, int expressionA, int expressionB, SDL_Rect& rect) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto key = std::make_tuple(pose, std::min(expressionA, expressionB), std::max(expressionA, expressionB));
     
-    // Get start and end surfaces
-    SDL_Surface* startSurface = getImageSurface(startPose, 1);
-    SDL_Surface* endSurface = getImageSurface(endPose, 1);
+    auto it = expressionDiffs.find(key);
+    int idA = getImageId(pose, expressionA), idB = getImageId(pose, expressionB);
+    const ImageSlot& slotA = images[idA];
+    const ImageSlot& slotB = images[idB];
+    bool patched = slotA.baseId >= 0 || slotB.baseId >= 0;
+    if (it == expressionDiffs.end() && patched &&
+        (slotA.baseId >= 0 ? slotA.baseId : idA) == (slotB.baseId >= 0 ? slotB.baseId : idB)) {
+        // Both are the same base outside their patches (the base itself has none)
+        SDL_Rect rect = slotA.baseId >= 0 ? slotA.patchRect : SDL_Rect{0, 0, 0, 0};
+        if (slotB.baseId >= 0) {
+            SDL_UnionRect(&rect, &slotB.patchRect, &rect);
+        }
+        it = expressionDiffs.emplace(key, DiffResult{true, rect}).first;
+    } else if (it == expressionDiffs.end()) {
+        // Both surfaces must survive until compared, so no eviction in between
+        SDL_Surface* a = loadImage(idA).surface.get();
+        SDL_Surface* b = loadImage(idB).surface.get();
+        it = expressionDiffs.emplace(key, computeDiffRect(a, b)).first;
+        enforceBudget();
+    }
     
-    if (!startSurface || !endSurface) {
-        std::cerr << "Cannot generate animation: missing surfaces for poses " << startPose << " -> " << endPose << std::endl;
-        return;
+    rect = it->second.rect;
+    return it->second.comparable;
+}
+
+ResourceManager::DiffResult ResourceManager::computeDiffRect(SDL_Surface* a, SDL_Surface* b) {
+    DiffResult result = {false, {0, 0, 0, 0}};
+    if (!a || !b || a->w != b->w || a->h != b->h ||
+        a->format->format != b->format->format || a->format->BytesPerPixel != 4) {
+        return result;
     }
     
-    std::vector<std::unique_ptr<SDL_Surface, void(*)(SDL_Surface*)>> frames;
+    if (SDL_LockSurface(a) != 0) {
+        return result;
+    }
+    if (SDL_LockSurface(b) != 0) {
+        SDL_UnlockSurface(a);
+        return result;
+    }
     
-    for (int frame = 0; frame < ANIMATION_FRAMES; frame++) {
-        double progress = static_cast<double>(frame) / (ANIMATION_FRAMES - 1);
-        double jumpOffset = JUMP_HEIGHT * sin(progress * M_PI);
-        
-        // Create animation frame surface (smaller than full window)
-        int maxWidth = std::max(startSurface->w, endSurface->w);
-        int maxHeight = std::max(startSurface->h, endSurface->h);
-        
-        SDL_Surface* animFrame = SDL_CreateRGBSurface(0, maxWidth, maxHeight + static_cast<int>(JUMP_HEIGHT),
-                                                     32, 0, 0, 0, 0);
-        
-        if (!animFrame) {
-            std::cerr << "Failed to create animation frame surface: " << SDL_GetError() << std::endl;
+    int minX = a->w, minY = a->h, maxX = -1, maxY = -1;
+    for (int y = 0; y < a->h; y++) {
+        const Uint32* rowA = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(a->pixels) + y * a->pitch);
+        const Uint32* rowB = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(b->pixels) + y * b->pitch);
+        if (memcmp(rowA, rowB, a->w * 4) == 0) {
             continue;
         }
         
-        // Fill with transparent background (assuming images have their own backgrounds)
-        SDL_FillRect(animFrame, nullptr, SDL_MapRGB(animFrame->format, 0, 255, 0));
-        
-        // Choose which surface to use
-        SDL_Surface* sourceSurface = (progress < 0.5) ? startSurface : endSurface;
+        int first = 0;
+        while (rowA[first] == rowB[first]) first++;
+        int last = a->w - 1;
+        while (rowA[last] == rowB[last]) last--;
         
-        // Center the image with jump offset
-        SDL_Rect destRect;
-        destRect.w = sourceSurface->w;
-        destRect.h = sourceSurface->h;
-        destRect.x = (maxWidth - sourceSurface->w) / 2;
-        destRect.y = (maxHeight - sourceSurface->h) / 2 - static_cast<int>(jumpOffset);
-        
-        SDL_BlitSurface(sourceSurface, nullptr, animFrame, &destRect);
-        
-        // Store with custom deleter
-        frames.push_back(std::unique_ptr<SDL_Surface, void(*)(SDL_Surface*)>(animFrame, surfaceDeleter));
+        minX = std::min(minX, first);
+        maxX = std::max(maxX, last);
+        minY = std::min(minY, y);
+        maxY = y;
     }
     
-    std::pair<int, int> transition = {startPose, endPose};
-    animationFrames[transition] = std::move(frames);
+    SDL_UnlockSurface(b);
+    SDL_UnlockSurface(a);
+    
+    result.comparable = true;
+    if (maxY >= 0) {
+        result.rect = {minX, minY, maxX - minX + 1, maxY - minY + 1};
+    }
+    return result;
+}
+
+void ResourceManager::getMemoryStats(size_t& surfaceTotal, size_t& textureTotal) const {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    surfaceTotal = ownedSurfaceBytes;
     
-    std::cout << "Generated " << ANIMATION_FRAMES << " animation frames for transition " 
-              << startPose << " -> " << endPose << std::endl;
+    textureTotal = 0;
+    for (const auto& entry : atlases) {
+        textureTotal += entry.atlas->getTextureBytes();
+    }
 }
 
-void ResourceManager::clearRendererCache(SDL_Renderer* renderer) {
-    auto it = textureCache.begin();
-    while (it != textureCache.end()) {
-        if (it->first.second == renderer) {
-            SDL_DestroyTexture(it->second);
-            it = textureCache.erase(it);
-        } else {
-            ++it;
+size_t ResourceManager::getUsedBytes() const {
+    size_t surfaceTotal, textureTotal;
+    getMemoryStats(surfaceTotal, textureTotal);
+    return surfaceTotal + textureTotal;
+}
+
+bool ResourceManager::isUploadedEverywhere(int id) const {
+    if (atlases.empty()) {
+        return false;
+    }
+    // An atlas still holding the old pixels of a reloaded image needs its surface
+    return std::all_of(atlases.begin(), atlases.end(), [id](const RendererAtlas& entry) {
+        return entry.atlas->find(id).isValid() &&
+               std::none_of(entry.reloads.begin(), entry.reloads.end(), [id](const Reload& reload) {
+                   return reload.id == id;
+               });
+    });
+}
+
+void ResourceManager::enforceBudget(int keepId) {
+    if (memoryBudget == 0) {
+        return;
+    }
+    
+    size_t used = getUsedBytes();
+    if (used <= memoryBudget) {
+        return;
+    }
+    
+    // Atlas pages only shrink with their renderer, so this frees surfaces:
+    // first those every atlas already holds (their pixels survive on the GPU),
+    // each group least recently used first. Mapped surfaces free nothing.
+    evictionOrder.clear();
+    for (size_t id = 0; id < images.size(); id++) {
+        if (static_cast<int>(id) != keepId && surfaceBytes(images[id].surface.get()) > 0) {
+            evictionOrder.emplace_back(isUploadedEverywhere(static_cast<int>(id)), static_cast<int>(id));
         }
     }
+    std::sort(evictionOrder.begin(), evictionOrder.end(),
+              [this](const std::pair<bool, int>& a, const std::pair<bool, int>& b) {
+        return a.first != b.first ? a.first : images[a.second].lastUse < images[b.second].lastUse;
+    });
+    
+    for (const auto& candidate : evictionOrder) {
+        if (used <= memoryBudget) {
+            break;
+        }
+        ImageSlot& victim = images[candidate.second];
+        used -= surfaceBytes(victim.surface.get());
+        setSurface(victim, nullptr);
+        victim.loaded = false; // decoded again if needed
+        evictions++;
+    }
+}
+
+void ResourceManager::setSurface(ImageSlot& slot, SurfacePtr surface) {
+    ownedSurfaceBytes -= surfaceBytes(slot.surface.get());
+    ownedSurfaceBytes += surfaceBytes(surface.get());
+    slot.surface = std::move(surface);
+}
+
+void ResourceManager::clearRendererCache(SDL_Renderer* renderer) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    atlases.erase(std::remove_if(atlases.begin(), atlases.end(), [renderer](const RendererAtlas& entry) {
+        return entry.renderer == renderer;
+    }), atlases.end());
 }
\ No newline at end of file
@@ -6,8 +6,19 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <tuple>
 #include <vector>
 
+#include "asset_loader.h"
+#include "asset_source.h"
+#include "file_watcher.h"
+#include "stats.h"
+#include "texture_atlas.h"
+
 class ResourceManager {
 public:
     struct ImageKey {
@@ -21,21 +32,90 @@ public:
     };
 
 private:
-    // Single storage for images - surfaces only, convert to texture on demand
-    std::map<ImageKey, std::unique_ptr<SDL_Surface, void(*)(SDL_Surface*)>> images;
+    struct SurfaceDeleter {
+        void operator()(SDL_Surface* surface) const {
+            if (surface) SDL_FreeSurface(surface);
+        }
+    };
+    using SurfacePtr = std::unique_ptr<SDL_Surface, SurfaceDeleter>;
+    
+    // One entry per dense image id. Ids [0, manifest::SLOT_COUNT) are the
+    // manifest's slots, so the per-frame lookup is arithmetic; images the
+    // manifest does not know (another model directory or pack) get the next
+    // free id on first sight through extraIds. An expression the source
+    // stores as a face patch has only the patch as its surface and is drawn
+    // over baseId's image.
+    struct ImageSlot {
+        ImageKey key;
+        SurfacePtr surface;  // nullptr if missing or not loaded yet
+        bool loaded;         // load was attempted
+        uint64_t lastUse;    // useClock at the last lookup, for LRU eviction
+        int baseId = -1;     // image the patch goes over, -1 if stored whole
+        SDL_Rect patchRect = {0, 0, 0, 0}; // where, in image coordinates
+    };
     
-    // Texture cache with reference counting
-    std::map<std::pair<ImageKey, SDL_Renderer*>, SDL_Texture*> textureCache;
+    // Image source (declared first so surfaces it backs are freed before it)
+    std::unique_ptr<AssetSource> assetSource;
     
-    // Pre-rendered animation frames for specific transitions only (not all combinations)
-    std::map<std::pair<int, int>, std::vector<std::unique_ptr<SDL_Surface, void(*)(SDL_Surface*)>>> animationFrames;
+    // Single storage for images - surfaces only, uploaded to atlases on demand
+    std::vector<ImageSlot> images;
+    std::map<ImageKey, int> extraIds;
     
-    // Directory containing the model images
-    std::string modelDirectory;
+    // Background decoding (destroyed before the source it reads from)
+    std::unique_ptr<AssetLoader> loader;
+    std::function<void()> loadedCallback;
+    
+    // Hot reload: a changed file is decoded (and resampled for each atlas) on
+    // the watcher thread; its surface and diffs are replaced at once, and each
+    // atlas swaps in the new pixels at its renderer's next frame.
+    struct Reload {
+        int id;
+        std::shared_ptr<SDL_Surface> scaled; // at the atlas scale; null at scale 1 (use the surface)
+    };
+    std::unique_ptr<FileWatcher> watcher; // stopped first: its thread calls into this
+    
+    // One atlas per renderer (textures belong to their renderer) plus the ids
+    // of decoded images it has not uploaded yet. In practice only the output
+    // renderer builds one (the control panel previews the output's frames),
+    // so a linear scan beats a tree. Images are stored pre-scaled to the renderer's
+    // output size, so drawing them is a 1:1 copy.
+    struct RendererAtlas {
+        SDL_Renderer* renderer;
+        std::unique_ptr<TextureAtlas> atlas;
+        std::vector<int> pendingUploads;
+        float scale;
+        std::vector<Reload> reloads; // changed images the atlas still shows the old pixels of
+    };
+    std::vector<RendererAtlas> atlases;
+    
+    // Changed region between two expressions of a pose, keyed (pose, lower, higher expression)
+    struct DiffResult {
+        bool comparable;
+        SDL_Rect rect;
+    };
+    std::map<std::tuple<int, int, int>, DiffResult> expressionDiffs;
+    
+    // Main and output threads both draw; every public method holds this. Recursive
+    // because public methods call each other (buildAtlas from getModelImage).
+    // Never held by loader workers, so waiting on a decode under it is safe.
+    mutable std::recursive_mutex mutex;
+    
+    // Memory budget (0 = unlimited) over decoded surfaces and atlas textures.
+    // Surfaces are evicted least recently used first, those already uploaded to
+    // every atlas before the rest; an atlas at its page limit evicts its own
+    // least recently used images to make room instead of creating a page.
+    // Evicted images are decoded or uploaded again on their next use.
+    size_t memoryBudget = 0;
+    uint64_t useClock = 0;
+    size_t ownedSurfaceBytes = 0; // surfaceBytes of every image, kept by setSurface
+    std::vector<std::pair<bool, int>> evictionOrder; // enforceBudget scratch: (uploaded, id)
+    uint64_t sceneStart = UINT64_MAX; // lookups from here on belong to the scene being resolved
+    uint64_t evictions = 0;
     
     // Performance metrics
     mutable int textureCacheHits = 0;
     mutable int textureCacheMisses = 0;
+    Stats* stats = nullptr; // times draws that wait for a decode or upload
 
 public:
     ResourceManager();
@@ -44,38 +124,141 @@ public:
     // Initialize with model directory
     bool initialize(const std::string& modelDir);
     
-    // Get image surface (raw data)
-    SDL_Surface* getImageSurface(int pose, int expression) const;
+    // Initialize with any image source (e.g. embedded images)
+    bool initialize(std::unique_ptr<AssetSource> source);
+    
+    // Called from a loader thread whenever a background decode finishes (set before prefetch)
+    void setLoadedCallback(std::function<void()> callback) { loadedCallback = std::move(callback); }
+    
+    // Cap surface plus atlas texture memory at bytes (0 = unlimited; set before building atlases)
+    void setMemoryBudget(size_t bytes);
+    
+    // Decode every image the source lists now, in parallel on all cores, and
+    // convert them to the atlas format; prints the time of each phase. The
+    // priority images (what will be prefetched, in that order) rank as the most
+    // recently used, so a memory budget drops the rest again first.
+    bool warmStart(const std::vector<std::pair<int, int>>& priority);
+    
+    // Decode these images in the background, in order; already loaded ones are skipped
+    void prefetch(const std::vector<std::pair<int, int>>& images);
+    
+    // Get image surface (raw data); waits for or performs the decode if it is not done yet.
+    // Only the patch for an expression stored as one (see getModelImage).
+    // Under a memory budget the surface may be evicted by the next call.
+    SDL_Surface* getImageSurface(int pose, int expression);
+    
+    // Create the atlas for renderer and upload every image decoded so far (call
+    // once per renderer, on the thread that uses it). Images are resampled once
+    // to scale times their size on upload; textures then have that size. With
+    // cpuPages the atlas keeps premultiplied pixels for CpuCompositor instead.
+    bool buildAtlas(SDL_Renderer* renderer, float scale = 1.0f, bool cpuPages = false);
     
-    // Get texture for specific renderer (cached)
-    SDL_Texture* getImageTexture(int pose, int expression, SDL_Renderer* renderer);
+    // Watch the source's directory and reload images whose files change, calling
+    // the loaded callback when new pixels are ready. False if the source has no
+    // directory or it cannot be watched.
+    bool watchForChanges();
     
-    // Generate animation frames on-demand for specific transition
-    const std::vector<std::unique_ptr<SDL_Surface, void(*)(SDL_Surface*)>>& getAnimationFrames(int startPose, int endPose);
+    // Swap reloaded images into renderer's atlas, all at once. Call once a frame
+    // on the renderer's thread, before drawing; true if anything changed (repaint).
+    bool applyReloads(SDL_Renderer* renderer);
     
-    // Clear texture cache for specific renderer (call when renderer is destroyed)
+    // Upload decoded images renderer's atlas does not have yet, until budget is
+    // spent (at least one). Call once a frame on the renderer's thread; true if
+    // more are waiting.
+    bool uploadPendingImages(SDL_Renderer* renderer, std::chrono::microseconds budget);
+    
+    // Atlas regions to draw an image with on a specific renderer: the image, or
+    // for a face patch its pose's base image plus the patch; invalid if missing.
+    // A miss (image not prefetched or not uploaded yet) decodes/uploads on the spot.
+    ModelImage getModelImage(int pose, int expression, SDL_Renderer* renderer);
+    
+    // Start resolving one frame's images: regions returned from now on are
+    // never evicted to make room for later lookups until the next call, so an
+    // image resolved for one avatar cannot be overwritten by the next avatar's
+    void beginScene();
+    
+    // Bounding box of the pixels that differ between two expressions of a pose, in
+    // image coordinates (cached; empty rect if identical). Patches over the same
+    // base need no pixels: only their patch rects can differ. False if the images
+    // cannot be compared (missing, or different size or format).
+    bool getExpressionDiffRect(int pose, int expressionA, int expressionB, SDL_Rect& rect);
+    
+    // Destroy the atlas of a specific renderer (call before the renderer is destroyed)
     void clearRendererCache(SDL_Renderer* renderer);
     
     // Get performance statistics
     void getCacheStats(int& hits, int& misses) const {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
         hits = textureCacheHits;
         misses = textureCacheMisses;
     }
     
-    // Preload commonly used images
-    void preloadCommonImages();
+    // Bytes held by decoded surfaces (not counting mapped pack pixels) and by
+    // atlas textures (all renderers)
+    void getMemoryStats(size_t& surfaceTotal, size_t& textureTotal) const;
+    
+    // Surfaces and atlas images evicted to stay within the memory budget
+    uint64_t getEvictionCount() const {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        return evictions;
+    }
+    
+    void setStats(Stats* target) { stats = target; }
     
 private:
-    // Load single image from file
-    std::unique_ptr<SDL_Surface, void(*)(SDL_Surface*)>& loadImage(int pose, int expression);
+    // Dense id of an image (assigned on first sight for images outside the manifest)
+    int getImageId(int pose, int expression);
+    
+    // Load single image: finished background decode if there is one, else decode now
+    ImageSlot& loadImage(int id);
+    
+    // Record which listed images the source stores as patches over a base
+    void resolvePatches();
+    
+    // Region of one image in entry's atlas, uploading it on a miss without
+    // evicting keepId (the other half of a base plus patch pair)
+    TextureRegion getRegion(RendererAtlas& entry, int id, int keepId);
     
-    // Generate animation frames for specific transition
-    void generateAnimationFrames(int startPose, int endPose);
+    RendererAtlas* findAtlas(SDL_Renderer* renderer);
     
-    // Helper to create surface deleter
-    static void surfaceDeleter(SDL_Surface* surface) {
-        if (surface) SDL_FreeSurface(surface);
+    // Move finished background decodes into images
+    void collectLoadedImages();
+    
+    // Take ownership of a decoded image and queue it for upload to every atlas
+    void storeImage(int id, SDL_Surface* surface);
+    
+    // Re-decode the images behind changed file names (watcher thread, lock not held)
+    void reloadFiles(const std::vector<std::string>& names);
+    
+    // Record a lookup of id for LRU eviction
+    void touch(int id) { images[id].lastUse = ++useClock; }
+    
+    // Upload into entry's atlas; under the budget a full atlas reuses the
+    // smallest fitting slot, least recently used first (never keepId's nor
+    // the current scene's), rather than growing
+    TextureRegion addToAtlas(RendererAtlas& entry, int id, SDL_Surface* surface, int keepId = -1);
+    bool canGrow(const RendererAtlas& entry) const; // a new page fits the budget
+    
+    // surface resampled to entry's scale; nullptr at scale 1 (upload surface itself)
+    static SurfacePtr scaleForAtlas(const RendererAtlas& entry, SDL_Surface* surface);
+    TextureRegion uploadScaled(RendererAtlas& entry, int id, SDL_Surface* surface, bool allowNewPage);
+    
+    // Evict surfaces until usage fits the budget, never keepId
+    void enforceBudget(int keepId = -1);
+    bool isUploadedEverywhere(int id) const;
+    size_t getUsedBytes() const;
+    
+    // Replace an image's surface, keeping ownedSurfaceBytes current
+    void setSurface(ImageSlot& slot, SurfacePtr surface);
+    
+    // Memory a surface holds: none for pixels it only points at (an
+    // --asset-pack mapping or embedded data), which freeing it would not return
+    static size_t surfaceBytes(const SDL_Surface* surface) {
+        return surface && !(surface->flags & SDL_PREALLOC) ? static_cast<size_t>(surface->pitch) * surface->h : 0;
     }
+    
+    // Pixel comparison behind getExpressionDiffRect
+    static DiffResult computeDiffRect(SDL_Surface* a, SDL_Surface* b);
 };
 
 #endif // RESOURCE_MANAGER_H
\ No newline at end of file
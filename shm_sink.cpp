@@ -0,0 +1,192 @@
+#include "shm_sink.h"
+#include <iostream>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace {
+
+constexpr size_t PAGE_ALIGNMENT = 4096;
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+SharedMemorySink::SharedMemorySink()
+    : fd(-1)
+    , mapping(nullptr), mappingSize(0)
+    , header(nullptr), slots(nullptr)
+    , width(0), height(0) {
+}
+
+SharedMemorySink::~SharedMemorySink() {
+    close();
+}
+
+bool SharedMemorySink::open(const std::string& objectName, int frameWidth, int frameHeight) {
+    close();
+
+    if (frameWidth <= 0 || frameHeight <= 0) {
+        std::cerr << "Invalid shared memory frame size: " << frameWidth << "x" << frameHeight << std::endl;
+        return false;
+    }
+
+    name = objectName.empty() || objectName[0] != '/' ? "/" + objectName : objectName;
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        // Never take over the frames of another running instance
+        if (!isStale()) {
+            std::cerr << "Shared memory " << name << " is in use by another instance" << std::endl;
+            return false;
+        }
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+    if (fd < 0) {
+        std::cerr << "Failed to create shared memory " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    size_t stride = static_cast<size_t>(frameWidth) * 4;
+    size_t dataOffset = alignUp(sizeof(SharedFrameHeader), PAGE_ALIGNMENT);
+    size_t slotSize = alignUp(stride * frameHeight, PAGE_ALIGNMENT);
+    mappingSize = dataOffset + slotSize * SharedFrameHeader::SLOT_COUNT;
+
+    if (ftruncate(fd, static_cast<off_t>(mappingSize)) != 0) {
+        std::cerr << "Failed to size shared memory " << name << ": " << strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        std::cerr << "Failed to map shared memory " << name << ": " << strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    width = frameWidth;
+    height = frameHeight;
+    slots = static_cast<Uint8*>(mapping) + dataOffset;
+    memset(slots, 0, slotSize * SharedFrameHeader::SLOT_COUNT);
+
+    // A previous run may have left a header behind; consumers wait for the magic
+    header = new (mapping) SharedFrameHeader;
+    header->magic.store(0, std::memory_order_relaxed);
+    header->ownerPid.store(static_cast<int32_t>(getpid()), std::memory_order_relaxed);
+    header->version = SharedFrameHeader::VERSION;
+    header->width = static_cast<uint32_t>(width);
+    header->height = static_cast<uint32_t>(height);
+    header->stride = static_cast<uint32_t>(stride);
+    header->flags = SharedFrameHeader::FLAG_PREMULTIPLIED_ALPHA;
+    header->slotCount = SharedFrameHeader::SLOT_COUNT;
+    header->dataOffset = static_cast<uint32_t>(dataOffset);
+    header->slotSize = slotSize;
+    header->sequence.store(0, std::memory_order_relaxed);
+    header->latestSlot.store(0, std::memory_order_relaxed);
+    header->frameCounter.store(0, std::memory_order_relaxed);
+    for (auto& sequence : header->slotSequence) {
+        sequence.store(0, std::memory_order_relaxed);
+    }
+    header->magic.store(SharedFrameHeader::MAGIC, std::memory_order_release);
+
+    for (auto& rect : staleRects) {
+        rect = {0, 0, width, height};
+    }
+
+    std::cout << "Shared memory output: " << name << " " << width << "x" << height << " RGBA, "
+              << SharedFrameHeader::SLOT_COUNT << " slots" << std::endl;
+    return true;
+}
+
+bool SharedMemorySink::isStale() const {
+    int existing = shm_open(name.c_str(), O_RDONLY, 0);
+    if (existing < 0) {
+        return errno == ENOENT; // gone meanwhile
+    }
+
+    // Too small for a header: possibly an instance still setting it up
+    struct stat info;
+    bool stale = false;
+    if (fstat(existing, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SharedFrameHeader)) {
+        void* view = mmap(nullptr, sizeof(SharedFrameHeader), PROT_READ, MAP_SHARED, existing, 0);
+        if (view != MAP_FAILED) {
+            auto* existingHeader = static_cast<const SharedFrameHeader*>(view);
+            int32_t pid = existingHeader->ownerPid.load(std::memory_order_relaxed);
+            // EPERM: alive, just another user's
+            stale = pid <= 0 || (kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH);
+            munmap(view, sizeof(SharedFrameHeader));
+        }
+    }
+    ::close(existing);
+    return stale;
+}
+
+void SharedMemorySink::close() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        header = nullptr;
+        slots = nullptr;
+    }
+    // fd is only ever an object this sink created, so the name is its to remove
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+        shm_unlink(name.c_str());
+    }
+}
+
+void SharedMemorySink::pushFrame(const void* rgbaPixels, int pitch, const SDL_Rect& dirtyRect) {
+    if (!isOpen() || !rgbaPixels) {
+        return;
+    }
+
+    // Every slot misses this frame's damage until it is next written
+    for (auto& rect : staleRects) {
+        if (rect.w <= 0 || rect.h <= 0) {
+            rect = dirtyRect;
+        } else if (dirtyRect.w > 0 && dirtyRect.h > 0) {
+            SDL_UnionRect(&rect, &dirtyRect, &rect);
+        }
+    }
+
+    uint32_t slot = (header->latestSlot.load(std::memory_order_relaxed) + 1) % SharedFrameHeader::SLOT_COUNT;
+    SDL_Rect& stale = staleRects[slot];
+    std::atomic<uint64_t>& slotSequence = header->slotSequence[slot];
+
+    // Seqlock write: odd while the slot is inconsistent
+    uint64_t sequence = slotSequence.load(std::memory_order_relaxed);
+    slotSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (stale.w > 0 && stale.h > 0) {
+        const Uint8* source = static_cast<const Uint8*>(rgbaPixels) + stale.y * pitch + stale.x * 4;
+        Uint8* destination = slots + slot * header->slotSize + stale.y * header->stride + stale.x * 4;
+        size_t rowBytes = static_cast<size_t>(stale.w) * 4;
+        for (int y = 0; y < stale.h; y++) {
+            memcpy(destination + y * header->stride, source + y * pitch, rowBytes);
+        }
+    }
+    stale = {0, 0, 0, 0};
+
+    slotSequence.store(sequence + 2, std::memory_order_release);
+    header->latestSlot.store(slot, std::memory_order_release);
+    header->sequence.fetch_add(1, std::memory_order_release);
+    header->frameCounter.fetch_add(1, std::memory_order_release);
+
+    // Shared (not private) futex: the waiters are other processes
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header->frameCounter), FUTEX_WAKE, INT_MAX,
+            nullptr, nullptr, 0);
+}
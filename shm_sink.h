@@ -0,0 +1,81 @@
+#ifndef SHM_SINK_H
+#define SHM_SINK_H
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "frame_sink.h"
+
+// Layout of the shared memory object, for local consumers (e.g. an OBS
+// source). Frames are RGBA32 (R,G,B,A bytes) with premultiplied alpha, rows
+// stride bytes apart; slot i starts at dataOffset + i * slotSize.
+//
+// Reading: wait for frameCounter to change (FUTEX_WAIT on its address, or
+// poll it), read latestSlot, then copy that slot between two reads of its
+// slotSequence and retry if they differ or are odd (it was being written).
+struct SharedFrameHeader {
+    static constexpr uint32_t MAGIC = 0x45494843; // "CHIE", written last
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t FLAG_PREMULTIPLIED_ALPHA = 1;
+    static constexpr uint32_t SLOT_COUNT = 3;
+
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t flags;
+    uint32_t slotCount;
+    uint32_t dataOffset;
+    uint64_t slotSize;
+    std::atomic<uint64_t> sequence;     // frames published so far
+    std::atomic<uint32_t> latestSlot;   // slot holding the newest complete frame
+    std::atomic<uint32_t> frameCounter; // futex word, incremented and woken per frame
+    std::atomic<uint64_t> slotSequence[SLOT_COUNT]; // per-slot seqlock, odd while written
+    std::atomic<int32_t> ownerPid;      // publishing process; a dead one marks a stale object
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "shared frame header atomics must be lock-free to work across processes");
+
+// Publishes output frames into a POSIX shared memory ring of SharedFrameHeader
+// slots, with no encoding and no kernel module. Each frame costs one copy of
+// the region that changed since that slot was last written.
+class SharedMemorySink : public FrameSink {
+private:
+    std::string name;
+    int fd;
+    void* mapping;
+    size_t mappingSize;
+    SharedFrameHeader* header;
+    Uint8* slots;
+    int width, height;
+
+    // Damage each slot has missed since it was last written
+    SDL_Rect staleRects[SharedFrameHeader::SLOT_COUNT];
+
+public:
+    SharedMemorySink();
+    ~SharedMemorySink();
+
+    SharedMemorySink(const SharedMemorySink&) = delete;
+    SharedMemorySink& operator=(const SharedMemorySink&) = delete;
+
+    // Create /name, sized for frameWidth x frameHeight frames. An object left
+    // behind by a process that has exited is replaced; one a running
+    // instance publishes to is not, and open fails.
+    bool open(const std::string& objectName, int frameWidth, int frameHeight);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    void pushFrame(const void* rgbaPixels, int pitch, const SDL_Rect& dirtyRect) override;
+
+private:
+    // Whether an existing object under name belongs to no running process
+    bool isStale() const;
+};
+
+#endif // SHM_SINK_H
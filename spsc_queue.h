@@ -0,0 +1,58 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Lock-free bounded single producer / single consumer FIFO. Each side owns one
+// index and only reads the other's, so push and pop are a load, a copy and a
+// release store; the indices sit on their own cache lines so the two threads
+// do not bounce one line between them. Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    T slots[Capacity];
+    alignas(64) std::atomic<size_t> head{0}; // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0}; // next slot to push, written by the producer
+
+public:
+    // Producer: false (and value dropped) if the queue is full
+    bool push(const T& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[position & MASK] = value;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: move-only values (value is left untouched if the queue is full)
+    bool push(T&& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[position & MASK] = std::move(value);
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: false if the queue is empty
+    bool pop(T& out) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = std::move(slots[position & MASK]);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,171 @@
+#include "stats.h"
+#include <algorithm>
+#include <iostream>
+
+LatencyHistogram::LatencyHistogram() : maxNanoseconds(0) {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::bucketIndex(uint64_t nanoseconds) {
+    if (nanoseconds < SUB_BUCKETS) {
+        return static_cast<int>(nanoseconds);
+    }
+
+    int exponent = 63 - __builtin_clzll(nanoseconds);
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    int mantissa = static_cast<int>(nanoseconds >> (exponent - SUB_BITS)); // [8, 16)
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + mantissa - SUB_BUCKETS;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+    if (index < SUB_BUCKETS) {
+        return static_cast<uint64_t>(index);
+    }
+
+    int exponent = index / SUB_BUCKETS + SUB_BITS - 1;
+    uint64_t mantissa = static_cast<uint64_t>(index % SUB_BUCKETS + SUB_BUCKETS);
+    return ((mantissa + 1) << (exponent - SUB_BITS)) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration) {
+    uint64_t nanoseconds = static_cast<uint64_t>(std::max<int64_t>(0, duration.count()));
+    buckets[bucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t previous = maxNanoseconds.load(std::memory_order_relaxed);
+    while (nanoseconds > previous &&
+           !maxNanoseconds.compare_exchange_weak(previous, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::takeSummary() {
+    std::array<uint32_t, BUCKET_COUNT> counts;
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] = buckets[i].exchange(0, std::memory_order_relaxed);
+        total += counts[i];
+    }
+    uint64_t maximum = maxNanoseconds.exchange(0, std::memory_order_relaxed);
+
+    Summary summary = {total, 0.0, 0.0, 0.0, maximum / 1000.0};
+    if (total == 0) {
+        return summary;
+    }
+
+    // Smallest bucket whose cumulative count reaches each rank
+    const double quantiles[3] = {0.50, 0.95, 0.99};
+    double* results[3] = {&summary.p50, &summary.p95, &summary.p99};
+    uint64_t cumulative = 0;
+    int next = 0;
+    for (int i = 0; i < BUCKET_COUNT && next < 3; i++) {
+        cumulative += counts[i];
+        while (next < 3 && cumulative >= static_cast<uint64_t>(quantiles[next] * total + 0.5)) {
+            *results[next] = std::min(bucketUpperBound(i), maximum) / 1000.0;
+            next++;
+        }
+    }
+    return summary;
+}
+
+Stats::Stats(const std::string& jsonOutputPath, std::chrono::milliseconds reportInterval)
+    : jsonPath(jsonOutputPath)
+    , jsonFile(nullptr)
+    , interval(reportInterval)
+    , startTime(std::chrono::steady_clock::now())
+    , windowStart(startTime)
+    , lastResources{0, 0, 0, 0, 0} {
+}
+
+Stats::~Stats() {
+    if (jsonFile) {
+        fclose(jsonFile);
+    }
+}
+
+bool Stats::open() {
+    if (jsonPath.empty()) {
+        return true;
+    }
+
+    jsonFile = fopen(jsonPath.c_str(), "w");
+    if (!jsonFile) {
+        std::cerr << "Failed to open stats file " << jsonPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+const char* Stats::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::EVENTS: return "events";
+        case Stage::ANIMATION: return "animation";
+        case Stage::CONTROL_RENDER: return "control_render";
+        case Stage::CONTROL_PRESENT: return "control_present";
+        case Stage::OUTPUT_RENDER: return "output_render";
+        case Stage::OUTPUT_PRESENT: return "output_present";
+        case Stage::CAMERA_WRITE: return "camera_write";
+        case Stage::ASSET_STALL: return "asset_stall";
+        case Stage::COMMAND_LATENCY: return "command_latency";
+        default: return "unknown";
+    }
+}
+
+void Stats::report(const Resources& resources) {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - startTime).count();
+
+    LatencyHistogram::Summary summaries[static_cast<size_t>(Stage::COUNT)];
+    for (size_t i = 0; i < stages.size(); i++) {
+        summaries[i] = stages[i].takeSummary();
+    }
+
+    if (jsonFile) {
+        writeJson(elapsed, summaries, resources);
+    } else {
+        writeText(elapsed, summaries, resources);
+    }
+
+    lastResources = resources;
+    windowStart = now;
+}
+
+void Stats::writeText(double elapsed, const LatencyHistogram::Summary* summaries, const Resources& resources) {
+    fprintf(stderr, "[stats] t=%.1fs\n", elapsed);
+    for (size_t i = 0; i < stages.size(); i++) {
+        const auto& s = summaries[i];
+        if (s.count == 0) continue;
+        fprintf(stderr, "[stats]   %-16s n=%-6llu p50 %8.1f  p95 %8.1f  p99 %8.1f  max %8.1f us\n",
+                stageName(static_cast<Stage>(i)), static_cast<unsigned long long>(s.count),
+                s.p50, s.p95, s.p99, s.max);
+    }
+
+    uint64_t hits = resources.cacheHits - lastResources.cacheHits;
+    uint64_t misses = resources.cacheMisses - lastResources.cacheMisses;
+    double hitRate = hits + misses > 0 ? 100.0 * hits / (hits + misses) : 100.0;
+    fprintf(stderr, "[stats]   atlas hits %.1f%% (%llu/%llu), surfaces %.1f MB, textures %.1f MB, evictions %llu\n",
+            hitRate, static_cast<unsigned long long>(hits), static_cast<unsigned long long>(hits + misses),
+            resources.surfaceBytes / 1048576.0, resources.textureBytes / 1048576.0,
+            static_cast<unsigned long long>(resources.evictions - lastResources.evictions));
+}
+
+void Stats::writeJson(double elapsed, const LatencyHistogram::Summary* summaries, const Resources& resources) {
+    fprintf(jsonFile, "{\"t\":%.3f,\"stages\":{", elapsed);
+    for (size_t i = 0; i < stages.size(); i++) {
+        const auto& s = summaries[i];
+        fprintf(jsonFile, "%s\"%s\":{\"count\":%llu,\"p50_us\":%.1f,\"p95_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}",
+                i ? "," : "", stageName(static_cast<Stage>(i)), static_cast<unsigned long long>(s.count),
+                s.p50, s.p95, s.p99, s.max);
+    }
+
+    uint64_t hits = resources.cacheHits - lastResources.cacheHits;
+    uint64_t misses = resources.cacheMisses - lastResources.cacheMisses;
+    fprintf(jsonFile, "},\"cache\":{\"hits\":%llu,\"misses\":%llu},"
+                      "\"memory\":{\"surface_bytes\":%zu,\"texture_bytes\":%zu,\"evictions\":%llu}}\n",
+            static_cast<unsigned long long>(hits), static_cast<unsigned long long>(misses),
+            resources.surfaceBytes, resources.textureBytes,
+            static_cast<unsigned long long>(resources.evictions - lastResources.evictions));
+    fflush(jsonFile);
+}
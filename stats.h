@@ -0,0 +1,126 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Log-linear latency histogram: 8 buckets per power of two of nanoseconds
+// (<= 12.5% error), up to ~17 s. Recording is two relaxed atomic operations,
+// safe from any thread; takeSummary() empties it so every report covers one
+// window.
+class LatencyHistogram {
+public:
+    struct Summary {
+        uint64_t count;
+        double p50, p95, p99, max; // microseconds; percentiles are bucket upper bounds
+    };
+
+private:
+    static constexpr int SUB_BUCKETS = 8;
+    static constexpr int SUB_BITS = 3;
+    static constexpr int MAX_EXPONENT = 34;
+    static constexpr int BUCKET_COUNT = (MAX_EXPONENT - SUB_BITS + 2) * SUB_BUCKETS;
+
+    std::array<std::atomic<uint32_t>, BUCKET_COUNT> buckets;
+    std::atomic<uint64_t> maxNanoseconds;
+
+public:
+    LatencyHistogram();
+
+    void record(std::chrono::nanoseconds duration);
+    Summary takeSummary();
+
+private:
+    static int bucketIndex(uint64_t nanoseconds);
+    static uint64_t bucketUpperBound(int index);
+};
+
+// Frame timing and resource instrumentation (--stats). Stages are timed with
+// StageTimer on whichever thread runs them; the main loop calls report() when
+// getNextReportTime() passes, which summarizes the window to stderr or, with a
+// path, appends one JSON object per line to that file.
+class Stats {
+public:
+    enum class Stage {
+        EVENTS,
+        ANIMATION,
+        CONTROL_RENDER,
+        CONTROL_PRESENT,
+        OUTPUT_RENDER,
+        OUTPUT_PRESENT,
+        CAMERA_WRITE,
+        ASSET_STALL, // a draw waited for a decode or upload
+        COMMAND_LATENCY, // control command received (or voice detected) -> first output frame showing it presented
+        COUNT
+    };
+
+    // Totals sampled from ResourceManager at report time
+    struct Resources {
+        uint64_t cacheHits;
+        uint64_t cacheMisses;
+        size_t surfaceBytes;
+        size_t textureBytes;
+        uint64_t evictions; // memory budget evictions so far
+    };
+
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(Stage::COUNT)> stages;
+    std::string jsonPath;
+    FILE* jsonFile;
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point windowStart;
+    Resources lastResources;
+
+public:
+    // Empty jsonPath reports to stderr
+    explicit Stats(const std::string& jsonOutputPath = "",
+                   std::chrono::milliseconds reportInterval = std::chrono::milliseconds(5000));
+    ~Stats();
+
+    Stats(const Stats&) = delete;
+    Stats& operator=(const Stats&) = delete;
+
+    bool open();
+
+    void record(Stage stage, std::chrono::nanoseconds duration) {
+        stages[static_cast<size_t>(stage)].record(duration);
+    }
+
+    std::chrono::steady_clock::time_point getNextReportTime() const { return windowStart + interval; }
+
+    // Summarize and reset the current window
+    void report(const Resources& resources);
+
+    static const char* stageName(Stage stage);
+
+private:
+    void writeText(double elapsed, const LatencyHistogram::Summary* summaries, const Resources& resources);
+    void writeJson(double elapsed, const LatencyHistogram::Summary* summaries, const Resources& resources);
+};
+
+// Times its scope into a stage; does nothing without a Stats instance
+class StageTimer {
+private:
+    Stats* stats;
+    Stats::Stage stage;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    StageTimer(Stats* target, Stats::Stage timedStage) : stats(target), stage(timedStage) {
+        if (stats) start = std::chrono::steady_clock::now();
+    }
+
+    ~StageTimer() {
+        if (stats) stats->record(stage, std::chrono::steady_clock::now() - start);
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+};
+
+#endif // STATS_H
@@ -0,0 +1,146 @@
+#include "text_renderer.h"
+#include <algorithm>
+#include <iostream>
+
+TextRenderer::TextRenderer(SDL_Renderer* owner, TTF_Font* textFont)
+    : renderer(owner), font(textFont), useCounter(0) {
+}
+
+TextRenderer::~TextRenderer() {
+    clear();
+}
+
+void TextRenderer::clear() {
+    for (auto& entry : cache) {
+        SDL_DestroyTexture(entry.second.texture);
+    }
+    cache.clear();
+}
+
+void TextRenderer::drawText(const std::string& text, int x, int y, SDL_Color color) {
+    if (!font || text.empty()) return;
+
+    std::string key = makeKey(text, color);
+    const CachedText* entry = lookup(key);
+    if (!entry) {
+        entry = insert(key, TTF_RenderText_Solid(font, text.c_str(), color));
+        if (!entry) return;
+    }
+
+    draw(*entry, x, y);
+}
+
+void TextRenderer::drawLines(const std::vector<std::string>& lines, int x, int y, int lineHeight, SDL_Color color) {
+    if (!font || lines.empty()) return;
+
+    // One key for the whole block; '\n' cannot appear in a single line
+    std::string joined = std::to_string(lineHeight);
+    for (const auto& line : lines) {
+        joined += '\n';
+        joined += line;
+    }
+
+    std::string key = makeKey(joined, color);
+    const CachedText* entry = lookup(key);
+    if (!entry) {
+        entry = insert(key, rasterizeLines(lines, lineHeight, color));
+        if (!entry) return;
+    }
+
+    draw(*entry, x, y);
+}
+
+const TextRenderer::CachedText* TextRenderer::lookup(const std::string& key) {
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        return nullptr;
+    }
+
+    it->second.lastUse = ++useCounter;
+    return &it->second;
+}
+
+const TextRenderer::CachedText* TextRenderer::insert(const std::string& key, SDL_Surface* surface) {
+    if (!surface) {
+        std::cerr << "Failed to render text: " << TTF_GetError() << std::endl;
+        return nullptr;
+    }
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    CachedText entry = {texture, surface->w, surface->h, ++useCounter};
+    SDL_FreeSurface(surface);
+
+    if (!texture) {
+        std::cerr << "Failed to create text texture: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+
+    if (cache.size() >= MAX_ENTRIES) {
+        evictLeastRecentlyUsed();
+    }
+
+    auto result = cache.emplace(key, entry);
+    return &result.first->second;
+}
+
+SDL_Surface* TextRenderer::rasterizeLines(const std::vector<std::string>& lines, int lineHeight, SDL_Color color) {
+    std::vector<SDL_Surface*> rendered;
+    int width = 0;
+    for (const auto& line : lines) {
+        // Empty lines are spacing only; TTF refuses to render them
+        SDL_Surface* surface = line.empty() ? nullptr : TTF_RenderText_Solid(font, line.c_str(), color);
+        rendered.push_back(surface);
+        if (surface) {
+            width = std::max(width, surface->w);
+        }
+    }
+
+    int height = lineHeight * static_cast<int>(lines.size() - 1);
+    if (!rendered.empty() && rendered.back()) {
+        height += rendered.back()->h;
+    }
+
+    SDL_Surface* block = nullptr;
+    if (width > 0 && height > 0) {
+        block = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    }
+
+    if (block) {
+        // Transparent background; Solid glyph surfaces are color keyed so only glyph pixels land
+        SDL_FillRect(block, nullptr, SDL_MapRGBA(block->format, 0, 0, 0, 0));
+        int y = 0;
+        for (SDL_Surface* surface : rendered) {
+            if (surface) {
+                SDL_Rect dest = {0, y, surface->w, surface->h};
+                SDL_BlitSurface(surface, nullptr, block, &dest);
+            }
+            y += lineHeight;
+        }
+    }
+
+    for (SDL_Surface* surface : rendered) {
+        if (surface) SDL_FreeSurface(surface);
+    }
+    return block;
+}
+
+void TextRenderer::evictLeastRecentlyUsed() {
+    auto oldest = std::min_element(cache.begin(), cache.end(), [](const auto& a, const auto& b) {
+        return a.second.lastUse < b.second.lastUse;
+    });
+    if (oldest != cache.end()) {
+        SDL_DestroyTexture(oldest->second.texture);
+        cache.erase(oldest);
+    }
+}
+
+void TextRenderer::draw(const CachedText& entry, int x, int y) {
+    SDL_Rect rect = {x, y, entry.width, entry.height};
+    SDL_RenderCopy(renderer, entry.texture, nullptr, &rect);
+}
+
+std::string TextRenderer::makeKey(const std::string& text, SDL_Color color) {
+    std::string key(reinterpret_cast<const char*>(&color), sizeof(color));
+    key += text;
+    return key;
+}
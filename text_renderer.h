@@ -0,0 +1,59 @@
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Caches rasterized text as textures on one renderer. Each distinct string is
+// rendered by FreeType and uploaded once; redraws are a single SDL_RenderCopy.
+// Least recently used entries are dropped beyond MAX_ENTRIES so changing text
+// (e.g. the status line) cannot grow the cache without bound.
+class TextRenderer {
+private:
+    struct CachedText {
+        SDL_Texture* texture;
+        int width;
+        int height;
+        uint64_t lastUse;
+    };
+
+    SDL_Renderer* renderer;
+    TTF_Font* font;
+    std::map<std::string, CachedText> cache;
+    uint64_t useCounter;
+
+    static const size_t MAX_ENTRIES = 64;
+
+public:
+    TextRenderer(SDL_Renderer* owner, TTF_Font* textFont);
+    ~TextRenderer();
+
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
+
+    // Draw one line with its top-left corner at (x, y)
+    void drawText(const std::string& text, int x, int y, SDL_Color color);
+
+    // Draw static lines spaced lineHeight apart, pre-composed into one texture
+    void drawLines(const std::vector<std::string>& lines, int x, int y, int lineHeight, SDL_Color color);
+
+    SDL_Renderer* getRenderer() const { return renderer; }
+
+    // Destroy all cached textures (e.g. when the font changes)
+    void clear();
+
+private:
+    const CachedText* lookup(const std::string& key);
+    const CachedText* insert(const std::string& key, SDL_Surface* surface);
+    SDL_Surface* rasterizeLines(const std::vector<std::string>& lines, int lineHeight, SDL_Color color);
+    void evictLeastRecentlyUsed();
+    void draw(const CachedText& entry, int x, int y);
+
+    static std::string makeKey(const std::string& text, SDL_Color color);
+};
+
+#endif // TEXT_RENDERER_H
@@ -0,0 +1,266 @@
+#include "texture_atlas.h"
+#include "compositor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+TextureAtlas::TextureAtlas(SDL_Renderer* owner, bool cpuPageStorage)
+    : renderer(owner), cpuPages(cpuPageStorage)
+    , maxPageWidth(MAX_PAGE_SIZE), maxPageHeight(MAX_PAGE_SIZE), imageCount(0) {
+    SDL_RendererInfo info;
+    if (!cpuPages && SDL_GetRendererInfo(renderer, &info) == 0) {
+        // 0 means no limit (software renderer)
+        if (info.max_texture_width > 0) maxPageWidth = std::min(maxPageWidth, info.max_texture_width);
+        if (info.max_texture_height > 0) maxPageHeight = std::min(maxPageHeight, info.max_texture_height);
+    }
+    pageWidth = maxPageWidth;
+    pageHeight = maxPageHeight;
+}
+
+TextureAtlas::~TextureAtlas() {
+    for (auto& page : pages) {
+        if (page.texture) {
+            SDL_DestroyTexture(page.texture);
+        }
+    }
+}
+
+void TextureAtlas::reserve(int count, int cellWidth, int cellHeight) {
+    if (!pages.empty() || count <= 0 || cellWidth <= 0 || cellHeight <= 0) {
+        return;
+    }
+
+    // Size pages for a near-square grid of the expected images instead of always
+    // allocating the maximum texture size (the model set is ~30 MB of pixels)
+    cellWidth += PADDING;
+    cellHeight += PADDING;
+    int columns = std::max(1, std::min((maxPageWidth - PADDING) / cellWidth,
+                                       static_cast<int>(std::ceil(std::sqrt(count)))));
+    int rows = std::max(1, std::min((maxPageHeight - PADDING) / cellHeight,
+                                    (count + columns - 1) / columns));
+    pageWidth = std::min(maxPageWidth, columns * cellWidth + PADDING);
+    pageHeight = std::min(maxPageHeight, rows * cellHeight + PADDING);
+}
+
+TextureRegion TextureAtlas::add(const Key& key, SDL_Surface* surface, bool allowNewPage) {
+    TextureRegion existing = find(key);
+    if (existing.isValid()) {
+        return existing;
+    }
+
+    if (!surface || key < 0) {
+        return {nullptr, {0, 0, 0, 0}};
+    }
+
+    int pageIndex;
+    SDL_Rect rect, slot;
+    if (!allocate(surface->w, surface->h, allowNewPage, pageIndex, rect, slot)) {
+        if (!allowNewPage) {
+            return {nullptr, {0, 0, 0, 0}};
+        }
+        std::cerr << "Image " << key << " (" << surface->w << "x" << surface->h
+                  << ") does not fit in a " << pageWidth << "x" << pageHeight << " atlas page" << std::endl;
+        return {nullptr, {0, 0, 0, 0}};
+    }
+
+    if (cpuPages) {
+        return addToCpuPage(key, surface, pageIndex, rect, slot);
+    }
+
+    // Convert once if the source is not already in the atlas format
+    SDL_Surface* converted = nullptr;
+    SDL_Surface* source = surface;
+    if (surface->format->format != PIXEL_FORMAT) {
+        converted = SDL_ConvertSurfaceFormat(surface, PIXEL_FORMAT, 0);
+        if (!converted) {
+            std::cerr << "Failed to convert image for atlas: " << SDL_GetError() << std::endl;
+            pages[pageIndex].freeSlots.push_back(slot);
+            return {nullptr, {0, 0, 0, 0}};
+        }
+        source = converted;
+    }
+
+    SDL_Texture* texture = pages[pageIndex].texture;
+
+    // Clear the padding frame; page contents are undefined after creation
+    SDL_Rect frame = {rect.x - PADDING, rect.y - PADDING, rect.w + 2 * PADDING, rect.h + 2 * PADDING};
+    SDL_Rect pageRect = {0, 0, pageWidth, pageHeight};
+    SDL_IntersectRect(&frame, &pageRect, &frame);
+    SDL_Rect strips[4] = {
+        {frame.x, frame.y, frame.w, rect.y - frame.y},
+        {frame.x, rect.y + rect.h, frame.w, frame.y + frame.h - rect.y - rect.h},
+        {frame.x, rect.y, rect.x - frame.x, rect.h},
+        {rect.x + rect.w, rect.y, frame.x + frame.w - rect.x - rect.w, rect.h},
+    };
+    for (const SDL_Rect& strip : strips) {
+        if (strip.w > 0 && strip.h > 0) {
+            SDL_UpdateTexture(texture, &strip, zeros.data(), strip.w * static_cast<int>(sizeof(Uint32)));
+        }
+    }
+
+    bool uploaded = SDL_UpdateTexture(texture, &rect, source->pixels, source->pitch) == 0;
+    if (converted) {
+        SDL_FreeSurface(converted);
+    }
+    if (!uploaded) {
+        std::cerr << "Failed to upload image to atlas: " << SDL_GetError() << std::endl;
+        pages[pageIndex].freeSlots.push_back(slot);
+        return {nullptr, {0, 0, 0, 0}};
+    }
+
+    return store(key, {texture, rect}, pageIndex, slot);
+}
+
+TextureRegion TextureAtlas::addToCpuPage(const Key& key, SDL_Surface* surface, int pageIndex, const SDL_Rect& rect,
+                                         const SDL_Rect& slot) {
+    // The compositor reads R,G,B,A bytes; no padding needed, nothing filters across slots
+    SDL_Surface* converted = nullptr;
+    SDL_Surface* source = surface;
+    if (surface->format->format != SDL_PIXELFORMAT_RGBA32) {
+        converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+        if (!converted) {
+            std::cerr << "Failed to convert image for atlas: " << SDL_GetError() << std::endl;
+            pages[pageIndex].freeSlots.push_back(slot);
+            return {nullptr, {0, 0, 0, 0}};
+        }
+        source = converted;
+    }
+
+    int pitch = pageWidth * static_cast<int>(sizeof(Uint32));
+    Uint32* pixels = pages[pageIndex].pixels.data() + static_cast<size_t>(rect.y) * pageWidth + rect.x;
+    premultiplyRgba(static_cast<const uint8_t*>(source->pixels), source->pitch, pixels, pitch, rect.w, rect.h);
+    if (converted) {
+        SDL_FreeSurface(converted);
+    }
+
+    return store(key, {nullptr, rect, pixels, pitch}, pageIndex, slot);
+}
+
+TextureRegion TextureAtlas::store(const Key& key, const TextureRegion& region, int pageIndex, const SDL_Rect& slot) {
+    if (key >= static_cast<int>(regions.size())) {
+        regions.resize(key + 1, {nullptr, {0, 0, 0, 0}});
+        regionPages.resize(key + 1, -1);
+        regionSlots.resize(key + 1, {0, 0, 0, 0});
+    }
+    regions[key] = region;
+    regionPages[key] = pageIndex;
+    regionSlots[key] = slot;
+    imageCount++;
+    return region;
+}
+
+void TextureAtlas::remove(const Key& key) {
+    if (!find(key).isValid()) {
+        return;
+    }
+
+    // The whole slot, not just the image in it, so it never shrinks
+    pages[regionPages[key]].freeSlots.push_back(regionSlots[key]);
+    regions[key] = {nullptr, {0, 0, 0, 0}};
+    regionPages[key] = -1;
+    regionSlots[key] = {0, 0, 0, 0};
+    imageCount--;
+}
+
+TextureRegion TextureAtlas::find(const Key& key) const {
+    if (key < 0 || key >= static_cast<int>(regions.size())) {
+        return {nullptr, {0, 0, 0, 0}};
+    }
+    return regions[key];
+}
+
+SDL_Rect TextureAtlas::getSlot(const Key& key) const {
+    if (!find(key).isValid()) {
+        return {0, 0, 0, 0};
+    }
+    return regionSlots[key];
+}
+
+bool TextureAtlas::allocate(int width, int height, bool allowNewPage, int& pageIndex, SDL_Rect& rect,
+                            SDL_Rect& slot) {
+    int paddedWidth = width + PADDING;
+    int paddedHeight = height + PADDING;
+    if (paddedWidth + PADDING > pageWidth || paddedHeight + PADDING > pageHeight) {
+        return false;
+    }
+
+    // A removed image's slot first (poses share a size, so these usually fit
+    // exactly); the smallest that fits, so patches leave whole-image slots free
+    int bestPage = -1;
+    size_t bestIndex = 0;
+    for (size_t i = 0; i < pages.size(); i++) {
+        const auto& slots = pages[i].freeSlots;
+        for (size_t j = 0; j < slots.size(); j++) {
+            if (slots[j].w < width || slots[j].h < height) {
+                continue;
+            }
+            if (bestPage < 0 || static_cast<int64_t>(slots[j].w) * slots[j].h <
+                                    static_cast<int64_t>(pages[bestPage].freeSlots[bestIndex].w) *
+                                        pages[bestPage].freeSlots[bestIndex].h) {
+                bestPage = static_cast<int>(i);
+                bestIndex = j;
+            }
+        }
+    }
+    if (bestPage >= 0) {
+        auto& slots = pages[bestPage].freeSlots;
+        slot = slots[bestIndex];
+        rect = {slot.x, slot.y, width, height};
+        pageIndex = bestPage;
+        slots.erase(slots.begin() + static_cast<std::ptrdiff_t>(bestIndex));
+        return true;
+    }
+
+    // Only the newest page has room; older pages were closed when they filled up
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!pages.empty()) {
+            Page& page = pages.back();
+
+            // Open a new shelf below the current one if this row is full
+            if (page.shelfX + paddedWidth > pageWidth) {
+                page.shelfY += page.shelfHeight;
+                page.shelfX = PADDING;
+                page.shelfHeight = 0;
+            }
+
+            if (page.shelfY + paddedHeight <= pageHeight) {
+                rect = {page.shelfX, page.shelfY, width, height};
+                slot = rect;
+                page.shelfX += paddedWidth;
+                page.shelfHeight = std::max(page.shelfHeight, paddedHeight);
+                pageIndex = static_cast<int>(pages.size()) - 1;
+                return true;
+            }
+        }
+
+        if (!allowNewPage || !createPage()) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+bool TextureAtlas::createPage() {
+    if (cpuPages) {
+        pages.push_back({nullptr, PADDING, PADDING, 0, {}, std::vector<Uint32>(static_cast<size_t>(pageWidth) * pageHeight)});
+        return true;
+    }
+
+    SDL_Texture* texture = SDL_CreateTexture(renderer, PIXEL_FORMAT, SDL_TEXTUREACCESS_STATIC,
+                                             pageWidth, pageHeight);
+    if (!texture) {
+        std::cerr << "Failed to create atlas page: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    pages.push_back({texture, PADDING, PADDING, 0, {}, {}});
+    
+    // Longest padding strip add() clears; allocated here, not per upload
+    if (zeros.empty()) {
+        zeros.assign(static_cast<size_t>(std::max(pageWidth, pageHeight)) * PADDING, 0);
+    }
+    return true;
+}
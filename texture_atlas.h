@@ -0,0 +1,115 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// A drawable image: a texture plus the sub-rect holding the image. Atlases
+// with CPU pages have no texture; pixels then points at the image's first
+// pixel (premultiplied RGBA32, rows pitch bytes apart) for CpuCompositor.
+struct TextureRegion {
+    SDL_Texture* texture;
+    SDL_Rect rect;
+    const Uint32* pixels = nullptr;
+    int pitch = 0;
+
+    bool isValid() const { return texture != nullptr || pixels != nullptr; }
+};
+
+// A model image as drawn: its pose's base image, plus for an expression
+// stored as a face patch the patch, which replaces the base pixels under it
+// (top-left at patchPosition, in atlas pixels of the base). Images stored
+// whole have no patch.
+struct ModelImage {
+    TextureRegion base = {nullptr, {0, 0, 0, 0}};
+    TextureRegion patch = {nullptr, {0, 0, 0, 0}};
+    SDL_Point patchPosition = {0, 0};
+
+    bool isValid() const { return base.isValid(); }
+    bool hasPatch() const { return patch.isValid(); }
+};
+
+// Packs images into a few large textures owned by one renderer, so every
+// pose/expression draws from the same texture and switching is a rect change.
+// Shelf packing: images fill rows left to right, a new row opens below
+// the tallest image of the current one, a new page opens when a page is full.
+// Removed images leave their slot on a free list that later adds reuse first,
+// smallest fitting slot first; a slot keeps its full size while a smaller
+// image (e.g. a face patch in a whole image's slot) occupies it.
+// CPU pages (for a renderer composited on the CPU) hold the same layout in
+// memory, premultiplied, instead of in textures.
+class TextureAtlas {
+public:
+    using Key = int; // dense image id (ResourceManager)
+
+    // Native format of the GL/D3D renderers, so uploads need no conversion
+    static constexpr Uint32 PIXEL_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+
+private:
+    struct Page {
+        SDL_Texture* texture;
+        int shelfX;      // next free x on the current shelf
+        int shelfY;      // top of the current shelf
+        int shelfHeight; // tallest image on the current shelf
+        std::vector<SDL_Rect> freeSlots; // slots of removed images
+        std::vector<Uint32> pixels;      // CPU pages only
+    };
+
+    SDL_Renderer* renderer;
+    bool cpuPages;
+    int maxPageWidth;
+    int maxPageHeight;
+    int pageWidth;
+    int pageHeight;
+    std::vector<Page> pages;
+    std::vector<Uint32> zeros;          // cleared padding strip, sized once for the page
+    std::vector<TextureRegion> regions; // indexed by key, invalid where nothing is packed
+    std::vector<int> regionPages;       // page of each packed region
+    std::vector<SDL_Rect> regionSlots;  // slot each region occupies (at least its rect)
+    int imageCount;
+
+    // Gap between images so filtered sampling never picks up a neighbour
+    static constexpr int PADDING = 2;
+    static constexpr int MAX_PAGE_SIZE = 4096;
+
+public:
+    explicit TextureAtlas(SDL_Renderer* owner, bool cpuPageStorage = false);
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    // Size pages for about count images of up to cellWidth x cellHeight instead
+    // of the maximum texture size; only has an effect before the first add
+    void reserve(int count, int cellWidth, int cellHeight);
+
+    // Upload one surface into a free slot; returns the existing region if already packed.
+    // Without allowNewPage, fails instead of creating a page when none has room.
+    TextureRegion add(const Key& key, SDL_Surface* surface, bool allowNewPage = true);
+
+    // Release key's slot for reuse by a later add (the page texture stays)
+    void remove(const Key& key);
+
+    // Region for key, invalid region if the key was never added
+    TextureRegion find(const Key& key) const;
+    
+    // Slot key occupies, i.e. the largest image remove(key) makes room for;
+    // empty if nothing is packed for key
+    SDL_Rect getSlot(const Key& key) const;
+
+    SDL_Renderer* getRenderer() const { return renderer; }
+    bool hasCpuPages() const { return cpuPages; }
+    int getPageCount() const { return static_cast<int>(pages.size()); }
+    int getImageCount() const { return imageCount; }
+    size_t getPageBytes() const { return static_cast<size_t>(pageWidth) * pageHeight * 4; }
+    size_t getTextureBytes() const { return pages.size() * getPageBytes(); }
+
+private:
+    bool allocate(int width, int height, bool allowNewPage, int& pageIndex, SDL_Rect& rect, SDL_Rect& slot);
+    TextureRegion addToCpuPage(const Key& key, SDL_Surface* surface, int pageIndex, const SDL_Rect& rect,
+                               const SDL_Rect& slot);
+    TextureRegion store(const Key& key, const TextureRegion& region, int pageIndex, const SDL_Rect& slot);
+    bool createPage();
+};
+
+#endif // TEXTURE_ATLAS_H
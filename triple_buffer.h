@@ -0,0 +1,49 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer / single consumer handoff of the latest value.
+// The writer fills its back slot and swaps it with the middle one; the reader
+// swaps the middle slot with its front one when it holds something new. Neither
+// side ever waits for the other and the reader always gets the newest value;
+// intermediate values the reader did not pick up are simply replaced.
+template <typename T>
+class TripleBuffer {
+private:
+    struct alignas(64) Slot {
+        T value;
+    };
+
+    Slot slots[3];
+
+    // Bits 0-1: index of the middle slot. FRESH: middle holds an unread value.
+    static constexpr uint8_t INDEX_MASK = 3;
+    static constexpr uint8_t FRESH = 4;
+    alignas(64) std::atomic<uint8_t> middle{1};
+
+    alignas(64) uint8_t back = 0; // writer only
+    alignas(64) uint8_t front = 2; // reader only
+
+public:
+    // Producer: publish a new value
+    void write(const T& value) {
+        slots[back].value = value;
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel);
+        back = previous & INDEX_MASK;
+    }
+
+    // Consumer: copy the newest value into out; false if nothing new since the last read
+    bool read(T& out) {
+        if (!(middle.load(std::memory_order_acquire) & FRESH)) {
+            return false;
+        }
+        uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX_MASK;
+        out = slots[front].value;
+        return true;
+    }
+};
+
+#endif // TRIPLE_BUFFER_H
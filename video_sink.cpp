@@ -0,0 +1,180 @@
+#include "video_sink.h"
+#include "color_convert.h"
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+
+VideoSink::VideoSink()
+    : fd(-1)
+    , width(0), height(0)
+    , format(PixelFormat::YUYV)
+    , hasFrame(false)
+    , lastWriteTime(std::chrono::steady_clock::now()) {
+}
+
+VideoSink::~VideoSink() {
+    close();
+}
+
+bool VideoSink::open(const std::string& device, int frameWidth, int frameHeight) {
+    close();
+
+    // Even dimensions keep chroma subsampling simple
+    if (frameWidth <= 0 || frameHeight <= 0 || (frameWidth % 2) || (frameHeight % 2)) {
+        std::cerr << "Invalid video sink size: " << frameWidth << "x" << frameHeight << std::endl;
+        return false;
+    }
+
+    fd = ::open(device.c_str(), O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
+        std::cerr << "Failed to open video device " << device << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    devicePath = device;
+    width = frameWidth;
+    height = frameHeight;
+
+    if (!negotiateFormat()) {
+        close();
+        return false;
+    }
+
+    size_t frameSize = (format == PixelFormat::NV12)
+        ? static_cast<size_t>(width) * height * 3 / 2
+        : static_cast<size_t>(width) * height * 2;
+    frameBuffer.assign(frameSize, 0);
+    hasFrame = false;
+
+    std::cout << "Video sink opened: " << devicePath << " " << width << "x" << height
+              << (format == PixelFormat::NV12 ? " NV12" : " YUYV")
+              << " (" << getColorConvertKernels().name << " conversion)" << std::endl;
+    return true;
+}
+
+void VideoSink::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    frameBuffer.clear();
+    hasFrame = false;
+}
+
+bool VideoSink::negotiateFormat() {
+    v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (ioctl(fd, VIDIOC_QUERYCAP, &cap) < 0) {
+        std::cerr << devicePath << " is not a V4L2 device: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    Uint32 caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_OUTPUT)) {
+        std::cerr << devicePath << " does not support video output (is it a v4l2loopback device?)" << std::endl;
+        return false;
+    }
+
+    // Keep the device's format if it is one we can produce at our size
+    v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    if (ioctl(fd, VIDIOC_G_FMT, &fmt) == 0 &&
+        static_cast<int>(fmt.fmt.pix.width) == width &&
+        static_cast<int>(fmt.fmt.pix.height) == height) {
+        if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_NV12) {
+            format = PixelFormat::NV12;
+            return true;
+        }
+        if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_YUYV) {
+            format = PixelFormat::YUYV;
+            return true;
+        }
+    }
+
+    // Otherwise configure YUYV, the most widely accepted webcam format
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    fmt.fmt.pix.width = width;
+    fmt.fmt.pix.height = height;
+    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    fmt.fmt.pix.bytesperline = width * 2;
+    fmt.fmt.pix.sizeimage = width * height * 2;
+    fmt.fmt.pix.colorspace = V4L2_COLORSPACE_SMPTE170M;
+
+    if (ioctl(fd, VIDIOC_S_FMT, &fmt) < 0) {
+        std::cerr << "Failed to set video format on " << devicePath << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    format = PixelFormat::YUYV;
+    return true;
+}
+
+void VideoSink::pushFrame(const void* rgbaPixels, int pitch, const SDL_Rect& dirtyRect) {
+    if (!isOpen() || !rgbaPixels) {
+        return;
+    }
+
+    // frameBuffer still holds the previous frame: convert only the damaged
+    // rows (whole frame the first time), widened to row pairs for NV12 chroma
+    int firstRow = 0, lastRow = height;
+    if (hasFrame) {
+        firstRow = std::max(0, dirtyRect.y);
+        lastRow = std::min(height, dirtyRect.y + std::max(0, dirtyRect.h));
+    }
+    if (format == PixelFormat::NV12) {
+        firstRow &= ~1;
+        lastRow = std::min(height, (lastRow + 1) & ~1);
+    }
+
+    if (firstRow < lastRow) {
+        const Uint8* src = static_cast<const Uint8*>(rgbaPixels) + static_cast<size_t>(firstRow) * pitch;
+        int rows = lastRow - firstRow;
+        const ColorConvertKernels& kernels = getColorConvertKernels();
+        if (format == PixelFormat::NV12) {
+            Uint8* yPlane = frameBuffer.data();
+            Uint8* uvPlane = yPlane + width * height;
+            kernels.rgbaToNv12(src, pitch, yPlane + firstRow * width, width,
+                               uvPlane + (firstRow / 2) * width, width, width, rows);
+        } else {
+            kernels.rgbaToYuyv(src, pitch, frameBuffer.data() + firstRow * width * 2, width * 2, width, rows);
+        }
+    }
+
+    hasFrame = true;
+    writeFrame();
+}
+
+void VideoSink::repeatFrame() {
+    if (!isOpen() || !hasFrame) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastWriteTime >= repeatInterval) {
+        writeFrame();
+    }
+}
+
+std::chrono::steady_clock::time_point VideoSink::getNextRepeatTime() const {
+    if (!isOpen() || !hasFrame) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return lastWriteTime + repeatInterval;
+}
+
+void VideoSink::writeFrame() {
+    lastWriteTime = std::chrono::steady_clock::now();
+
+    ssize_t written = ::write(fd, frameBuffer.data(), frameBuffer.size());
+    if (written < 0 && errno != EAGAIN) {
+        std::cerr << "Failed to write frame to " << devicePath << ": " << strerror(errno) << std::endl;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef VIDEO_SINK_H
+#define VIDEO_SINK_H
+
+#include <SDL2/SDL.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "frame_sink.h"
+
+// Writes composited output frames to a v4l2loopback device (YUV: alpha is dropped)
+class VideoSink : public FrameSink {
+public:
+    enum class PixelFormat {
+        YUYV,
+        NV12
+    };
+
+private:
+    int fd;
+    std::string devicePath;
+    int width, height;
+    PixelFormat format;
+
+    // Last frame in device format, re-sent while the avatar is idle
+    std::vector<Uint8> frameBuffer;
+    bool hasFrame;
+
+    // Consumers expect a steady stream, so repeat the last frame at this rate
+    std::chrono::steady_clock::time_point lastWriteTime;
+    const std::chrono::milliseconds repeatInterval{33}; // ~30 FPS
+
+public:
+    VideoSink();
+    ~VideoSink();
+
+    // Open device and negotiate format (keeps the device's YUYV/NV12 if already set)
+    bool open(const std::string& device, int frameWidth, int frameHeight);
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    // Convert a new RGBA32 frame (R,G,B,A byte order) and write it
+    void pushFrame(const void* rgbaPixels, int pitch, const SDL_Rect& dirtyRect) override;
+
+    // Write the last frame again if the repeat interval has elapsed
+    void repeatFrame() override;
+
+    // When repeatFrame() next has work to do; time_point::max() if never
+    std::chrono::steady_clock::time_point getNextRepeatTime() const override;
+
+    // Camera consumers read at the repeat rate
+    double getFrameRate() const override { return 1000.0 / repeatInterval.count(); }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    PixelFormat getFormat() const { return format; }
+
+private:
+    bool negotiateFormat();
+    void writeFrame();
+};
+
+#endif // VIDEO_SINK_H